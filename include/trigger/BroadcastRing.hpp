@@ -0,0 +1,188 @@
+/**
+ * @file BroadcastRing.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_BROADCASTRING_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_BROADCASTRING_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Bounded lock-free ring for one producer thread and a fixed set of consumer threads
+ *
+ * Every consumer sees every item. Items are written once into a slot and
+ * each consumer reads the slots in place through its own cursor, so adding
+ * consumers adds neither copies nor queues. A slot is reused once the
+ * slowest consumer has moved past it. The capacity is rounded up to a power
+ * of two.
+ *
+ * A consumer may block in read_wait() instead of polling. The producer only
+ * takes the lock to wake the consumers when one announced that it is about
+ * to sleep, so a busy ring costs it a fence and a load per push.
+ */
+template<typename T>
+class BroadcastRing
+{
+public:
+  BroadcastRing(size_t capacity, size_t n_consumers)
+    : m_cursors(n_consumers)
+  {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    m_slots.resize(size);
+    m_mask = size - 1;
+  }
+
+  BroadcastRing(const BroadcastRing&) = delete;
+  BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+  /**
+   * @brief Producer side: copy an item in, unless the slowest consumer has not freed a slot
+   * @return false if the ring was full
+   */
+  bool try_push(const T& item)
+  {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_min_head_cache == m_slots.size()) {
+      m_min_head_cache = min_head();
+      if (tail - m_min_head_cache == m_slots.size()) {
+        return false;
+      }
+    }
+    m_slots[tail & m_mask] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    // Pairs with the fence in read_wait: either the consumer sees the item
+    // before sleeping, or it is seen waiting here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumers_waiting.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(m_wait_mutex);
+      m_wait_cv.notify_all();
+    }
+    return true;
+  }
+
+  /**
+   * @brief Consumer side: call f on up to max_items unread items, in order, then release their slots
+   *
+   * The items are passed by const reference to the slot itself, and stay
+   * valid until read() returns.
+   * @return the number of items read
+   */
+  template<typename F>
+  size_t read(size_t consumer, F&& f, size_t max_items = std::numeric_limits<size_t>::max())
+  {
+    auto& cursor = m_cursors[consumer];
+    size_t head = cursor.head.load(std::memory_order_relaxed);
+    if (cursor.tail_cache - head < max_items) {
+      cursor.tail_cache = m_tail.load(std::memory_order_acquire);
+      if (head == cursor.tail_cache) {
+        return 0;
+      }
+    }
+    size_t n_items = std::min(cursor.tail_cache - head, max_items);
+    for (size_t i = 0; i < n_items; ++i) {
+      f(static_cast<const T&>(m_slots[(head + i) & m_mask]));
+    }
+    cursor.head.store(head + n_items, std::memory_order_release);
+    return n_items;
+  }
+
+  /**
+   * @brief Consumer side: as read, but wait up to timeout for an item if there is none
+   * @return the number of items read; 0 on timeout, or when wake() was called
+   */
+  template<typename F, class Rep, class Period>
+  size_t read_wait(size_t consumer, F&& f, size_t max_items, const std::chrono::duration<Rep, Period>& timeout)
+  {
+    size_t n_items = read(consumer, f, max_items);
+    if (n_items > 0) {
+      return n_items;
+    }
+    auto& cursor = m_cursors[consumer];
+    {
+      std::unique_lock<std::mutex> lock(m_wait_mutex);
+      m_consumers_waiting.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      m_wait_cv.wait_for(lock, timeout, [&] {
+        return m_tail.load(std::memory_order_acquire) != cursor.head.load(std::memory_order_relaxed) ||
+               cursor.wake_requested;
+      });
+      m_consumers_waiting.fetch_sub(1, std::memory_order_relaxed);
+      cursor.wake_requested = false;
+    }
+    return read(consumer, f, max_items);
+  }
+
+  /// @brief Make the read_wait of every consumer in progress, or its next one, return
+  void wake()
+  {
+    std::lock_guard<std::mutex> lock(m_wait_mutex);
+    for (auto& cursor : m_cursors) {
+      cursor.wake_requested = true;
+    }
+    m_wait_cv.notify_all();
+  }
+
+  /// @brief Number of items the given consumer has still to read
+  size_t size(size_t consumer) const
+  {
+    return m_tail.load(std::memory_order_acquire) - m_cursors[consumer].head.load(std::memory_order_acquire);
+  }
+
+  /// @brief Number of slots held by the slowest consumer
+  size_t occupancy() const { return m_tail.load(std::memory_order_acquire) - min_head(); }
+
+  size_t capacity() const { return m_slots.size(); }
+
+  size_t consumers() const { return m_cursors.size(); }
+
+private:
+  size_t min_head() const
+  {
+    size_t head = m_tail.load(std::memory_order_relaxed);
+    for (const auto& cursor : m_cursors) {
+      head = std::min(head, cursor.head.load(std::memory_order_acquire));
+    }
+    return head;
+  }
+
+  // A consumer's index, and its last view of the producer index
+  struct alignas(64) Cursor
+  {
+    std::atomic<size_t> head{ 0 };
+    size_t tail_cache{ 0 };
+    // Under m_wait_mutex
+    bool wake_requested{ false };
+  };
+
+  std::vector<T> m_slots;
+  size_t m_mask;
+  std::vector<Cursor> m_cursors;
+
+  // Producer index, and the producer's last view of the slowest consumer
+  alignas(64) std::atomic<size_t> m_tail{ 0 };
+  alignas(64) size_t m_min_head_cache{ 0 };
+
+  alignas(64) std::atomic<size_t> m_consumers_waiting{ 0 };
+  std::mutex m_wait_mutex;
+  std::condition_variable m_wait_cv;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_BROADCASTRING_HPP_
@@ -0,0 +1,150 @@
+/**
+ * @file CycleHistogram.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_CYCLEHISTOGRAM_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_CYCLEHISTOGRAM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Histogram of the cost of 1 in N calls to an algorithm, in CPU ticks
+ *
+ * time() runs a call, and times it with the time stamp counter if it is the
+ * sampled one. The cost goes into bucket i when it is in [2^i, 2^(i+1))
+ * ticks. The counts are cumulative and are written by one thread at a time,
+ * so they are plain loads and stores; snapshot() may be called from any
+ * thread, e.g. for opmon. Several histograms, e.g. one per thread, add up
+ * through Snapshot::add().
+ */
+class CycleHistogram
+{
+public:
+  static constexpr size_t s_n_buckets = 40;
+
+  struct Snapshot
+  {
+    uint64_t call_count{ 0 };                     // NOLINT(build/unsigned)
+    uint64_t sampled_count{ 0 };                  // NOLINT(build/unsigned)
+    uint64_t total_ticks{ 0 };                    // NOLINT(build/unsigned)
+    uint64_t max_ticks{ 0 };                      // NOLINT(build/unsigned)
+    std::array<uint64_t, s_n_buckets> buckets{};  // NOLINT(build/unsigned)
+
+    void add(const Snapshot& other)
+    {
+      call_count += other.call_count;
+      sampled_count += other.sampled_count;
+      total_ticks += other.total_ticks;
+      max_ticks = std::max(max_ticks, other.max_ticks);
+      for (size_t i = 0; i < s_n_buckets; ++i) {
+        buckets[i] += other.buckets[i];
+      }
+    }
+  };
+
+  /// @param sample_period time 1 in this many calls; 0 times none
+  explicit CycleHistogram(uint32_t sample_period) // NOLINT(build/unsigned)
+    : m_sample_period(sample_period)
+  {
+    // Starts the tick rate measurement
+    ticks_per_us();
+  }
+
+  template<class Call>
+  void time(Call&& call)
+  {
+    m_call_count.store(m_call_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (m_sample_period == 0 || ++m_countdown < m_sample_period) {
+      call();
+      return;
+    }
+    m_countdown = 0;
+    uint64_t start = ticks(); // NOLINT(build/unsigned)
+    call();
+    record(ticks() - start);
+  }
+
+  void record(uint64_t n_ticks) // NOLINT(build/unsigned)
+  {
+    size_t bucket = n_ticks == 0 ? 0 : 63 - __builtin_clzll(n_ticks);
+    bucket = std::min(bucket, s_n_buckets - 1);
+    bump(m_buckets[bucket], 1);
+    bump(m_sampled_count, 1);
+    bump(m_total_ticks, n_ticks);
+    if (n_ticks > m_max_ticks.load(std::memory_order_relaxed)) {
+      m_max_ticks.store(n_ticks, std::memory_order_relaxed);
+    }
+  }
+
+  Snapshot snapshot() const
+  {
+    Snapshot snapshot;
+    snapshot.call_count = m_call_count.load(std::memory_order_relaxed);
+    snapshot.sampled_count = m_sampled_count.load(std::memory_order_relaxed);
+    snapshot.total_ticks = m_total_ticks.load(std::memory_order_relaxed);
+    snapshot.max_ticks = m_max_ticks.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < s_n_buckets; ++i) {
+      snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+  uint32_t sample_period() const { return m_sample_period; } // NOLINT(build/unsigned)
+
+  /// @brief The time stamp counter where there is one, nanoseconds otherwise
+  static uint64_t ticks() // NOLINT(build/unsigned)
+  {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  /// @brief Ticks per microsecond, measured over the time since the first call
+  static double ticks_per_us()
+  {
+    static const auto first_time = std::chrono::steady_clock::now();
+    static const uint64_t first_ticks = ticks(); // NOLINT(build/unsigned)
+    auto elapsed_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - first_time).count();
+    if (elapsed_us <= 0) {
+      return 0.;
+    }
+    return static_cast<double>(ticks() - first_ticks) / elapsed_us;
+  }
+
+private:
+  static void bump(std::atomic<uint64_t>& counter, uint64_t n) // NOLINT(build/unsigned)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  uint32_t m_sample_period;  // NOLINT(build/unsigned)
+  uint32_t m_countdown{ 0 }; // NOLINT(build/unsigned)
+
+  std::atomic<uint64_t> m_call_count{ 0 };    // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_sampled_count{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_total_ticks{ 0 };   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max_ticks{ 0 };     // NOLINT(build/unsigned)
+  std::array<std::atomic<uint64_t>, s_n_buckets> m_buckets{}; // NOLINT(build/unsigned)
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_CYCLEHISTOGRAM_HPP_
@@ -0,0 +1,134 @@
+/**
+ * @file DecisionRequestBuilder.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_DECISIONREQUESTBUILDER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_DECISIONREQUESTBUILDER_HPP_
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "triggeralgs/Types.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Preassembled ComponentRequest lists for trigger decisions
+ *
+ * The list of links to read out is fixed at configuration, so the
+ * ComponentRequests are built once, with duplicate SourceIDs removed, and
+ * each TD only gets a copy of the relevant list with the readout window
+ * patched in.
+ */
+class DecisionRequestBuilder
+{
+public:
+  using timestamp_t = triggeralgs::timestamp_t;
+
+  /**
+   * @brief Build the request templates from the mandatory links and the link groups
+   *
+   * A SourceID is requested at most once: repeats within the mandatory links
+   * are dropped, and group links that are already mandatory are dropped from
+   * the group.
+   */
+  void configure(const std::vector<dfmessages::SourceID>& mandatory_links,
+                 const std::map<int, std::vector<dfmessages::SourceID>>& group_links)
+  {
+    m_mandatory_requests.clear();
+    m_group_requests.clear();
+    m_all_requests.clear();
+
+    std::set<dfmessages::SourceID> mandatory;
+    add_unique(m_mandatory_requests, mandatory_links, mandatory);
+
+    std::set<dfmessages::SourceID> all = mandatory;
+    m_all_requests = m_mandatory_requests;
+    for (const auto& [group, links] : group_links) {
+      std::set<dfmessages::SourceID> in_group = mandatory;
+      add_unique(m_group_requests[group], links, in_group);
+      add_unique(m_all_requests, links, all);
+    }
+
+    m_max_components = m_mandatory_requests.size();
+    for (const auto& [group, requests] : m_group_requests) {
+      m_max_components += requests.size();
+    }
+  }
+
+  /**
+   * @brief Largest number of components a decision built here can carry
+   */
+  size_t max_components() const { return m_max_components; }
+
+  /**
+   * @brief Request the mandatory links and every link group for [start, end]
+   */
+  void add_readout_requests(dfmessages::TriggerDecision& decision, timestamp_t start, timestamp_t end) const
+  {
+    append(decision, m_all_requests, start, end);
+  }
+
+  /**
+   * @brief Request only the mandatory links for [start, end]
+   */
+  void add_mandatory_requests(dfmessages::TriggerDecision& decision, timestamp_t start, timestamp_t end) const
+  {
+    append(decision, m_mandatory_requests, start, end);
+  }
+
+  /**
+   * @brief Request the (non-mandatory) links of one group for [start, end]
+   */
+  void add_group_requests(dfmessages::TriggerDecision& decision, int group, timestamp_t start, timestamp_t end) const
+  {
+    auto it = m_group_requests.find(group);
+    if (it != m_group_requests.end()) {
+      append(decision, it->second, start, end);
+    }
+  }
+
+private:
+  static void add_unique(std::vector<dfmessages::ComponentRequest>& requests,
+                         const std::vector<dfmessages::SourceID>& links,
+                         std::set<dfmessages::SourceID>& seen)
+  {
+    requests.reserve(requests.size() + links.size());
+    for (const auto& link : links) {
+      if (seen.insert(link).second) {
+        dfmessages::ComponentRequest request;
+        request.component = link;
+        requests.push_back(request);
+      }
+    }
+  }
+
+  static void append(dfmessages::TriggerDecision& decision,
+                     const std::vector<dfmessages::ComponentRequest>& requests,
+                     timestamp_t start,
+                     timestamp_t end)
+  {
+    auto first = decision.components.size();
+    decision.components.insert(decision.components.end(), requests.begin(), requests.end());
+    for (auto i = first; i < decision.components.size(); ++i) {
+      decision.components[i].window_begin = start;
+      decision.components[i].window_end = end;
+    }
+  }
+
+  std::vector<dfmessages::ComponentRequest> m_mandatory_requests;
+  std::map<int, std::vector<dfmessages::ComponentRequest>> m_group_requests;
+  // Mandatory links followed by all the group links, without repeats
+  std::vector<dfmessages::ComponentRequest> m_all_requests;
+  size_t m_max_components{ 0 };
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_DECISIONREQUESTBUILDER_HPP_
@@ -0,0 +1,213 @@
+/**
+ * @file InProcessChannel.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_INPROCESSCHANNEL_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_INPROCESSCHANNEL_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Bounded lock-free queue for any number of producer threads and one consumer thread
+ *
+ * Carries trigger objects between two modules of the same process by move,
+ * where they would otherwise be serialized into a network connection and
+ * back. Each slot has a sequence number telling whether it is free for the
+ * producer claiming that position or filled for the consumer, so producers
+ * only contend on claiming a position. The capacity is rounded up to a
+ * power of two.
+ *
+ * The consumer may block in pop_wait() instead of polling. Producers only
+ * take the lock to wake it when it announced that it is about to sleep, so a
+ * busy channel costs them a fence and a load per push.
+ */
+template<typename T>
+class InProcessChannel
+{
+public:
+  explicit InProcessChannel(size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    m_slots = std::make_unique<Slot[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_mask = size - 1;
+  }
+
+  InProcessChannel(const InProcessChannel&) = delete;
+  InProcessChannel& operator=(const InProcessChannel&) = delete;
+
+  /**
+   * @brief Producer side: move an object in, unless the channel is full
+   * @return false if the channel was full, in which case object is left untouched
+   */
+  bool try_push(T&& object)
+  {
+    size_t position = m_push_position.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &m_slots[position & m_mask];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+      if (difference == 0) {
+        if (m_push_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = m_push_position.load(std::memory_order_relaxed);
+      }
+    }
+    slot->object = std::move(object);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    // Pairs with the fence in pop_wait: either the consumer sees the object
+    // before sleeping, or it is seen waiting here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumer_waiting.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(m_wait_mutex);
+      m_wait_cv.notify_one();
+    }
+    return true;
+  }
+
+  /**
+   * @brief Consumer side: move the oldest object out, unless the channel is empty
+   */
+  bool try_pop(T& object)
+  {
+    size_t position = m_pop_position.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[position & m_mask];
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+      return false;
+    }
+    object = std::move(slot.object);
+    slot.sequence.store(position + m_mask + 1, std::memory_order_release);
+    m_pop_position.store(position + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * @brief Consumer side: as try_pop, but wait up to timeout for an object
+   * @return false on timeout, or when wake() was called
+   */
+  template<class Rep, class Period>
+  bool pop_wait(T& object, const std::chrono::duration<Rep, Period>& timeout)
+  {
+    if (try_pop(object)) {
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(m_wait_mutex);
+    m_consumer_waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool popped = false;
+    m_wait_cv.wait_for(lock, timeout, [&] { return (popped = try_pop(object)) || m_wake_requested; });
+    m_consumer_waiting.store(false, std::memory_order_relaxed);
+    m_wake_requested = false;
+    return popped;
+  }
+
+  /// @brief Make a pop_wait in progress, or the next one, return
+  void wake()
+  {
+    std::lock_guard<std::mutex> lock(m_wait_mutex);
+    m_wake_requested = true;
+    m_wait_cv.notify_one();
+  }
+
+  /// @brief Consumer side: drop the objects left in the channel, returning how many there were
+  size_t clear()
+  {
+    size_t n_dropped = 0;
+    T object;
+    while (try_pop(object)) {
+      ++n_dropped;
+    }
+    return n_dropped;
+  }
+
+  size_t capacity() const { return m_mask + 1; }
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> sequence{ 0 };
+    T object;
+  };
+
+  std::unique_ptr<Slot[]> m_slots;
+  size_t m_mask{ 0 };
+  alignas(64) std::atomic<size_t> m_push_position{ 0 };
+  alignas(64) std::atomic<size_t> m_pop_position{ 0 };
+  alignas(64) std::atomic<bool> m_consumer_waiting{ false };
+  std::mutex m_wait_mutex;
+  std::condition_variable m_wait_cv;
+  bool m_wake_requested{ false };
+};
+
+/**
+ * @brief The in-process channels of this process, by connection UID
+ *
+ * The receiving end of a connection opens the channel at init; the sending
+ * end, configured later, finds it if the receiver is in the same process.
+ * Channels stay registered for the life of the process, as senders keep
+ * them, and are reused from one run to the next.
+ */
+class InProcessChannelRegistry
+{
+public:
+  /// @brief The channel of a connection, created if there is none yet; nullptr if it exists for another type
+  template<typename T>
+  static std::shared_ptr<InProcessChannel<T>> open(const std::string& connection, size_t capacity)
+  {
+    return std::static_pointer_cast<InProcessChannel<T>>(
+      open_untyped(connection, typeid(T), [capacity]() { return std::make_shared<InProcessChannel<T>>(capacity); }));
+  }
+
+  /// @brief The channel of a connection, or nullptr if no receiver in this process opened one for T
+  template<typename T>
+  static std::shared_ptr<InProcessChannel<T>> find(const std::string& connection)
+  {
+    return std::static_pointer_cast<InProcessChannel<T>>(find_untyped(connection, typeid(T)));
+  }
+
+private:
+  template<typename Factory>
+  static std::shared_ptr<void> open_untyped(const std::string& connection, std::type_index type, Factory&& make)
+  {
+    if (auto channel = find_untyped(connection, type)) {
+      return channel;
+    }
+    // Made outside of the lock, as the slots are allocated up front
+    return insert_untyped(connection, type, make());
+  }
+
+  static std::shared_ptr<void> find_untyped(const std::string& connection, std::type_index type);
+  static std::shared_ptr<void> insert_untyped(const std::string& connection,
+                                              std::type_index type,
+                                              std::shared_ptr<void> channel);
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_INPROCESSCHANNEL_HPP_
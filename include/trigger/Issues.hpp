@@ -205,6 +205,18 @@ ERS_DECLARE_ISSUE(trigger,
                   "TD trigger number " << tn << " time stamp  " << ts,
                   ((uint64_t)tn) ((uint64_t)ts))
 
+ERS_DECLARE_ISSUE(trigger,
+                  DroppedSummary,
+                  n_dropped << " " << object << "s dropped in the last " << interval_ms
+                            << " ms, timestamps from " << first_time << " to " << last_time,
+                  ((std::string)object) ((uint64_t)n_dropped) ((uint64_t)first_time) ((uint64_t)last_time)
+                  ((uint64_t)interval_ms))
+
+ERS_DECLARE_ISSUE(trigger,
+                  BadPackedTPSet,
+                  "Cannot decode packed TPSet: " << reason,
+                  ((std::string)reason))
+
 ERS_DECLARE_ISSUE_BASE(trigger,
                        MLTConfigurationProblem,
                        appfwk::GeneralDAQModuleIssue,
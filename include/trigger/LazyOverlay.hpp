@@ -0,0 +1,126 @@
+/**
+ * @file LazyOverlay.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2021.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_LAZYOVERLAY_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_LAZYOVERLAY_HPP_
+
+#include "triggeralgs/TriggerObjectOverlay.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief The overlay serialization of a trigger object, written on first use
+ *
+ * Most TAs and TCs only feed the algorithms and are never requested by
+ * dataflow, so the overlay is only written the first time get() is called,
+ * e.g. by the request handler building a fragment. get() may be called from
+ * several threads at once: one writes the buffer, the others wait for it.
+ * Copies and moves carry the buffer over only once it has been written.
+ */
+class LazyOverlay
+{
+public:
+  LazyOverlay() = default;
+
+  LazyOverlay(const LazyOverlay& other) { copy_from(other); }
+
+  LazyOverlay(LazyOverlay&& other) noexcept { move_from(std::move(other)); }
+
+  LazyOverlay& operator=(const LazyOverlay& other)
+  {
+    if (this != &other) {
+      copy_from(other);
+    }
+    return *this;
+  }
+
+  LazyOverlay& operator=(LazyOverlay&& other) noexcept
+  {
+    if (this != &other) {
+      move_from(std::move(other));
+    }
+    return *this;
+  }
+
+  /**
+   * @brief The overlay of object, written now if it has not been yet
+   * @param object the object this overlay belongs to; always the same one
+   */
+  template<class TriggerObject>
+  std::vector<uint8_t>& get(const TriggerObject& object) // NOLINT(build/unsigned)
+  {
+    if (m_state.load(std::memory_order_acquire) != s_written) {
+      write(object);
+    }
+    return m_buffer;
+  }
+
+  bool written() const { return m_state.load(std::memory_order_acquire) == s_written; }
+
+  /// @brief Forget the overlay, e.g. after the object has changed. Not thread-safe
+  void reset()
+  {
+    m_buffer = std::vector<uint8_t>(); // NOLINT(build/unsigned)
+    m_state.store(s_empty, std::memory_order_release);
+  }
+
+private:
+  static constexpr uint8_t s_empty = 0;   // NOLINT(build/unsigned)
+  static constexpr uint8_t s_writing = 1; // NOLINT(build/unsigned)
+  static constexpr uint8_t s_written = 2; // NOLINT(build/unsigned)
+
+  template<class TriggerObject>
+  void write(const TriggerObject& object)
+  {
+    uint8_t expected = s_empty; // NOLINT(build/unsigned)
+    if (m_state.compare_exchange_strong(expected, s_writing, std::memory_order_acq_rel)) {
+      m_buffer.resize(triggeralgs::get_overlay_nbytes(object));
+      triggeralgs::write_overlay(object, m_buffer.data());
+      m_state.store(s_written, std::memory_order_release);
+      return;
+    }
+    // Another thread is writing it; it is a few hundred bytes at most
+    while (m_state.load(std::memory_order_acquire) != s_written) {
+      std::this_thread::yield();
+    }
+  }
+
+  void copy_from(const LazyOverlay& other)
+  {
+    if (other.written()) {
+      m_buffer = other.m_buffer;
+      m_state.store(s_written, std::memory_order_release);
+    } else {
+      reset();
+    }
+  }
+
+  void move_from(LazyOverlay&& other)
+  {
+    if (other.written()) {
+      m_buffer = std::move(other.m_buffer);
+      m_state.store(s_written, std::memory_order_release);
+      other.reset();
+    } else {
+      reset();
+    }
+  }
+
+  std::atomic<uint8_t> m_state{ s_empty }; // NOLINT(build/unsigned)
+  std::vector<uint8_t> m_buffer;           // NOLINT(build/unsigned)
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_LAZYOVERLAY_HPP_
@@ -0,0 +1,48 @@
+/**
+ * @file PackedTPSet.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_PACKEDTPSET_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_PACKEDTPSET_HPP_
+
+#include "serialization/Serialization.hpp"
+#include "trigger/TPSet.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief A TPSet in a compact binary encoding, for connections of data type "PackedTPSet"
+ *
+ * msgpack writes every field of every TP of a TPSet. The packed encoding
+ * writes the fields that are the same for all the TPs of the set (detid,
+ * type, algorithm, version, flag) once, the TP start times as the difference
+ * to the previous TP, the peak times as the difference to their start time,
+ * and everything as a varint, so that a TP typically takes 10 to 15 bytes.
+ * The sender and the receiver of a connection both use it when the
+ * connection's data type is "PackedTPSet" rather than "TPSet".
+ */
+struct PackedTPSet
+{
+  std::vector<uint8_t> bytes; // NOLINT(build/unsigned)
+};
+
+/// @brief Encode tpset into packed.bytes, reusing its memory
+void
+pack(const TPSet& tpset, PackedTPSet& packed);
+
+/// @brief Decode packed into tpset, reusing the memory of its objects. Throws BadPackedTPSet on corrupt input
+void
+unpack(const PackedTPSet& packed, TPSet& tpset);
+
+} // namespace dunedaq::trigger
+
+DUNE_DAQ_SERIALIZE_NON_INTRUSIVE(dunedaq::trigger, PackedTPSet, bytes)
+
+#endif // TRIGGER_INCLUDE_TRIGGER_PACKEDTPSET_HPP_
@@ -0,0 +1,273 @@
+/**
+ * @file PendingTDIndex.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_PENDINGTDINDEX_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_PENDINGTDINDEX_HPP_
+
+#include "trgdataformats/Types.hpp"
+#include "triggeralgs/TriggerCandidate.hpp"
+#include "triggeralgs/Types.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief A TC on its way to a trigger decision
+ *
+ * Holds the TC header fields that TD building reads, and shares ownership of
+ * the full TC, so handles can be moved and copied without copying the TC's
+ * inputs.
+ */
+struct TCHandle
+{
+  using Type = triggeralgs::TriggerCandidate::Type;
+  using source_t = uint64_t; // NOLINT(build/unsigned)
+
+  Type type{ Type::kUnknown };
+  triggeralgs::timestamp_t time_start{ 0 };
+  triggeralgs::timestamp_t time_end{ 0 };
+  triggeralgs::timestamp_t time_candidate{ 0 };
+  trgdataformats::detid_t detid{ 0 };
+  /// @brief Where the TC came from; TCs of one source arrive in time order
+  source_t source{ 0 };
+  std::shared_ptr<const triggeralgs::TriggerCandidate> candidate;
+
+  TCHandle() = default;
+
+  explicit TCHandle(std::shared_ptr<const triggeralgs::TriggerCandidate> tc)
+    : type(tc->type)
+    , time_start(tc->time_start)
+    , time_end(tc->time_end)
+    , time_candidate(tc->time_candidate)
+    , detid(tc->detid)
+    , candidate(std::move(tc))
+  {
+  }
+};
+
+/**
+ * @brief A trigger decision that is still collecting TCs
+ */
+struct PendingTD
+{
+  std::vector<TCHandle> contributing_tcs;
+  triggeralgs::timestamp_t readout_start;
+  triggeralgs::timestamp_t readout_end;
+  int64_t walltime_expiration;
+};
+
+/**
+ * @brief Ordered interval index of pending TDs, keyed on [readout_start, readout_end]
+ *
+ * Entries are sorted by readout_start. When entries are only added with
+ * insert() after find_overlap() came back empty, and only grown with extend(),
+ * the readout windows stay disjoint. Disjoint windows sorted by start are also
+ * sorted by end, so the overlap lookup is a single O(log n) search.
+ *
+ * The index also keeps a min-heap of walltime_expiration deadlines, so the
+ * earliest deadline and the TDs that have reached it are found without a
+ * scan. Heap entries are not removed when a TD is merged, re-scheduled or
+ * erased; they are discarded lazily when they reach the top.
+ */
+class PendingTDIndex
+{
+public:
+  using timestamp_t = triggeralgs::timestamp_t;
+  using container_t = std::multimap<timestamp_t, PendingTD>;
+  using iterator = container_t::iterator;
+  using const_iterator = container_t::const_iterator;
+
+  /**
+   * @brief Find a pending TD whose readout window overlaps [start, end] (inclusive)
+   * @return iterator to the overlapping TD, or end() if there is none
+   */
+  iterator find_overlap(timestamp_t start, timestamp_t end)
+  {
+    // Last TD starting at or before the end of the window. With disjoint
+    // windows it also has the latest end of all the TDs starting before us.
+    auto it = m_tds.upper_bound(end);
+    if (it == m_tds.begin()) {
+      return m_tds.end();
+    }
+    --it;
+    return (it->second.readout_end >= start) ? it : m_tds.end();
+  }
+
+  /**
+   * @brief Add a new pending TD, keyed on its readout start
+   */
+  iterator insert(PendingTD&& td)
+  {
+    auto key = td.readout_start;
+    auto it = m_tds.emplace(key, std::move(td));
+    schedule(it);
+    return it;
+  }
+
+  /**
+   * @brief Widen the readout window of a TD to cover [start, end]
+   *
+   * Any neighbouring TDs that overlap the widened window are absorbed into
+   * it, so the index stays disjoint.
+   * @return iterator to the (possibly re-keyed) extended TD
+   */
+  iterator extend(iterator it, timestamp_t start, timestamp_t end)
+  {
+    auto node = m_tds.extract(it);
+    PendingTD& td = node.mapped();
+    td.readout_start = std::min(td.readout_start, start);
+    td.readout_end = std::max(td.readout_end, end);
+
+    auto next = m_tds.lower_bound(td.readout_start);
+    while (next != m_tds.begin()) {
+      auto prev = std::prev(next);
+      if (prev->second.readout_end < td.readout_start) {
+        break;
+      }
+      absorb(td, prev->second);
+      m_tds.erase(prev);
+    }
+    while (next != m_tds.end() && next->first <= td.readout_end) {
+      absorb(td, next->second);
+      next = m_tds.erase(next);
+    }
+
+    node.key() = td.readout_start;
+    auto extended = m_tds.insert(std::move(node));
+    schedule(extended);
+    return extended;
+  }
+
+  /**
+   * @brief Move the walltime_expiration deadline of a TD
+   */
+  void reschedule(iterator it, int64_t walltime_expiration)
+  {
+    it->second.walltime_expiration = walltime_expiration;
+    schedule(it);
+  }
+
+  /**
+   * @brief Earliest walltime_expiration among the pending TDs, if there are any
+   */
+  std::optional<int64_t> next_deadline()
+  {
+    drop_stale_deadlines();
+    if (m_deadlines.empty()) {
+      return std::nullopt;
+    }
+    return m_deadlines.top().first;
+  }
+
+  /**
+   * @brief Remove and return all the TDs whose walltime_expiration is at or before now
+   */
+  std::vector<PendingTD> extract_expired(int64_t now)
+  {
+    std::vector<PendingTD> expired;
+    drop_stale_deadlines();
+    while (!m_deadlines.empty() && m_deadlines.top().first <= now) {
+      auto it = find_scheduled(m_deadlines.top());
+      m_deadlines.pop();
+      if (it != m_tds.end()) {
+        expired.push_back(std::move(it->second));
+        m_tds.erase(it);
+      }
+      drop_stale_deadlines();
+    }
+    return expired;
+  }
+
+  /**
+   * @brief Remove and return the TDs at the front of the index whose readout ends at or before watermark
+   *
+   * Stops at the first TD that is still open. With disjoint windows that is
+   * every TD the watermark has passed; if overlapping TDs were inserted, some
+   * may wait until the TDs before them have closed too.
+   */
+  std::vector<PendingTD> extract_closed(timestamp_t watermark)
+  {
+    std::vector<PendingTD> closed;
+    auto it = m_tds.begin();
+    while (it != m_tds.end() && it->second.readout_end <= watermark) {
+      closed.push_back(std::move(it->second));
+      it = m_tds.erase(it);
+    }
+    return closed;
+  }
+
+  iterator erase(iterator it) { return m_tds.erase(it); }
+
+  void clear()
+  {
+    m_tds.clear();
+    m_deadlines = deadline_queue_t();
+  }
+
+  size_t size() const { return m_tds.size(); }
+
+  bool empty() const { return m_tds.empty(); }
+
+  iterator begin() { return m_tds.begin(); }
+  iterator end() { return m_tds.end(); }
+  const_iterator begin() const { return m_tds.begin(); }
+  const_iterator end() const { return m_tds.end(); }
+
+private:
+  // (walltime_expiration, readout_start) of a scheduled TD
+  using deadline_t = std::pair<int64_t, timestamp_t>;
+  using deadline_queue_t = std::priority_queue<deadline_t, std::vector<deadline_t>, std::greater<deadline_t>>;
+
+  void schedule(iterator it) { m_deadlines.emplace(it->second.walltime_expiration, it->first); }
+
+  // A heap entry is current only while a TD with that start still carries that deadline
+  iterator find_scheduled(const deadline_t& deadline)
+  {
+    auto [first, last] = m_tds.equal_range(deadline.second);
+    for (auto it = first; it != last; ++it) {
+      if (it->second.walltime_expiration == deadline.first) {
+        return it;
+      }
+    }
+    return m_tds.end();
+  }
+
+  void drop_stale_deadlines()
+  {
+    while (!m_deadlines.empty() && find_scheduled(m_deadlines.top()) == m_tds.end()) {
+      m_deadlines.pop();
+    }
+  }
+
+  static void absorb(PendingTD& into, PendingTD& from)
+  {
+    into.readout_start = std::min(into.readout_start, from.readout_start);
+    into.readout_end = std::max(into.readout_end, from.readout_end);
+    into.walltime_expiration = std::max(into.walltime_expiration, from.walltime_expiration);
+    into.contributing_tcs.insert(into.contributing_tcs.end(),
+                                 std::make_move_iterator(from.contributing_tcs.begin()),
+                                 std::make_move_iterator(from.contributing_tcs.end()));
+  }
+
+  container_t m_tds;
+  deadline_queue_t m_deadlines;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_PENDINGTDINDEX_HPP_
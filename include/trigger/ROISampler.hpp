@@ -0,0 +1,150 @@
+/**
+ * @file ROISampler.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_ROISAMPLER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_ROISAMPLER_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Walker alias table for O(1) sampling from a discrete distribution
+ *
+ * Built with Vose's method. Weights need not be normalised; if they are all
+ * zero (or there are none) the table is empty and sample() returns -1.
+ */
+class AliasTable
+{
+public:
+  AliasTable() = default;
+
+  explicit AliasTable(const std::vector<double>& weights)
+  {
+    double total = 0;
+    for (auto weight : weights) {
+      total += std::max(weight, 0.0);
+    }
+    if (weights.empty() || total <= 0) {
+      return;
+    }
+
+    int n = static_cast<int>(weights.size());
+    m_probability.assign(n, 1.0);
+    m_alias.resize(n);
+    std::iota(m_alias.begin(), m_alias.end(), 0);
+
+    // Scale so that the average weight is 1, then pair each under-full
+    // column with an over-full one
+    std::vector<double> scaled(n);
+    std::vector<int> small;
+    std::vector<int> large;
+    for (int i = 0; i < n; ++i) {
+      scaled[i] = std::max(weights[i], 0.0) * n / total;
+      (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+      int s = small.back();
+      small.pop_back();
+      int l = large.back();
+      m_probability[s] = scaled[s];
+      m_alias[s] = l;
+      scaled[l] -= 1.0 - scaled[s];
+      if (scaled[l] < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // Whatever is left is 1 up to rounding, and keeps its own column
+  }
+
+  bool empty() const { return m_probability.empty(); }
+
+  size_t size() const { return m_probability.size(); }
+
+  template<typename URNG>
+  int sample(URNG& rng) const
+  {
+    if (m_probability.empty()) {
+      return -1;
+    }
+    int column = std::uniform_int_distribution<int>(0, static_cast<int>(m_probability.size()) - 1)(rng);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < m_probability[column] ? column : m_alias[column];
+  }
+
+private:
+  std::vector<double> m_probability;
+  std::vector<int> m_alias;
+};
+
+/**
+ * @brief Random choices for ROI readout: which ROI configuration, and which link groups
+ *
+ * Owns its PRNG, so each processor draws from its own seeded stream instead
+ * of the global rand(). Not thread-safe; use from a single thread.
+ */
+class ROISampler
+{
+public:
+  using rng_t = std::mt19937_64;
+
+  /**
+   * @brief Set up the sampler
+   * @param probabilities  relative probability of each ROI configuration
+   * @param n_groups       number of link groups, with IDs 0 to n_groups - 1
+   * @param seed           PRNG seed
+   */
+  void configure(const std::vector<double>& probabilities, int n_groups, uint64_t seed) // NOLINT(build/unsigned)
+  {
+    m_configs = AliasTable(probabilities);
+    m_groups.resize(std::max(n_groups, 0));
+    std::iota(m_groups.begin(), m_groups.end(), 0);
+    m_rng.seed(seed);
+  }
+
+  /**
+   * @brief Pick an ROI configuration, weighted by its probability
+   * @return the configuration index, or -1 if no configuration can be picked
+   */
+  int pick_config() { return m_configs.sample(m_rng); }
+
+  /**
+   * @brief Pick n distinct link groups uniformly at random
+   *
+   * Partial Fisher-Yates shuffle: O(n) whatever n is compared with the number
+   * of groups. Asking for more groups than there are returns all of them.
+   * @return the picked group IDs, valid until the next call
+   */
+  const std::vector<int>& pick_groups(int n)
+  {
+    int n_groups = static_cast<int>(m_groups.size());
+    n = std::clamp(n, 0, n_groups);
+    for (int i = 0; i < n; ++i) {
+      int j = std::uniform_int_distribution<int>(i, n_groups - 1)(m_rng);
+      std::swap(m_groups[i], m_groups[j]);
+    }
+    m_picked.assign(m_groups.begin(), m_groups.begin() + n);
+    return m_picked;
+  }
+
+private:
+  AliasTable m_configs;
+  // Permutation of the group IDs; its first n entries are the last pick
+  std::vector<int> m_groups;
+  std::vector<int> m_picked;
+  rng_t m_rng;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_ROISAMPLER_HPP_
@@ -0,0 +1,98 @@
+/**
+ * @file SPSCRing.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_SPSCRING_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_SPSCRING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Bounded lock-free ring for one producer thread and one consumer thread
+ *
+ * The capacity is rounded up to a power of two. Slots are default-constructed
+ * up front and items are moved in and out of them, so pushing and popping
+ * never allocate for the ring itself.
+ */
+template<typename T>
+class SPSCRing
+{
+public:
+  explicit SPSCRing(size_t capacity)
+  {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    m_slots.resize(size);
+    m_mask = size - 1;
+  }
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  /**
+   * @brief Producer side: move an item in, unless the ring is full
+   * @return false if the ring was full, in which case item is left untouched
+   */
+  bool try_push(T&& item)
+  {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head_cache == m_slots.size()) {
+      m_head_cache = m_head.load(std::memory_order_acquire);
+      if (tail - m_head_cache == m_slots.size()) {
+        return false;
+      }
+    }
+    m_slots[tail & m_mask] = std::move(item);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Consumer side: move the oldest item out, unless the ring is empty
+   */
+  bool try_pop(T& item)
+  {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail_cache) {
+      m_tail_cache = m_tail.load(std::memory_order_acquire);
+      if (head == m_tail_cache) {
+        return false;
+      }
+    }
+    item = std::move(m_slots[head & m_mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+
+  size_t size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+
+  size_t capacity() const { return m_slots.size(); }
+
+private:
+  std::vector<T> m_slots;
+  size_t m_mask;
+
+  // Consumer index, and the producer's last view of it
+  alignas(64) std::atomic<size_t> m_head{ 0 };
+  alignas(64) size_t m_head_cache{ 0 };
+  // Producer index, and the consumer's last view of it
+  alignas(64) std::atomic<size_t> m_tail{ 0 };
+  alignas(64) size_t m_tail_cache{ 0 };
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_SPSCRING_HPP_
@@ -0,0 +1,165 @@
+/**
+ * @file SetBatcher.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_SETBATCHER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_SETBATCHER_HPP_
+
+#include "trigger/Set.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Collects objects into Sets, to send one message where there would be many
+ *
+ * A Set is sent once it holds max_objects objects, once the next object
+ * would stretch it over more than max_time_span in data time, or once its
+ * first object has waited for max_delay in wall time, whichever comes first.
+ * The wall-time deadline is kept by a thread of its own, so a quiet stream
+ * still has its last objects sent. Objects may be added from several
+ * threads; Sets are sent one at a time, in seqno order.
+ */
+template<class T>
+class SetBatcher
+{
+public:
+  using set_t = Set<T>;
+  using timestamp_t = typename set_t::timestamp_t;
+  using send_function_t = std::function<void(set_t&&)>;
+
+  SetBatcher(size_t max_objects, timestamp_t max_time_span, std::chrono::microseconds max_delay)
+    : m_max_objects(std::max<size_t>(max_objects, 1))
+    , m_max_time_span(max_time_span)
+    , m_max_delay(max_delay)
+  {
+  }
+
+  ~SetBatcher()
+  {
+    if (m_thread.joinable()) {
+      stop();
+    }
+  }
+
+  SetBatcher(const SetBatcher&) = delete;
+  SetBatcher& operator=(const SetBatcher&) = delete;
+
+  /**
+   * @brief Start the deadline thread. Sets are passed to send, stamped with origin
+   */
+  void start(send_function_t send, const typename set_t::origin_t& origin, const std::string& thread_name)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_send = std::move(send);
+    m_set = set_t();
+    m_set.origin = origin;
+    m_next_seqno = 0;
+    m_running = true;
+    m_thread = std::thread(&SetBatcher::run_deadline, this);
+    pthread_setname_np(m_thread.native_handle(), thread_name.substr(0, 15).c_str());
+  }
+
+  /**
+   * @brief Send whatever is waiting, and stop the deadline thread
+   */
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running = false;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    send_locked();
+  }
+
+  /**
+   * @brief Add an object with the given data time, sending the Set first or after as needed
+   */
+  void add(T&& object, timestamp_t time)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_set.objects.empty() &&
+        std::max(m_set.end_time, time) - std::min(m_set.start_time, time) > m_max_time_span) {
+      send_locked();
+    }
+    if (m_set.objects.empty()) {
+      m_set.start_time = time;
+      m_set.end_time = time;
+      m_deadline = std::chrono::steady_clock::now() + m_max_delay;
+      m_cv.notify_all();
+    } else {
+      m_set.start_time = std::min(m_set.start_time, time);
+      m_set.end_time = std::max(m_set.end_time, time);
+    }
+    m_set.objects.push_back(std::move(object));
+    if (m_set.objects.size() >= m_max_objects) {
+      send_locked();
+    }
+  }
+
+  size_t max_objects() const { return m_max_objects; }
+  timestamp_t max_time_span() const { return m_max_time_span; }
+  std::chrono::microseconds max_delay() const { return m_max_delay; }
+
+private:
+  void send_locked()
+  {
+    if (m_set.objects.empty()) {
+      return;
+    }
+    set_t set;
+    set.origin = m_set.origin;
+    std::swap(set, m_set);
+    set.seqno = m_next_seqno++;
+    set.type = set_t::kPayload;
+    m_send(std::move(set));
+  }
+
+  void run_deadline()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+      if (m_set.objects.empty()) {
+        m_cv.wait(lock);
+      } else if (m_cv.wait_until(lock, m_deadline) == std::cv_status::timeout) {
+        // The Set may have been sent and restarted while we waited
+        if (!m_set.objects.empty() && std::chrono::steady_clock::now() >= m_deadline) {
+          send_locked();
+        }
+      }
+    }
+  }
+
+  size_t m_max_objects;
+  timestamp_t m_max_time_span;
+  std::chrono::microseconds m_max_delay;
+
+  send_function_t m_send;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::thread m_thread;
+  bool m_running{ false };
+
+  set_t m_set;
+  typename set_t::seqno_t m_next_seqno{ 0 };
+  std::chrono::steady_clock::time_point m_deadline;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_SETBATCHER_HPP_
@@ -0,0 +1,164 @@
+/**
+ * @file ShardedTAFinder.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_SHARDEDTAFINDER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_SHARDEDTAFINDER_HPP_
+
+#include "trigger/SPSCRing.hpp"
+
+#include "triggeralgs/TriggerActivity.hpp"
+#include "triggeralgs/TriggerPrimitive.hpp"
+#include "triggeralgs/Types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Runs independent TA finders over channel shards of one TP stream, on a thread each
+ *
+ * TPs are pushed from a single thread and go to shard
+ * (channel / channel_block) % n_shards, so e.g. a channel block the size of
+ * a plane shards by plane. Each shard runs its own finder instance on its
+ * own thread. A merge thread passes the TAs of all the shards on in the
+ * order of the TPs that closed them, as a single finder would have, even
+ * when the TP times are out of order: each TP is numbered as it is pushed,
+ * and a TA is only passed on once every other shard has either a later TA
+ * waiting or has processed all its TPs pushed before the one that closed it.
+ *
+ * The shard threads sleep while their queue is empty, and the merge thread
+ * while it has nothing to pass on. Whoever they wait for only takes a lock
+ * to wake them when they announced that they are about to sleep.
+ */
+class ShardedTAFinder
+{
+public:
+  using timestamp_t = triggeralgs::timestamp_t;
+  using metric_counter_type = uint64_t; // NOLINT(build/unsigned)
+
+  /// @brief Finds TAs in one TP, as TriggerActivityMaker::operator() does
+  using find_function_t =
+    std::function<void(const triggeralgs::TriggerPrimitive&, std::vector<triggeralgs::TriggerActivity>&)>;
+  /// @brief Makes the finder of one shard; called once per shard
+  using finder_factory_t = std::function<find_function_t()>;
+  using send_function_t = std::function<void(triggeralgs::TriggerActivity&&)>;
+
+  static constexpr size_t s_queue_capacity = 65536;
+  // How long a shard or merge thread sleeps before it looks again; pushes and stop wake it earlier
+  static constexpr std::chrono::milliseconds s_wait_timeout{ 10 };
+
+  ShardedTAFinder(const finder_factory_t& make_finder, size_t n_shards, uint32_t channel_block); // NOLINT(build/unsigned)
+  ~ShardedTAFinder();
+
+  ShardedTAFinder(const ShardedTAFinder&) = delete;
+  ShardedTAFinder& operator=(const ShardedTAFinder&) = delete;
+
+  /**
+   * @brief Start the shard and merge threads. TAs are passed to send on the merge thread
+   */
+  void start(send_function_t send, const std::string& thread_name);
+
+  /**
+   * @brief Find TAs in the TPs already pushed, pass them on, and stop the threads
+   */
+  void stop();
+
+  /**
+   * @brief Producer side: queue a TP for its shard. Waits for room if the shard is behind
+   */
+  void push(const triggeralgs::TriggerPrimitive& tp);
+
+  size_t shard_of(uint32_t channel) const { return (channel / m_channel_block) % m_shards.size(); } // NOLINT
+
+  size_t n_shards() const { return m_shards.size(); }
+
+  /// @brief Number of times a TP had to wait for room in its shard queue
+  metric_counter_type queue_full_count() const { return m_queue_full_count.load(); }
+
+private:
+  using sequence_t = uint64_t; // NOLINT(build/unsigned)
+
+  // A TP, with its number in the order of push
+  struct TaggedTP
+  {
+    sequence_t sequence{ 0 };
+    triggeralgs::TriggerPrimitive tp;
+  };
+
+  // A TA, with the number of the TP that closed it
+  struct TaggedTA
+  {
+    sequence_t tag{ 0 };
+    triggeralgs::TriggerActivity ta;
+  };
+
+  struct Shard
+  {
+    find_function_t find;
+    SPSCRing<TaggedTP> tps{ s_queue_capacity };
+    SPSCRing<TaggedTA> tas{ s_queue_capacity };
+    // The number of the latest TP pushed to this shard
+    alignas(64) std::atomic<sequence_t> pushed_sequence{ 0 };
+    // Every TP of this shard up to this number has been through the finder
+    alignas(64) std::atomic<sequence_t> processed_sequence{ 0 };
+    std::vector<triggeralgs::TriggerActivity> found;
+    std::thread thread;
+
+    alignas(64) std::atomic<bool> waiting{ false };
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+  };
+
+  // The earliest TA waiting in the merge stage, and up to which TP the shards
+  // without a TA waiting are known to have nothing earlier
+  struct MergeState
+  {
+    int earliest{ -1 };
+    sequence_t bound{ 0 };
+    // The shard that bound comes from; n_shards() for the latest TP pushed
+    size_t bound_shard{ 0 };
+  };
+
+  void run_shard(size_t index);
+  void run_merge();
+  MergeState scan(std::vector<TaggedTA>& heads, std::vector<char>& has_head);
+  // Wake the merge thread if it waits for a TA, or for source to reach sequence
+  void notify_merge(size_t source, sequence_t sequence, bool found_tas);
+
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  uint32_t m_channel_block; // NOLINT(build/unsigned)
+
+  send_function_t m_send;
+  std::atomic<bool> m_running{ false };
+  std::atomic<bool> m_shards_done{ false };
+  std::thread m_merge_thread;
+
+  // The number of the latest TP pushed to any shard
+  alignas(64) std::atomic<sequence_t> m_pushed_sequence{ 0 };
+  std::atomic<metric_counter_type> m_queue_full_count{ 0 };
+
+  // What the merge thread waits for: a TA from any shard, or the number its
+  // bound shard must reach. 0 while it is not waiting
+  alignas(64) std::atomic<sequence_t> m_merge_wait_sequence{ 0 };
+  std::atomic<size_t> m_merge_wait_shard{ 0 };
+  std::mutex m_merge_mutex;
+  std::condition_variable m_merge_cv;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_SHARDEDTAFINDER_HPP_
@@ -0,0 +1,278 @@
+/**
+ * @file SpillingSender.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_SPILLINGSENDER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_SPILLINGSENDER_HPP_
+
+#include "trigger/Issues.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/// @brief What became of an object handed on for sending
+enum class SendOutcome
+{
+  kSent,    ///< The output took it
+  kSpilled, ///< Waiting to be retried; sent or dropped later on
+  kDropped
+};
+
+/**
+ * @brief Wraps a non-blocking send so that backpressure costs neither drops nor warnings right away
+ *
+ * Objects the sender does not take at once go to a bounded spill ring, in
+ * order, and a thread of its own keeps retrying them. Until the ring is
+ * empty again new objects queue behind them. Only when the ring is full is
+ * an object dropped; drops are not reported one by one but summed up in one
+ * DroppedSummary warning per report interval, with their count and range of
+ * timestamps. With a capacity of 0 there is neither ring nor thread: objects
+ * the sender does not take are dropped straight away, and reported as they
+ * are dropped, at most once per report interval, and at stop.
+ *
+ * An object is only counted as sent once the send function took it. An
+ * object may stand for several items, e.g. a set of TAs or a TD made of
+ * several TCs, which are counted alongside.
+ *
+ * The send function is typically an iomanager sender's try_send with no
+ * timeout. A failed send must leave the object untouched, as the iomanager
+ * senders do, since it is retried.
+ */
+template<class T>
+class SpillingSender
+{
+public:
+  /// @brief Try to send an object without blocking; false if it was not taken
+  using try_send_function_t = std::function<bool(T&&)>;
+  using timestamp_t = uint64_t;         // NOLINT(build/unsigned)
+  using metric_counter_type = uint64_t; // NOLINT(build/unsigned)
+
+  static constexpr std::chrono::microseconds s_retry_interval{ 200 };
+
+  SpillingSender(const std::string& object_name,
+                 try_send_function_t try_send,
+                 size_t capacity,
+                 std::chrono::milliseconds report_interval)
+    : m_object_name(object_name)
+    , m_try_send(std::move(try_send))
+    , m_slots(capacity)
+    , m_report_interval(report_interval)
+  {
+  }
+
+  ~SpillingSender()
+  {
+    if (m_thread.joinable()) {
+      stop();
+    }
+  }
+
+  SpillingSender(const SpillingSender&) = delete;
+  SpillingSender& operator=(const SpillingSender&) = delete;
+
+  void start(const std::string& thread_name)
+  {
+    m_sent_count.store(0);
+    m_sent_item_count.store(0);
+    m_spilled_count.store(0);
+    m_dropped_count.store(0);
+    m_dropped_item_count.store(0);
+    m_next_report = std::chrono::steady_clock::now() + m_report_interval;
+    m_running = true;
+    if (!m_slots.empty()) {
+      m_thread = std::thread(&SpillingSender::run_retry, this);
+      pthread_setname_np(m_thread.native_handle(), thread_name.substr(0, 15).c_str());
+    }
+  }
+
+  /**
+   * @brief Retry the spilled objects one last time, drop the rest and report the drops
+   */
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+      m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drain_locked();
+    while (m_count > 0) {
+      record_drop_locked(m_slots[m_head].time, m_slots[m_head].n_items);
+      m_slots[m_head].object = T();
+      pop_locked();
+    }
+    report_drops_locked();
+  }
+
+  /**
+   * @brief Send an object, or spill it if the sender does not take it now
+   * @param n_items number of items the object stands for, in the item counts
+   * @return whether the object was sent, spilled or dropped. A spilled object
+   * may still be dropped later on: only sent_count() tells what was actually sent
+   */
+  SendOutcome send(T&& object, timestamp_t time, metric_counter_type n_items = 1)
+  {
+    if (m_occupancy.load(std::memory_order_acquire) == 0 && m_try_send(std::move(object))) {
+      record_sent(n_items);
+      return SendOutcome::kSent;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count == m_slots.size()) {
+      record_drop_locked(time, n_items);
+      // Without a ring there is no retry thread to report the drops
+      if (m_slots.empty() && std::chrono::steady_clock::now() >= m_next_report) {
+        report_drops_locked();
+      }
+      return SendOutcome::kDropped;
+    }
+    m_slots[(m_head + m_count) % m_slots.size()] = { std::move(object), time, n_items };
+    m_occupancy.store(++m_count, std::memory_order_release);
+    m_spilled_count++;
+    if (m_count == 1) {
+      m_cv.notify_all();
+    }
+    return SendOutcome::kSpilled;
+  }
+
+  /// @brief Number of objects waiting in the spill ring
+  size_t occupancy() const { return m_occupancy.load(std::memory_order_relaxed); }
+  size_t capacity() const { return m_slots.size(); }
+
+  /// @brief Objects sent, straight away or from the ring
+  metric_counter_type sent_count() const { return m_sent_count.load(); }
+  /// @brief Items of the objects sent
+  metric_counter_type sent_item_count() const { return m_sent_item_count.load(); }
+  /// @brief Objects that went through the spill ring
+  metric_counter_type spilled_count() const { return m_spilled_count.load(); }
+  /// @brief Objects dropped because the ring was full, or still in it at stop
+  metric_counter_type dropped_count() const { return m_dropped_count.load(); }
+  /// @brief Items of the objects dropped
+  metric_counter_type dropped_item_count() const { return m_dropped_item_count.load(); }
+
+private:
+  void run_retry()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+      drain_locked();
+      if (std::chrono::steady_clock::now() >= m_next_report) {
+        report_drops_locked();
+      }
+      if (m_count > 0) {
+        m_cv.wait_for(lock, s_retry_interval);
+      } else {
+        m_cv.wait_until(lock, m_next_report);
+      }
+    }
+  }
+
+  // Send from the front of the ring until the sender refuses one
+  void drain_locked()
+  {
+    while (m_count > 0) {
+      if (!m_try_send(std::move(m_slots[m_head].object))) {
+        return;
+      }
+      record_sent(m_slots[m_head].n_items);
+      pop_locked();
+    }
+  }
+
+  void pop_locked()
+  {
+    m_head = (m_head + 1) % m_slots.size();
+    m_occupancy.store(--m_count, std::memory_order_release);
+  }
+
+  void record_sent(metric_counter_type n_items)
+  {
+    m_sent_count++;
+    m_sent_item_count += n_items;
+  }
+
+  void record_drop_locked(timestamp_t time, metric_counter_type n_items)
+  {
+    m_dropped_count++;
+    m_dropped_item_count += n_items;
+    m_drops.count++;
+    m_drops.first_time = std::min(m_drops.first_time, time);
+    m_drops.last_time = std::max(m_drops.last_time, time);
+  }
+
+  void report_drops_locked()
+  {
+    auto now = std::chrono::steady_clock::now();
+    if (m_drops.count > 0) {
+      auto interval_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - (m_next_report - m_report_interval)).count();
+      ers::warning(DroppedSummary(
+        ERS_HERE, m_object_name, m_drops.count, m_drops.first_time, m_drops.last_time, interval_ms));
+      m_drops = DropSummary();
+    }
+    m_next_report = now + m_report_interval;
+  }
+
+  // Drops since the last report
+  struct DropSummary
+  {
+    metric_counter_type count{ 0 };
+    timestamp_t first_time{ std::numeric_limits<timestamp_t>::max() };
+    timestamp_t last_time{ 0 };
+  };
+
+  std::string m_object_name;
+  try_send_function_t m_try_send;
+
+  struct Spilled
+  {
+    T object;
+    timestamp_t time{ 0 };
+    metric_counter_type n_items{ 0 };
+  };
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<Spilled> m_slots;
+  size_t m_head{ 0 };
+  size_t m_count{ 0 };
+  std::atomic<size_t> m_occupancy{ 0 };
+
+  std::chrono::milliseconds m_report_interval;
+  std::chrono::steady_clock::time_point m_next_report;
+  DropSummary m_drops;
+
+  std::thread m_thread;
+  bool m_running{ false };
+
+  std::atomic<metric_counter_type> m_sent_count{ 0 };
+  std::atomic<metric_counter_type> m_sent_item_count{ 0 };
+  std::atomic<metric_counter_type> m_spilled_count{ 0 };
+  std::atomic<metric_counter_type> m_dropped_count{ 0 };
+  std::atomic<metric_counter_type> m_dropped_item_count{ 0 };
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_SPILLINGSENDER_HPP_
@@ -0,0 +1,99 @@
+/**
+ * @file TABatchFinder.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TABATCHFINDER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TABATCHFINDER_HPP_
+
+#include "trigger/CycleHistogram.hpp"
+
+#include "triggeralgs/TriggerActivity.hpp"
+#include "triggeralgs/TriggerActivityMaker.hpp"
+#include "triggeralgs/TriggerPrimitive.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Runs a TA maker over batches of TPs instead of one TP at a time
+ *
+ * TPs are copied into a contiguous batch as they arrive. Once the batch is
+ * full, find() runs the maker over the whole batch in one pass, into an
+ * output vector that is reused from one batch to the next. Not thread-safe;
+ * each post-processing thread owns its own finder, and whoever flushes a
+ * partial batch from another thread locks it. With a timing histogram,
+ * the maker calls are sampled into it one TP at a time.
+ */
+class TABatchFinder
+{
+public:
+  TABatchFinder(std::shared_ptr<triggeralgs::TriggerActivityMaker> maker,
+                size_t batch_size,
+                std::shared_ptr<CycleHistogram> timing = nullptr)
+    : m_maker(std::move(maker))
+    , m_batch_size(std::max<size_t>(batch_size, 1))
+    , m_timing(std::move(timing))
+  {
+    m_batch.reserve(m_batch_size);
+  }
+
+  /**
+   * @brief Add a TP to the batch
+   * @return true once the batch is full and find() should be called
+   */
+  bool add(const triggeralgs::TriggerPrimitive& tp)
+  {
+    m_batch.push_back(tp);
+    return m_batch.size() >= m_batch_size;
+  }
+
+  /**
+   * @brief Run the maker over the batched TPs, in arrival order, and empty the batch
+   * @return the TAs made from the batch, valid until the next call. They may be moved out.
+   */
+  std::vector<triggeralgs::TriggerActivity>& find()
+  {
+    m_tas.clear();
+    if (m_timing) {
+      for (const auto& tp : m_batch) {
+        m_timing->time([&]() { (*m_maker)(tp, m_tas); });
+      }
+    } else {
+      for (const auto& tp : m_batch) {
+        (*m_maker)(tp, m_tas);
+      }
+    }
+    m_batch.clear();
+    return m_tas;
+  }
+
+  /// @brief TPs waiting in the batch
+  const std::vector<triggeralgs::TriggerPrimitive>& batch() const { return m_batch; }
+
+  size_t size() const { return m_batch.size(); }
+
+  bool empty() const { return m_batch.empty(); }
+
+  size_t batch_size() const { return m_batch_size; }
+
+  const std::shared_ptr<triggeralgs::TriggerActivityMaker>& maker() const { return m_maker; }
+
+private:
+  std::shared_ptr<triggeralgs::TriggerActivityMaker> m_maker;
+  size_t m_batch_size;
+  std::shared_ptr<CycleHistogram> m_timing;
+  std::vector<triggeralgs::TriggerPrimitive> m_batch;
+  std::vector<triggeralgs::TriggerActivity> m_tas;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TABATCHFINDER_HPP_
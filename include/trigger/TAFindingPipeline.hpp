@@ -0,0 +1,219 @@
+/**
+ * @file TAFindingPipeline.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TAFINDINGPIPELINE_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TAFINDINGPIPELINE_HPP_
+
+#include "trigger/BroadcastRing.hpp"
+#include "trigger/CycleHistogram.hpp"
+#include "trigger/Latency.hpp"
+#include "trigger/ShardedTAFinder.hpp"
+#include "trigger/TABatchFinder.hpp"
+#include "trigger/TPFilter.hpp"
+#include "trigger/TriggerPrimitiveTypeAdapter.hpp"
+
+#include "triggeralgs/TriggerActivity.hpp"
+#include "triggeralgs/TriggerActivityMaker.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/// @brief How TPs are routed to the TA algorithms; see the TPDataProcessor attributes of the same names
+struct TAFindingConfig
+{
+  // TPs handed to each TA maker at a time. 1 runs the makers per TP
+  size_t tp_batch_size{ 1 };
+  // With more than one algorithm, the capacity of the broadcast ring they read the TPs from. 0 for no ring
+  size_t tp_broadcast_capacity{ 0 };
+  // Channel shards per algorithm, each with its own maker and thread
+  size_t ta_shards{ 1 };
+  uint32_t ta_shard_channel_block{ 256 }; // NOLINT(build/unsigned)
+  // Cuts on the TPs before the algorithms, applied in batches of this size
+  TPFilterConfig filter;
+  size_t tp_filter_batch_size{ 64 };
+  // A partial filter or TA finding batch is passed on once its first TP has waited this
+  // long, so a quiet stream does not hold TPs back. 0 holds them until the batch fills up, or stop
+  std::chrono::microseconds tp_batch_max_delay{ 1000 };
+  // Wait for the slowest algorithm when the broadcast ring is full, rather than dropping the TP
+  bool wait_for_broadcast_ring{ false };
+};
+
+/**
+ * @brief Routes TPs to the TA algorithms, and passes on the TAs they make
+ *
+ * This is the TP side of TPProcessor: the pre-filter and its batch, the
+ * broadcast ring with a thread per algorithm, channel-sharded finders and
+ * batched finders. Each algorithm is a task, called with one TP at a time.
+ * Without the ring, TPs that pass the filter go to the dispatch function,
+ * which hands them to every task: TPProcessor queues them for its
+ * post-processing threads, a benchmark may call the tasks in place. With
+ * the ring, the pipeline runs the tasks on threads of its own.
+ *
+ * TPs are pushed from a single thread. TAs are passed to the send function
+ * from the thread of the task that made them. With a batch delay, a thread
+ * of the pipeline flushes the batches that waited too long for more TPs:
+ * the filter batch then goes to the dispatch function, and the TAs of a
+ * TA finding batch to the send function, from that thread, under the lock
+ * of the batch.
+ */
+class TAFindingPipeline
+{
+public:
+  using tp_t = TriggerPrimitiveTypeAdapter;
+  using timestamp_t = triggeralgs::timestamp_t;
+  using metric_counter_type = uint64_t; // NOLINT(build/unsigned)
+
+  /// @brief The TA finding of one algorithm, for one TP
+  using task_t = std::function<void(const tp_t*)>;
+  /// @brief Makes a configured TA maker of the algorithm; called once per shard
+  using maker_factory_t = std::function<std::shared_ptr<triggeralgs::TriggerActivityMaker>()>;
+  /// @brief Makes the timing histogram of one maker; may be empty, for no timing
+  using histogram_factory_t = std::function<std::shared_ptr<CycleHistogram>()>;
+  using send_function_t = std::function<void(triggeralgs::TriggerActivity&&)>;
+  using dispatch_function_t = std::function<void(const tp_t*)>;
+
+  // TPs an algorithm thread takes from the ring before releasing their slots
+  static constexpr size_t s_max_tps_per_read = 256;
+  // How long an algorithm thread sleeps on an empty ring before it looks again; pushes and stop wake it earlier
+  static constexpr std::chrono::milliseconds s_ring_wait_timeout{ 10 };
+
+  TAFindingPipeline() = default;
+  ~TAFindingPipeline();
+
+  TAFindingPipeline(const TAFindingPipeline&) = delete;
+  TAFindingPipeline& operator=(const TAFindingPipeline&) = delete;
+
+  /**
+   * @brief Set up the routing, before any algorithm is added
+   * @throw InvalidConfiguration if the filter configuration is not valid
+   */
+  void configure(const TAFindingConfig& config);
+
+  /// @brief Add a TA algorithm, sharded or batched as configured
+  void add_algorithm(const maker_factory_t& make_maker, const histogram_factory_t& new_histogram = nullptr);
+
+  /// @brief Whether the algorithms read a broadcast ring on threads of their own, rather than the dispatched TPs
+  bool uses_broadcast_ring() const { return m_tasks.size() > 1 && m_config.tp_broadcast_capacity > 0; }
+
+  /// @brief The task of each algorithm, in the order they were added
+  const std::vector<task_t>& tasks() const { return m_tasks; }
+
+  /**
+   * @brief Start the threads of the ring, of the shards and of the batch flush
+   * @param latency Updated with the TPs going into the algorithms; nullptr for no latency monitoring
+   */
+  void start(send_function_t send_ta, dispatch_function_t dispatch, Latency* latency = nullptr);
+
+  /// @brief Filter a TP and route it to the algorithms
+  void push(const tp_t* item);
+
+  /// @brief Route the TPs waiting in the filter batch, without waiting for it to fill up
+  void flush_filter_batch();
+
+  /// @brief Stop flushing batches on time, before whatever the dispatch function hands TPs to stops
+  void stop_flusher();
+
+  /// @brief Pass on what the algorithm still holds back: a partial batch, or what its shards have not merged
+  void finish(size_t algorithm);
+
+  /**
+   * @brief Pass on everything, and stop the threads
+   *
+   * The TPs still in the filter batch go to the algorithms in place, or
+   * through the ring: the dispatch function is no longer called, since
+   * whoever it dispatches to may have stopped already.
+   */
+  void stop();
+
+  const TPFilter& filter() const { return m_filter; }
+  const TAFindingConfig& config() const { return m_config; }
+
+  /// @brief TPs into the algorithms, counted once per algorithm
+  metric_counter_type tp_received_count() const { return m_tp_received_count.load(); }
+  /// @brief TPs rejected by the pre-filter
+  metric_counter_type tp_filtered_count() const { return m_tp_filtered_count.load(); }
+  /// @brief TPs lost to every algorithm because the ring was full
+  metric_counter_type tp_broadcast_dropped_count() const { return m_tp_broadcast_dropped_count.load(); }
+  /// @brief Times a TP waited for room in the ring, with wait_for_broadcast_ring
+  metric_counter_type tp_broadcast_full_count() const { return m_tp_broadcast_full_count.load(); }
+  /// @brief Times a TP waited for room in a shard queue, over all the algorithms
+  metric_counter_type shard_queue_full_count() const;
+
+private:
+  // The finders of one algorithm; only the one in use exists
+  struct Algorithm
+  {
+    std::shared_ptr<triggeralgs::TriggerActivityMaker> maker;
+    std::shared_ptr<CycleHistogram> timing;
+    std::shared_ptr<TABatchFinder> batch_finder;
+    // Only locked with a batch finder; the wall time of the first TP in its batch
+    std::mutex batch_mutex;
+    std::chrono::steady_clock::time_point batch_start;
+    std::shared_ptr<ShardedTAFinder> sharded;
+    std::vector<triggeralgs::TriggerActivity> tas;
+    bool finished{ false };
+  };
+
+  void find_ta(const tp_t* tp, Algorithm& algorithm);
+  void find_ta_batch(const tp_t* tp, Algorithm& algorithm);
+  void process_ta_batch(TABatchFinder& finder);
+  void find_ta_sharded(const tp_t* tp, Algorithm& algorithm);
+  void update_latency_in(timestamp_t time)
+  {
+    if (m_latency) {
+      m_latency->update_latency_in(time);
+    }
+  }
+
+  void filter_tp_batch(bool stopping);
+  void dispatch_tp(const tp_t* item);
+  void run_ta_finder(size_t consumer);
+  void run_flusher();
+  void flush_stale_batches(std::chrono::steady_clock::time_point started_before);
+
+  TAFindingConfig m_config;
+  TPFilter m_filter;
+  // Only locked when TPs are filtered in batches
+  std::mutex m_filter_mutex;
+  std::vector<tp_t> m_filter_batch;
+  std::chrono::steady_clock::time_point m_filter_batch_start;
+
+  std::thread m_flusher;
+  std::mutex m_flusher_mutex;
+  std::condition_variable m_flusher_cv;
+  bool m_flusher_stop{ false };
+
+  std::vector<std::unique_ptr<Algorithm>> m_algorithms;
+  std::vector<task_t> m_tasks;
+
+  send_function_t m_send;
+  dispatch_function_t m_dispatch;
+  Latency* m_latency{ nullptr };
+
+  std::unique_ptr<BroadcastRing<tp_t>> m_ring;
+  std::vector<std::thread> m_ring_threads;
+  std::atomic<bool> m_running{ false };
+
+  std::atomic<metric_counter_type> m_tp_received_count{ 0 };
+  std::atomic<metric_counter_type> m_tp_filtered_count{ 0 };
+  std::atomic<metric_counter_type> m_tp_broadcast_dropped_count{ 0 };
+  std::atomic<metric_counter_type> m_tp_broadcast_full_count{ 0 };
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TAFINDINGPIPELINE_HPP_
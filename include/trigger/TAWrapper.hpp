@@ -15,13 +15,15 @@
 #include "triggeralgs/TriggerPrimitive.hpp"
 #include "triggeralgs/TriggerActivity.hpp"
 #include "trigger/Issues.hpp"
+#include "trigger/LazyOverlay.hpp"
 
 namespace dunedaq {
 namespace trigger {
   struct TAWrapper
   {
     triggeralgs::TriggerActivity activity;
-    std::vector<uint8_t> activity_overlay_buffer;
+    // Written on first access, as most TAs are never requested
+    LazyOverlay activity_overlay;
     
     // Don't really want this default ctor, but IterableQueueModel requires it
     TAWrapper() {}
@@ -29,13 +31,11 @@ namespace trigger {
     TAWrapper(triggeralgs::TriggerActivity a)
       : activity(a)
     {
-      populate_buffer();
     }
 
-    void populate_buffer()
+    std::vector<uint8_t>& populate_buffer() // NOLINT(build/unsigned)
     {
-      activity_overlay_buffer.resize(triggeralgs::get_overlay_nbytes(activity));
-      triggeralgs::write_overlay(activity, activity_overlay_buffer.data());
+      return activity_overlay.get(activity);
     }
     
     // comparable based on first timestamp
@@ -52,9 +52,10 @@ namespace trigger {
     void set_timestamp(uint64_t ts) // NOLINT(build/unsigned)
     {
       activity.time_start = ts;
+      activity_overlay.reset();
     }
 
-    size_t get_payload_size() { return activity_overlay_buffer.size(); }
+    size_t get_payload_size() { return triggeralgs::get_overlay_nbytes(activity); }
 
     size_t get_num_frames() { return 1; }
 
@@ -62,12 +63,13 @@ namespace trigger {
 
     TAWrapper* begin()
     {
-      return (TAWrapper*)(activity_overlay_buffer.data());
+      return (TAWrapper*)(populate_buffer().data());
     }
     
     TAWrapper* end()
     {
-      return (TAWrapper*)(activity_overlay_buffer.data()+activity_overlay_buffer.size());
+      auto& buffer = populate_buffer();
+      return (TAWrapper*)(buffer.data()+buffer.size());
     }
 
     static const constexpr daqdataformats::SourceID::Subsystem subsystem = daqdataformats::SourceID::Subsystem::kTrigger;
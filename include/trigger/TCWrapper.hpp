@@ -15,26 +15,37 @@
 #include "triggeralgs/TriggerActivity.hpp"
 #include "triggeralgs/TriggerCandidate.hpp"
 #include "trigger/Issues.hpp"
+#include "trigger/LazyOverlay.hpp"
 
 namespace dunedaq {
 namespace trigger {
     struct TCWrapper
   {
     triggeralgs::TriggerCandidate candidate;
-    std::vector<uint8_t> candidate_overlay_buffer;
+    // Written on first access, as most TCs are never requested
+    LazyOverlay candidate_overlay;
+    // Where the TC came from, for the TD builder's data-time watermark. A TC
+    // received on its own carries no source ID: the algorithm and detector of
+    // its maker stand in for it
+    uint64_t source{ 0 }; // NOLINT(build/unsigned)
     // Don't really want this default ctor, but IterableQueueModel requires it
     TCWrapper() {}
     
     TCWrapper(triggeralgs::TriggerCandidate c)
       : candidate(c)
+      , source((static_cast<uint64_t>(candidate.algorithm) << 16) | candidate.detid) // NOLINT(build/unsigned)
     {
-      populate_buffer();
     }
 
-    void populate_buffer()
+    // The TC came in a TCSet, whose origin is its source
+    void set_origin(const daqdataformats::SourceID& origin)
     {
-      candidate_overlay_buffer.resize(triggeralgs::get_overlay_nbytes(candidate));
-      triggeralgs::write_overlay(candidate, candidate_overlay_buffer.data());
+      source = (uint64_t(1) << 63) | (static_cast<uint64_t>(origin.subsystem) << 32) | origin.id; // NOLINT(build/unsigned)
+    }
+
+    std::vector<uint8_t>& populate_buffer() // NOLINT(build/unsigned)
+    {
+      return candidate_overlay.get(candidate);
     }
     
     // comparable based on first timestamp
@@ -51,9 +62,10 @@ namespace trigger {
     void set_timestamp(uint64_t ts) // NOLINT(build/unsigned)
     {
       candidate.time_start = ts;
+      candidate_overlay.reset();
     }
 
-    size_t get_payload_size() { return candidate_overlay_buffer.size(); }
+    size_t get_payload_size() { return triggeralgs::get_overlay_nbytes(candidate); }
 
     size_t get_num_frames() { return 1; }
 
@@ -61,12 +73,13 @@ namespace trigger {
 
     TCWrapper* begin()
     {
-      return (TCWrapper*)(candidate_overlay_buffer.data());
+      return (TCWrapper*)(populate_buffer().data());
     }
     
     TCWrapper* end()
     {
-      return (TCWrapper*)(candidate_overlay_buffer.data()+candidate_overlay_buffer.size());
+      auto& buffer = populate_buffer();
+      return (TCWrapper*)(buffer.data()+buffer.size());
     }
 
     //static const constexpr size_t fixed_payload_size = 5568;
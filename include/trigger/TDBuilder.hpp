@@ -0,0 +1,238 @@
+/**
+ * @file TDBuilder.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TDBUILDER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TDBUILDER_HPP_
+
+#include "trigger/DecisionRequestBuilder.hpp"
+#include "trigger/PendingTDIndex.hpp"
+#include "trigger/ROISampler.hpp"
+#include "trigger/SPSCRing.hpp"
+#include "trigger/SpillingSender.hpp"
+#include "trigger/TriggerBitwords.hpp"
+
+#include "dfmessages/TriggerDecision.hpp"
+#include "triggeralgs/TriggerCandidate.hpp"
+#include "triggeralgs/Types.hpp"
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Everything TDBuilder needs to know to turn TCs into TDs
+ *
+ * Plain values, so that the builder can be set up from the appmodel
+ * configuration in TCProcessor as well as directly by tests and benchmarks.
+ */
+struct TDBuilderConfig
+{
+  using TCType = triggeralgs::TriggerCandidate::Type;
+  using readout_window_t = std::pair<triggeralgs::timestamp_t, triggeralgs::timestamp_t>;
+
+  struct ROIGroup
+  {
+    int n_links;
+    double prob;
+    triggeralgs::timestamp_t time_window;
+    std::string mode;
+  };
+
+  bool hsi_passthrough{ false };
+  bool merge_overlapping_tcs{ false };
+  /// @brief Ignore TCs that overlap with already made TD
+  bool ignore_overlapping_tcs{ false };
+  /// @brief How long a TD waits for more TCs [ms]
+  int64_t buffer_timeout{ 100 };
+  int64_t td_readout_limit{ std::numeric_limits<int64_t>::max() };
+
+  std::map<TCType, readout_window_t> readout_map;
+  std::vector<unsigned int> ignored_tc_types;
+
+  bool use_bitwords{ false };
+  std::vector<std::string> trigger_bitwords;
+
+  bool close_on_watermark{ false };
+  triggeralgs::timestamp_t watermark_margin{ 0 };
+
+  std::vector<dfmessages::SourceID> mandatory_links;
+  std::map<int, std::vector<dfmessages::SourceID>> group_links;
+  std::vector<ROIGroup> roi_groups;
+  uint64_t roi_seed{ 0 }; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Groups TCs into TDs and hands the TDs on once they are ready
+ *
+ * TCs are pushed from a single producer thread into a queue. The builder
+ * thread started by start() owns the pending TDs: it drains the queue into
+ * them, and passes every TD that has expired (or, optionally, that the data
+ * has moved past) to the send function. Knows nothing about where the TDs
+ * go, so the same logic runs in TCProcessor and in standalone benchmarks.
+ */
+class TDBuilder
+{
+public:
+  using TCType = TDBuilderConfig::TCType;
+  using metric_counter_type = uint64_t; // NOLINT(build/unsigned)
+
+  /// @brief Sends a TD built from the pending TD, telling whether it was sent, spilled for later or dropped
+  using send_function_t = std::function<SendOutcome(dfmessages::TriggerDecision&&, const PendingTD&)>;
+
+  static constexpr size_t s_tc_queue_capacity = 16384;
+
+  /**
+   * @brief Counters for opmon. Written by the builder thread, read from anywhere
+   *
+   * A TD counts as sent only if the send function sent it right away. A
+   * spilled TD is counted apart, as only the sender knows whether it was
+   * sent or dropped in the end.
+   */
+  struct Counters
+  {
+    std::atomic<metric_counter_type> tds_created_count{ 0 };
+    std::atomic<metric_counter_type> tds_sent_count{ 0 };
+    std::atomic<metric_counter_type> tds_spilled_count{ 0 };
+    std::atomic<metric_counter_type> tds_dropped_count{ 0 };
+    std::atomic<metric_counter_type> tds_failed_bitword_count{ 0 };
+    std::atomic<metric_counter_type> tds_cleared_count{ 0 };
+
+    std::atomic<metric_counter_type> tds_created_tc_count{ 0 };
+    std::atomic<metric_counter_type> tds_sent_tc_count{ 0 };
+    std::atomic<metric_counter_type> tds_spilled_tc_count{ 0 };
+    std::atomic<metric_counter_type> tds_dropped_tc_count{ 0 };
+    std::atomic<metric_counter_type> tds_failed_bitword_tc_count{ 0 };
+    std::atomic<metric_counter_type> tds_cleared_tc_count{ 0 };
+
+    std::atomic<metric_counter_type> td_sender_wakeup_count{ 0 };
+    std::atomic<metric_counter_type> td_sender_lateness_total_us{ 0 };
+    std::atomic<metric_counter_type> td_sender_lateness_max_us{ 0 };
+    std::atomic<metric_counter_type> tc_queue_full_count{ 0 };
+    std::atomic<metric_counter_type> tds_watermark_closed_count{ 0 };
+    std::atomic<metric_counter_type> tc_rejected_count{ 0 };
+    std::atomic<metric_counter_type> tc_pileup_dropped_count{ 0 };
+    // TCs the builder thread is done adding: merged, in a new TD or dropped as pileup
+    std::atomic<metric_counter_type> tcs_added_count{ 0 };
+
+    void reset();
+  };
+
+  TDBuilder() = default;
+  ~TDBuilder();
+
+  TDBuilder(const TDBuilder&) = delete;
+  TDBuilder& operator=(const TDBuilder&) = delete;
+
+  /**
+   * @brief Apply a configuration. Not while running
+   * @throw InvalidConfiguration if a TC type does not fit in a TD bitword, or on a bad bitword
+   */
+  void configure(const TDBuilderConfig& config);
+
+  /**
+   * @brief Reset the counters and start the builder thread
+   */
+  void start(send_function_t send);
+
+  /**
+   * @brief Stop the builder thread and clear the TDs still pending
+   */
+  void stop();
+
+  bool is_running() const { return m_running_flag.load(); }
+
+  /**
+   * @brief Producer side: queue a TC for the builder thread
+   *
+   * If the queue is full, waits for room. A TC pushed while the builder is
+   * not running, or still waiting for room when it stops, is dropped and
+   * counted in tc_rejected_count.
+   */
+  void push(TCHandle&& tc);
+
+  bool is_ignored(unsigned int tc_type) const { return tc_type < s_n_tc_types && m_ignored_tc_mask[tc_type]; }
+
+  std::pair<triggeralgs::timestamp_t, triggeralgs::timestamp_t> get_tc_readout_window(const TCHandle& tc) const;
+
+  const TDBuilderConfig& config() const { return m_config; }
+
+  Counters& counters() { return m_counters; }
+  const Counters& counters() const { return m_counters; }
+
+private:
+  // TC types index the bits of the TD bitword, so per-type tables have 64 entries
+  static constexpr size_t s_n_tc_types = 64;
+
+  void send_trigger_decisions();
+  void wake_td_builder();
+  void reject_tc(const TCHandle& tc);
+
+  void add_tc(TCHandle tc);
+  void call_tc_decision(const PendingTD& pending_td);
+  dfmessages::TriggerDecision create_decision(const PendingTD& pending_td);
+  void roi_readout_make_requests(dfmessages::TriggerDecision& decision);
+  bool check_td_readout_length(const PendingTD& pending_td) const;
+  void clear_td_vectors();
+  std::vector<PendingTD> get_ready_tds();
+  static int get_earliest_tc_index(const PendingTD& pending_td);
+  static std::bitset<64> get_TD_bitword(const PendingTD& ready_td);
+
+  void compile_tc_type_tables();
+  void print_config() const;
+
+  void update_watermark(const TCHandle& tc);
+  triggeralgs::timestamp_t get_watermark() const;
+
+  TDBuilderConfig m_config;
+  bool m_use_bitwords{ false };
+  bool m_use_roi_readout{ false };
+
+  send_function_t m_send;
+  std::thread m_send_trigger_decisions_thread;
+  std::atomic<bool> m_running_flag{ false };
+
+  // TCs are queued by push(); the pending TDs are only touched by the TD
+  // builder thread (send_trigger_decisions)
+  SPSCRing<TCHandle> m_tc_queue{ s_tc_queue_capacity };
+  PendingTDIndex m_pending_tds;
+  std::mutex m_td_builder_mutex;
+  std::condition_variable m_cv;
+  std::atomic<bool> m_td_builder_sleeping{ false };
+
+  DecisionRequestBuilder m_request_builder;
+  ROISampler m_roi_sampler;
+  TriggerBitwords m_trigger_bitwords;
+
+  // Readout map and ignore list flattened into tables indexed by TC type
+  std::bitset<s_n_tc_types> m_readout_window_mask;
+  std::array<TDBuilderConfig::readout_window_t, s_n_tc_types> m_readout_window_table;
+  std::bitset<s_n_tc_types> m_ignored_tc_mask;
+
+  // Data-time watermark: the earliest of the latest TC times seen per source.
+  // TDs whose readout ends a margin before it are closed.
+  std::unordered_map<TCHandle::source_t, triggeralgs::timestamp_t> m_latest_tc_time;
+
+  Counters m_counters;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TDBUILDER_HPP_
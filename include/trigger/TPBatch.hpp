@@ -0,0 +1,331 @@
+/**
+ * @file TPBatch.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TPBATCH_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TPBATCH_HPP_
+
+#include "trgdataformats/TriggerPrimitive.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/// @brief Allocates on Alignment-byte boundaries, so that kernels can use aligned vector loads
+template<typename T, size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+  using value_type = T;
+
+  template<typename U>
+  struct rebind
+  {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template<typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) // NOLINT(runtime/explicit)
+  {}
+
+  T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+  void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+
+  template<typename U>
+  bool operator==(const AlignedAllocator<U, Alignment>&) const
+  {
+    return true;
+  }
+  template<typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment>&) const
+  {
+    return false;
+  }
+};
+
+/// @brief Read-only view of a contiguous column
+template<typename T>
+class ColumnView
+{
+public:
+  ColumnView(const T* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+  {}
+
+  const T* data() const { return m_data; }
+  size_t size() const { return m_size; }
+  const T& operator[](size_t i) const { return m_data[i]; }
+  const T* begin() const { return m_data; }
+  const T* end() const { return m_data + m_size; }
+
+private:
+  const T* m_data;
+  size_t m_size;
+};
+
+/// @brief Read-only view of one field of TPs stored as structs, e.g. the objects of a TPSet, without copying
+template<typename T>
+class FieldView
+{
+public:
+  FieldView(const unsigned char* first, size_t size, size_t stride)
+    : m_first(first)
+    , m_size(size)
+    , m_stride(stride)
+  {}
+
+  size_t size() const { return m_size; }
+  const T& operator[](size_t i) const { return *reinterpret_cast<const T*>(m_first + i * m_stride); }
+
+private:
+  const unsigned char* m_first;
+  size_t m_size;
+  size_t m_stride;
+};
+
+/**
+ * @brief The field Member of each TP in tps, e.g. field_view<&TriggerPrimitive::channel>(tpset.objects)
+ */
+template<auto Member>
+auto
+field_view(const std::vector<trgdataformats::TriggerPrimitive>& tps)
+{
+  using TP = trgdataformats::TriggerPrimitive;
+  using T = std::remove_cv_t<std::remove_reference_t<decltype(std::declval<TP>().*Member)>>;
+  if (tps.empty()) {
+    return FieldView<T>(nullptr, 0, sizeof(TP));
+  }
+  return FieldView<T>(reinterpret_cast<const unsigned char*>(&(tps.front().*Member)), tps.size(), sizeof(TP));
+}
+
+/**
+ * @brief TPs stored as one aligned array per field rather than one struct per TP
+ *
+ * A kernel that looks at a few fields, e.g. a filter on channel and time
+ * over threshold or an occupancy count, reads only those columns instead of
+ * pulling whole TPs through the cache. Iterating over a batch gives back
+ * TriggerPrimitive values, gathered from the columns, so a batch can be fed
+ * to a TA maker as it is:
+ *
+ *     for (auto tp : batch) { (*maker)(tp, tas); }
+ *
+ * The columns are filled from the objects of a TPSet, or any TP vector, by
+ * assign() or append(), and go back into one by copy_to(). Going the other
+ * way without copying, field_view() reads one field of a TP vector in place.
+ */
+class TPBatch
+{
+public:
+  using TriggerPrimitive = trgdataformats::TriggerPrimitive;
+
+  template<typename T>
+  using Column = std::vector<T, AlignedAllocator<T>>;
+
+  using time_start_t = decltype(TriggerPrimitive::time_start);
+  using time_peak_t = decltype(TriggerPrimitive::time_peak);
+  using time_over_threshold_t = decltype(TriggerPrimitive::time_over_threshold);
+  using channel_t = decltype(TriggerPrimitive::channel);
+  using adc_integral_t = decltype(TriggerPrimitive::adc_integral);
+  using adc_peak_t = decltype(TriggerPrimitive::adc_peak);
+  using detid_t = decltype(TriggerPrimitive::detid);
+  using type_t = decltype(TriggerPrimitive::type);
+  using algorithm_t = decltype(TriggerPrimitive::algorithm);
+  using version_t = decltype(TriggerPrimitive::version);
+  using flag_t = decltype(TriggerPrimitive::flag);
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = TriggerPrimitive;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = TriggerPrimitive;
+
+    const_iterator(const TPBatch* batch, size_t index)
+      : m_batch(batch)
+      , m_index(index)
+    {}
+
+    TriggerPrimitive operator*() const { return (*m_batch)[m_index]; }
+    const_iterator& operator++()
+    {
+      ++m_index;
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      const_iterator before = *this;
+      ++m_index;
+      return before;
+    }
+    const_iterator& operator+=(difference_type n)
+    {
+      m_index += n;
+      return *this;
+    }
+    const_iterator operator+(difference_type n) const { return const_iterator(m_batch, m_index + n); }
+    difference_type operator-(const const_iterator& other) const
+    {
+      return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+    }
+    bool operator==(const const_iterator& other) const { return m_index == other.m_index && m_batch == other.m_batch; }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+  private:
+    const TPBatch* m_batch;
+    size_t m_index;
+  };
+
+  TPBatch() = default;
+  explicit TPBatch(const std::vector<TriggerPrimitive>& tps) { assign(tps); }
+
+  size_t size() const { return m_time_start.size(); }
+  bool empty() const { return m_time_start.empty(); }
+
+  void clear()
+  {
+    m_time_start.clear();
+    m_time_peak.clear();
+    m_time_over_threshold.clear();
+    m_channel.clear();
+    m_adc_integral.clear();
+    m_adc_peak.clear();
+    m_detid.clear();
+    m_type.clear();
+    m_algorithm.clear();
+    m_version.clear();
+    m_flag.clear();
+  }
+
+  void reserve(size_t n)
+  {
+    m_time_start.reserve(n);
+    m_time_peak.reserve(n);
+    m_time_over_threshold.reserve(n);
+    m_channel.reserve(n);
+    m_adc_integral.reserve(n);
+    m_adc_peak.reserve(n);
+    m_detid.reserve(n);
+    m_type.reserve(n);
+    m_algorithm.reserve(n);
+    m_version.reserve(n);
+    m_flag.reserve(n);
+  }
+
+  void push_back(const TriggerPrimitive& tp)
+  {
+    m_time_start.push_back(tp.time_start);
+    m_time_peak.push_back(tp.time_peak);
+    m_time_over_threshold.push_back(tp.time_over_threshold);
+    m_channel.push_back(tp.channel);
+    m_adc_integral.push_back(tp.adc_integral);
+    m_adc_peak.push_back(tp.adc_peak);
+    m_detid.push_back(tp.detid);
+    m_type.push_back(tp.type);
+    m_algorithm.push_back(tp.algorithm);
+    m_version.push_back(tp.version);
+    m_flag.push_back(tp.flag);
+  }
+
+  size_t capacity() const { return m_time_start.capacity(); }
+
+  /// @brief Add the TPs of tps at the end of the batch
+  void append(const std::vector<TriggerPrimitive>& tps)
+  {
+    // Growing geometrically, as push_back would: appending many small TPSets
+    // must not reallocate all the columns every time
+    if (size() + tps.size() > capacity()) {
+      reserve(std::max(size() + tps.size(), 2 * capacity()));
+    }
+    for (auto& tp : tps) {
+      push_back(tp);
+    }
+  }
+
+  /// @brief Replace the batch with the TPs of tps, e.g. the objects of a TPSet. Reuses the columns' memory
+  void assign(const std::vector<TriggerPrimitive>& tps)
+  {
+    clear();
+    append(tps);
+  }
+
+  /// @brief Add the TPs of the batch at the end of tps, e.g. the objects of a TPSet
+  void copy_to(std::vector<TriggerPrimitive>& tps) const
+  {
+    if (tps.size() + size() > tps.capacity()) {
+      tps.reserve(std::max(tps.size() + size(), 2 * tps.capacity()));
+    }
+    for (size_t i = 0; i < size(); ++i) {
+      tps.push_back((*this)[i]);
+    }
+  }
+
+  /// @brief TP i, gathered from the columns
+  TriggerPrimitive operator[](size_t i) const
+  {
+    TriggerPrimitive tp;
+    tp.time_start = m_time_start[i];
+    tp.time_peak = m_time_peak[i];
+    tp.time_over_threshold = m_time_over_threshold[i];
+    tp.channel = m_channel[i];
+    tp.adc_integral = m_adc_integral[i];
+    tp.adc_peak = m_adc_peak[i];
+    tp.detid = m_detid[i];
+    tp.type = m_type[i];
+    tp.algorithm = m_algorithm[i];
+    tp.version = m_version[i];
+    tp.flag = m_flag[i];
+    return tp;
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  ColumnView<time_start_t> time_start() const { return view(m_time_start); }
+  ColumnView<time_peak_t> time_peak() const { return view(m_time_peak); }
+  ColumnView<time_over_threshold_t> time_over_threshold() const { return view(m_time_over_threshold); }
+  ColumnView<channel_t> channel() const { return view(m_channel); }
+  ColumnView<adc_integral_t> adc_integral() const { return view(m_adc_integral); }
+  ColumnView<adc_peak_t> adc_peak() const { return view(m_adc_peak); }
+  ColumnView<detid_t> detid() const { return view(m_detid); }
+  ColumnView<type_t> type() const { return view(m_type); }
+  ColumnView<algorithm_t> algorithm() const { return view(m_algorithm); }
+  ColumnView<version_t> version() const { return view(m_version); }
+  ColumnView<flag_t> flag() const { return view(m_flag); }
+
+private:
+  template<typename T>
+  static ColumnView<T> view(const Column<T>& column)
+  {
+    return ColumnView<T>(column.data(), column.size());
+  }
+
+  Column<time_start_t> m_time_start;
+  Column<time_peak_t> m_time_peak;
+  Column<time_over_threshold_t> m_time_over_threshold;
+  Column<channel_t> m_channel;
+  Column<adc_integral_t> m_adc_integral;
+  Column<adc_peak_t> m_adc_peak;
+  Column<detid_t> m_detid;
+  Column<type_t> m_type;
+  Column<algorithm_t> m_algorithm;
+  Column<version_t> m_version;
+  Column<flag_t> m_flag;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TPBATCH_HPP_
@@ -0,0 +1,160 @@
+/**
+ * @file TPFilter.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TPFILTER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TPFILTER_HPP_
+
+#include "trgdataformats/TriggerPrimitive.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+struct TPFilterConfig
+{
+  // Channels whose TPs are rejected, e.g. noisy ones
+  std::vector<uint32_t> masked_channels; // NOLINT(build/unsigned)
+
+  // Plane selection. Channels repeat with this period (e.g. 2560 channels
+  // per APA), and within a period the planes start at these channel offsets
+  // after the first plane (e.g. 800 and 1600 for U, V and X). Only the
+  // planes listed are kept, and at least one must be. A period of 0
+  // disables the plane selection.
+  uint32_t plane_period{ 0 };                // NOLINT(build/unsigned)
+  std::vector<uint32_t> plane_boundaries;    // NOLINT(build/unsigned)
+  std::vector<uint32_t> planes;              // NOLINT(build/unsigned)
+
+  // Time-over-threshold window [ticks] and ADC thresholds
+  uint32_t min_time_over_threshold{ 0 };                                        // NOLINT(build/unsigned)
+  uint32_t max_time_over_threshold{ std::numeric_limits<uint32_t>::max() };     // NOLINT(build/unsigned)
+  uint32_t min_adc_peak{ 0 };                                                   // NOLINT(build/unsigned)
+  uint32_t min_adc_integral{ 0 };                                               // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Rejects TPs on channel masks, plane, time over threshold and ADC before TA finding
+ *
+ * keep() judges one TP. select() judges a whole batch: the fields the cuts
+ * need are copied out into one contiguous array each, and the cuts run over
+ * those arrays eight TPs at a time with AVX2 where the CPU has it, or one
+ * at a time otherwise. Both give the same answers. select() may be called
+ * from several threads at once.
+ */
+class TPFilter
+{
+public:
+  using TriggerPrimitive = trgdataformats::TriggerPrimitive;
+
+  void configure(const TPFilterConfig& config);
+
+  /// @brief Whether any cut is configured at all
+  bool enabled() const { return m_enabled; }
+
+  bool keep(const TriggerPrimitive& tp) const
+  {
+    return keep_fields(tp.channel, saturate(tp.time_over_threshold), tp.adc_peak, tp.adc_integral);
+  }
+
+  /**
+   * @brief Drop the items whose TP fails the cuts, keeping the others in order
+   * @param get_tp gives the TP of an item
+   * @return the number of items dropped
+   */
+  template<class Item, class GetTP>
+  size_t select(std::vector<Item>& items, GetTP&& get_tp) const
+  {
+    thread_local Lanes lanes;
+    size_t n_items = items.size();
+    lanes.resize(n_items);
+    for (size_t i = 0; i < n_items; ++i) {
+      const TriggerPrimitive& tp = get_tp(items[i]);
+      lanes.channel[i] = tp.channel;
+      lanes.time_over_threshold[i] = saturate(tp.time_over_threshold);
+      lanes.adc_peak[i] = tp.adc_peak;
+      lanes.adc_integral[i] = tp.adc_integral;
+    }
+
+    mark(lanes, n_items);
+
+    size_t n_kept = 0;
+    for (size_t i = 0; i < n_items; ++i) {
+      if (lanes.keep[i]) {
+        if (n_kept != i) {
+          items[n_kept] = std::move(items[i]);
+        }
+        ++n_kept;
+      }
+    }
+    items.resize(n_kept);
+    return n_items - n_kept;
+  }
+
+  /// @brief Whether select() runs the AVX2 kernel on this CPU
+  static bool use_avx2();
+
+  /// @brief Force the one-TP-at-a-time kernel, e.g. to compare it with AVX2
+  void set_force_scalar(bool force_scalar) { m_force_scalar = force_scalar; }
+
+private:
+  // The fields the cuts look at, one array per field
+  struct Lanes
+  {
+    std::vector<uint32_t> channel;             // NOLINT(build/unsigned)
+    std::vector<uint32_t> time_over_threshold; // NOLINT(build/unsigned)
+    std::vector<uint32_t> adc_peak;            // NOLINT(build/unsigned)
+    std::vector<uint32_t> adc_integral;        // NOLINT(build/unsigned)
+    std::vector<uint8_t> keep;                 // NOLINT(build/unsigned)
+
+    void resize(size_t n)
+    {
+      channel.resize(n);
+      time_over_threshold.resize(n);
+      adc_peak.resize(n);
+      adc_integral.resize(n);
+      keep.resize(n);
+    }
+  };
+
+  template<class T>
+  static uint32_t saturate(T value) // NOLINT(build/unsigned)
+  {
+    return value > std::numeric_limits<uint32_t>::max() ? std::numeric_limits<uint32_t>::max() // NOLINT
+                                                         : static_cast<uint32_t>(value);    // NOLINT
+  }
+
+  bool keep_fields(uint32_t channel,             // NOLINT(build/unsigned)
+                   uint32_t time_over_threshold, // NOLINT(build/unsigned)
+                   uint32_t adc_peak,            // NOLINT(build/unsigned)
+                   uint32_t adc_integral) const; // NOLINT(build/unsigned)
+
+  void mark(Lanes& lanes, size_t n) const;
+  void mark_scalar(Lanes& lanes, size_t begin, size_t end) const;
+  void mark_avx2(Lanes& lanes, size_t n) const;
+
+  bool m_enabled{ false };
+  bool m_force_scalar{ false };
+
+  // One bit per channel below m_mask_words.size() * 32, set if masked
+  std::vector<uint32_t> m_mask_words; // NOLINT(build/unsigned)
+
+  uint32_t m_plane_period{ 0 };             // NOLINT(build/unsigned)
+  std::vector<uint32_t> m_plane_boundaries; // NOLINT(build/unsigned)
+  uint32_t m_kept_planes{ 0 };              // NOLINT(build/unsigned)
+
+  uint32_t m_min_time_over_threshold{ 0 }; // NOLINT(build/unsigned)
+  uint32_t m_max_time_over_threshold{ 0 }; // NOLINT(build/unsigned)
+  uint32_t m_min_adc_peak{ 0 };            // NOLINT(build/unsigned)
+  uint32_t m_min_adc_integral{ 0 };        // NOLINT(build/unsigned)
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TPFILTER_HPP_
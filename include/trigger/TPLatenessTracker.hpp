@@ -0,0 +1,108 @@
+/**
+ * @file TPLatenessTracker.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TPLATENESSTRACKER_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TPLATENESSTRACKER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief How late the TPs of one link arrive, in data ticks
+ *
+ * The lateness of a TP is how far its start time is behind the newest start
+ * time seen on the link when it is inserted. It goes into bucket i when it is
+ * in [2^i, 2^(i+1)) ticks. record() is called by the thread writing the
+ * latency buffer only; the counts are cumulative, and the reader, e.g. the
+ * request handler sizing its transmission delay, takes the difference of two
+ * snapshots to see the recent distribution.
+ *
+ * A TP is counted as late when it starts before the end of the TPSets
+ * already sent, which the request handler reports through set_sent_until().
+ */
+class TPLatenessTracker
+{
+public:
+  static constexpr size_t s_n_buckets = 48;
+
+  struct Snapshot
+  {
+    uint64_t count{ 0 };                          // NOLINT(build/unsigned)
+    std::array<uint64_t, s_n_buckets> buckets{};  // NOLINT(build/unsigned)
+
+    /// @brief The counts since earlier, a snapshot of the same tracker
+    Snapshot since(const Snapshot& earlier) const;
+
+    /// @brief The lateness below which a fraction q of the TPs are, interpolated within its bucket
+    uint64_t quantile(double q) const; // NOLINT(build/unsigned)
+  };
+
+  void record(uint64_t timestamp) // NOLINT(build/unsigned)
+  {
+    uint64_t newest = m_newest.load(std::memory_order_relaxed); // NOLINT(build/unsigned)
+    if (timestamp > newest) {
+      m_newest.store(timestamp, std::memory_order_relaxed);
+      newest = timestamp;
+    }
+    uint64_t lateness = newest - timestamp; // NOLINT(build/unsigned)
+    size_t bucket = lateness == 0 ? 0 : 63 - __builtin_clzll(lateness);
+    bucket = std::min(bucket, s_n_buckets - 1);
+    bump(m_buckets[bucket]);
+    bump(m_count);
+    if (timestamp < m_sent_until.load(std::memory_order_relaxed)) {
+      bump(m_late_count);
+    }
+  }
+
+  Snapshot snapshot() const
+  {
+    Snapshot snapshot;
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < s_n_buckets; ++i) {
+      snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+  void set_sent_until(uint64_t timestamp) { m_sent_until.store(timestamp, std::memory_order_relaxed); } // NOLINT
+
+  uint64_t late_count() const { return m_late_count.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+
+  /// @brief Forget the newest time stamp and the late TPs, e.g. at start. The buckets stay cumulative
+  void start_run()
+  {
+    m_newest.store(0, std::memory_order_relaxed);
+    m_sent_until.store(0, std::memory_order_relaxed);
+    m_late_count.store(0, std::memory_order_relaxed);
+  }
+
+  /// @brief The tracker of a link, by data handler UID, shared by its processor and its request handler
+  static std::shared_ptr<TPLatenessTracker> for_link(const std::string& link);
+
+private:
+  static void bump(std::atomic<uint64_t>& counter) // NOLINT(build/unsigned)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> m_newest{ 0 };     // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_sent_until{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_count{ 0 };      // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_late_count{ 0 }; // NOLINT(build/unsigned)
+  std::array<std::atomic<uint64_t>, s_n_buckets> m_buckets{}; // NOLINT(build/unsigned)
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TPLATENESSTRACKER_HPP_
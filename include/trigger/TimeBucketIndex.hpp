@@ -0,0 +1,128 @@
+/**
+ * @file TimeBucketIndex.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TIMEBUCKETINDEX_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TIMEBUCKETINDEX_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Coarse time index over a sorted buffer, one entry per 2^bucket_bits ticks
+ *
+ * The entry of a bucket is the last element before the bucket starts, kept as
+ * an Iterator into the buffer together with its time stamp. Every element of
+ * the bucket comes after it in the buffer, including ones inserted after the
+ * entry was made, so a window starting in the bucket is found by scanning
+ * forward from the entry: O(1) plus at most one bucket of elements, instead
+ * of a search from the head of the buffer.
+ *
+ * The index is built by one thread walking the buffer in time order, which
+ * calls record() for each element it passes. find() may be called from any
+ * thread. The index does not know when the buffer frees elements: whoever
+ * removes elements from the front of the buffer calls release() with the time
+ * stamp of the newest one removed, and find() no longer returns an entry at
+ * or before it, even if older elements are inserted at the head later on.
+ */
+template<class Iterator>
+class TimeBucketIndex
+{
+public:
+  using timestamp_t = uint64_t; // NOLINT(build/unsigned)
+
+  struct Entry
+  {
+    Iterator before;           // the last element before the bucket
+    timestamp_t before_time;   // and its time stamp
+  };
+
+  /// @param n_buckets buckets remembered, the newest ones; rounded up to a power of two
+  explicit TimeBucketIndex(unsigned bucket_bits = 16, size_t n_buckets = 4096)
+    : m_bucket_bits(bucket_bits)
+  {
+    size_t size = 1;
+    while (size < n_buckets) {
+      size <<= 1;
+    }
+    m_slots.resize(size);
+    m_mask = size - 1;
+  }
+
+  /// @brief Walker side: element it, with time stamp time, is the next one of the buffer in time order
+  void record(const Iterator& it, timestamp_t time)
+  {
+    timestamp_t bucket = time >> m_bucket_bits;
+    if (m_last && bucket > m_last_bucket) {
+      // The buckets from the last element's to this one's all start after the last element
+      std::lock_guard<std::mutex> lock(m_mutex);
+      timestamp_t first = std::max(m_last_bucket + 1, bucket > m_mask ? bucket - m_mask : 0);
+      for (timestamp_t b = first; b <= bucket; ++b) {
+        m_slots[b & m_mask] = Slot{ b, m_last };
+      }
+    }
+    m_last = Entry{ it, time };
+    m_last_bucket = bucket;
+  }
+
+  /// @brief The entry of the bucket holding time, if the walker has gone past the start of that bucket
+  std::optional<Entry> find(timestamp_t time) const
+  {
+    timestamp_t bucket = time >> m_bucket_bits;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& slot = m_slots[bucket & m_mask];
+    if (!slot.entry || slot.bucket != bucket || slot.entry->before_time <= m_released_until) {
+      return std::nullopt;
+    }
+    return slot.entry;
+  }
+
+  /// @brief The buffer removed its elements up to time, included: their entries are not to be used any more
+  void release(timestamp_t time)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_released_until = std::max(m_released_until, time);
+  }
+
+  /// @brief Forget everything, e.g. when the buffer is flushed. Walker side
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::fill(m_slots.begin(), m_slots.end(), Slot{});
+    m_released_until = 0;
+    m_last.reset();
+    m_last_bucket = 0;
+  }
+
+  timestamp_t bucket_ticks() const { return timestamp_t(1) << m_bucket_bits; }
+
+private:
+  struct Slot
+  {
+    timestamp_t bucket{ 0 };
+    std::optional<Entry> entry;
+  };
+
+  unsigned m_bucket_bits;
+  size_t m_mask{ 0 };
+  mutable std::mutex m_mutex;
+  std::vector<Slot> m_slots;
+  timestamp_t m_released_until{ 0 };
+
+  // Walker only
+  std::optional<Entry> m_last;
+  timestamp_t m_last_bucket{ 0 };
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TIMEBUCKETINDEX_HPP_
@@ -0,0 +1,155 @@
+/**
+ * @file TriggerBitwords.hpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef TRIGGER_INCLUDE_TRIGGER_TRIGGERBITWORDS_HPP_
+#define TRIGGER_INCLUDE_TRIGGER_TRIGGERBITWORDS_HPP_
+
+#include "trigger/Issues.hpp"
+
+#include "trgdataformats/TriggerCandidateData.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Compiled set of trigger bitwords
+ *
+ * Bit n of a TD word is set when a TC of type n contributed to the TD. A TD
+ * passes when, for at least one configured bitword, every bit of that
+ * bitword is also set in the TD word.
+ *
+ * Bitwords are configured as strings listing the TC types that must all be
+ * present, separated by commas, spaces, '&' or '+'. Each type is either a TC
+ * type name as used in the TC readout map (e.g. "kTiming") or a bit number,
+ * e.g. "kTiming & kSupernova" or "1,3".
+ */
+class TriggerBitwords
+{
+public:
+  using word_t = uint64_t; // NOLINT(build/unsigned)
+  static constexpr size_t s_n_bits = 64;
+
+  /**
+   * @brief Parse a single bitword string
+   * @throw InvalidConfiguration on an empty bitword, an unknown TC type or a bit that does not fit
+   */
+  static word_t parse(const std::string& bitword)
+  {
+    word_t word = 0;
+    size_t pos = 0;
+    while (pos < bitword.size()) {
+      if (is_separator(bitword[pos])) {
+        ++pos;
+        continue;
+      }
+      size_t end = pos;
+      while (end < bitword.size() && !is_separator(bitword[end])) {
+        ++end;
+      }
+      word |= word_t(1) << parse_bit(bitword.substr(pos, end - pos), bitword);
+      pos = end;
+    }
+    if (word == 0) {
+      throw InvalidConfiguration(ERS_HERE, "Trigger bitword '" + bitword + "' does not name any TC type");
+    }
+    return word;
+  }
+
+  /**
+   * @brief Replace the configured bitwords with the parsed strings
+   */
+  void configure(const std::vector<std::string>& bitwords)
+  {
+    m_words.clear();
+    m_words.reserve(bitwords.size());
+    for (const auto& bitword : bitwords) {
+      m_words.push_back(parse(bitword));
+    }
+  }
+
+  void add(word_t word) { m_words.push_back(word); }
+
+  const std::vector<word_t>& words() const { return m_words; }
+
+  bool empty() const { return m_words.empty(); }
+
+  size_t size() const { return m_words.size(); }
+
+  /**
+   * @brief Build the TD word from the types of its contributing TCs, in one pass
+   *
+   * TC types that do not fit in the word set no bit.
+   */
+  template<typename TCs>
+  static word_t make_td_word(const TCs& tcs)
+  {
+    word_t td_word = 0;
+    for (const auto& tc : tcs) {
+      size_t type = static_cast<size_t>(tc.type);
+      if (type < s_n_bits) {
+        td_word |= word_t(1) << type;
+      }
+    }
+    return td_word;
+  }
+
+  /**
+   * @brief Whether the TD word contains all the bits of at least one configured bitword
+   */
+  bool matches(word_t td_word) const
+  {
+    // A bitword is satisfied when none of its bits is missing from the TD word.
+    // No early exit, so the loop has no data-dependent branches.
+    bool match = false;
+    for (auto word : m_words) {
+      match |= ((word & ~td_word) == 0);
+    }
+    return match;
+  }
+
+private:
+  static bool is_separator(char c)
+  {
+    return std::isspace(static_cast<unsigned char>(c)) || c == ',' || c == '&' || c == '+';
+  }
+
+  static size_t parse_bit(const std::string& token, const std::string& bitword)
+  {
+    bool numeric = true;
+    for (char c : token) {
+      numeric = numeric && std::isdigit(static_cast<unsigned char>(c));
+    }
+
+    size_t bit = 0;
+    if (numeric) {
+      bit = (token.size() <= 2) ? std::stoul(token) : s_n_bits;
+    } else {
+      int type = trgdataformats::string_to_fragment_type_value(token);
+      if (type == static_cast<int>(trgdataformats::TriggerCandidateData::Type::kUnknown)) {
+        throw InvalidConfiguration(ERS_HERE, "Unknown TC type '" + token + "' in trigger bitword '" + bitword + "'");
+      }
+      bit = static_cast<size_t>(type);
+    }
+
+    if (bit >= s_n_bits) {
+      throw InvalidConfiguration(ERS_HERE, "TC type '" + token + "' in trigger bitword '" + bitword +
+                                             "' does not fit in a 64-bit TD word");
+    }
+    return bit;
+  }
+
+  std::vector<word_t> m_words;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_INCLUDE_TRIGGER_TRIGGERBITWORDS_HPP_
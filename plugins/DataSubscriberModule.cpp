@@ -20,6 +20,8 @@
 #include "trigger/TriggerPrimitiveTypeAdapter.hpp"
 #include "trigger/TAWrapper.hpp"
 #include "trigger/TCWrapper.hpp"
+#include "trigger/TASet.hpp"
+#include "trigger/TCSet.hpp"
 #include "trgdataformats/TriggerPrimitive.hpp"
 #include "triggeralgs/TriggerActivity.hpp"
 #include "triggeralgs/TriggerCandidate.hpp"
@@ -78,7 +80,7 @@ DataSubscriberModule::create_data_subscriber(const confmodel::DaqModule* cfg)
   auto datatypes = cfg->get_outputs()[0]->get_data_type();
   auto raw_dt = cfg->get_inputs()[0]->get_data_type();
   
-  if (raw_dt == "TPSet") {
+  if (raw_dt == "TPSet" || raw_dt == "PackedTPSet") {
     TLOG_DEBUG(1) << "Creating trigger primitives subscriber";
     auto source_model =
       std::make_shared<trigger::TPSetSourceModel>();
@@ -99,6 +101,21 @@ DataSubscriberModule::create_data_subscriber(const confmodel::DaqModule* cfg)
     return source_model;
   }
 
+  // Batched TAs and TCs are unbatched into the same wrappers as single ones
+  if (raw_dt == "TASet") {
+    TLOG_DEBUG(1) << "Creating trigger activity set subscriber";
+    auto source_model =
+      std::make_shared<trigger::TriggerSourceModel<trigger::TASet, trigger::TAWrapper>>();
+    return source_model;
+  }
+
+  if (raw_dt == "TCSet") {
+    TLOG_DEBUG(1) << "Creating trigger candidate set subscriber";
+    auto source_model =
+      std::make_shared<trigger::TriggerSourceModel<trigger::TCSet, trigger::TCWrapper>>();
+    return source_model;
+  }
+
    if (raw_dt == "HSIEvent") {
     TLOG_DEBUG(1) << "Creating trigger candidates subscriber";
     auto source_model =
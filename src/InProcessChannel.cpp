@@ -0,0 +1,54 @@
+/**
+ * @file InProcessChannel.cpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/InProcessChannel.hpp"
+
+#include <map>
+#include <mutex>
+
+namespace dunedaq::trigger {
+
+namespace {
+
+struct RegisteredChannel
+{
+  std::type_index type;
+  std::shared_ptr<void> channel;
+};
+
+std::mutex s_registry_mutex;
+std::map<std::string, RegisteredChannel> s_registry;
+
+} // namespace
+
+std::shared_ptr<void>
+InProcessChannelRegistry::find_untyped(const std::string& connection, std::type_index type)
+{
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  auto it = s_registry.find(connection);
+  if (it == s_registry.end() || it->second.type != type) {
+    return nullptr;
+  }
+  return it->second.channel;
+}
+
+std::shared_ptr<void>
+InProcessChannelRegistry::insert_untyped(const std::string& connection,
+                                         std::type_index type,
+                                         std::shared_ptr<void> channel)
+{
+  std::lock_guard<std::mutex> lock(s_registry_mutex);
+  // Whoever got there first wins
+  auto inserted = s_registry.emplace(connection, RegisteredChannel{ type, std::move(channel) });
+  if (inserted.first->second.type != type) {
+    return nullptr;
+  }
+  return inserted.first->second.channel;
+}
+
+} // namespace dunedaq::trigger
@@ -0,0 +1,283 @@
+/**
+ * @file PackedTPSet.cpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/PackedTPSet.hpp"
+#include "trigger/Issues.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace dunedaq::trigger {
+
+namespace {
+
+using TP = trgdataformats::TriggerPrimitive;
+
+constexpr uint8_t s_format_version = 1;  // NOLINT(build/unsigned)
+constexpr size_t s_max_varint_bytes = 10;
+// A TP takes at least one byte for each of its always-written fields
+constexpr size_t s_min_tp_bytes = 6;
+
+uint64_t // NOLINT(build/unsigned)
+zigzag(int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); // NOLINT(build/unsigned)
+}
+
+int64_t
+unzigzag(uint64_t value) // NOLINT(build/unsigned)
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Fields go on the wire as unsigned 64 bit values: enums as their underlying
+// type, signed fields zigzagged so that small negative values stay short
+template<typename F>
+uint64_t // NOLINT(build/unsigned)
+to_wire(F value)
+{
+  if constexpr (std::is_enum_v<F>) {
+    return to_wire(static_cast<std::underlying_type_t<F>>(value));
+  } else if constexpr (std::is_signed_v<F>) {
+    return zigzag(static_cast<int64_t>(value));
+  } else {
+    return static_cast<uint64_t>(value); // NOLINT(build/unsigned)
+  }
+}
+
+template<typename F>
+F
+from_wire(uint64_t value) // NOLINT(build/unsigned)
+{
+  if constexpr (std::is_enum_v<F>) {
+    return static_cast<F>(from_wire<std::underlying_type_t<F>>(value));
+  } else if constexpr (std::is_signed_v<F>) {
+    return static_cast<F>(unzigzag(value));
+  } else {
+    return static_cast<F>(value);
+  }
+}
+
+// The fields that are usually the same for all the TPs of a set. Each has a
+// bit in the set header telling whether it is written once or for every TP
+struct SetLevelField
+{
+  uint64_t (*get)(const TP&); // NOLINT(build/unsigned)
+  void (*set)(TP&, uint64_t); // NOLINT(build/unsigned)
+};
+
+const SetLevelField s_set_level_fields[] = {
+  { [](const TP& tp) { return to_wire(tp.detid); },
+    [](TP& tp, uint64_t value) { tp.detid = from_wire<decltype(tp.detid)>(value); } }, // NOLINT
+  { [](const TP& tp) { return to_wire(tp.type); },
+    [](TP& tp, uint64_t value) { tp.type = from_wire<decltype(tp.type)>(value); } }, // NOLINT
+  { [](const TP& tp) { return to_wire(tp.algorithm); },
+    [](TP& tp, uint64_t value) { tp.algorithm = from_wire<decltype(tp.algorithm)>(value); } }, // NOLINT
+  { [](const TP& tp) { return to_wire(tp.version); },
+    [](TP& tp, uint64_t value) { tp.version = from_wire<decltype(tp.version)>(value); } }, // NOLINT
+  { [](const TP& tp) { return to_wire(tp.flag); },
+    [](TP& tp, uint64_t value) { tp.flag = from_wire<decltype(tp.flag)>(value); } }, // NOLINT
+};
+constexpr size_t s_n_set_level_fields = sizeof(s_set_level_fields) / sizeof(s_set_level_fields[0]);
+
+// Header bytes, set-level values, and the bytes of the TPs at their longest
+constexpr size_t s_max_header_bytes = 2 + (8 + s_n_set_level_fields) * s_max_varint_bytes;
+constexpr size_t s_max_tp_bytes = (6 + s_n_set_level_fields) * s_max_varint_bytes;
+
+inline uint8_t* // NOLINT(build/unsigned)
+put_varint(uint8_t* out, uint64_t value) // NOLINT(build/unsigned)
+{
+  while (value >= 0x80) {
+    *out++ = static_cast<uint8_t>(value) | 0x80; // NOLINT(build/unsigned)
+    value >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(value); // NOLINT(build/unsigned)
+  return out;
+}
+
+// The encoding is written here at its longest, then copied out at its actual
+// length. A vector resized to the longest encoding would zero ~14 times the
+// bytes actually written, on every set
+class ScratchBuffer
+{
+public:
+  uint8_t* get(size_t size) // NOLINT(build/unsigned)
+  {
+    if (size > m_size) {
+      m_size = std::max(size, 2 * m_size);
+      // Not value-initialised: every byte used is written first
+      m_bytes.reset(new uint8_t[m_size]); // NOLINT(build/unsigned)
+    }
+    return m_bytes.get();
+  }
+
+private:
+  std::unique_ptr<uint8_t[]> m_bytes; // NOLINT(build/unsigned)
+  size_t m_size{ 0 };
+};
+
+class Reader
+{
+public:
+  Reader(const uint8_t* begin, const uint8_t* end) // NOLINT(build/unsigned)
+    : m_position(begin)
+    , m_end(end)
+  {}
+
+  uint8_t byte() // NOLINT(build/unsigned)
+  {
+    if (m_position == m_end) {
+      throw BadPackedTPSet(ERS_HERE, "truncated");
+    }
+    return *m_position++;
+  }
+
+  uint64_t varint() // NOLINT(build/unsigned)
+  {
+    uint64_t value = 0; // NOLINT(build/unsigned)
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = byte(); // NOLINT(build/unsigned)
+      value |= static_cast<uint64_t>(b & 0x7f) << shift; // NOLINT(build/unsigned)
+      if ((b & 0x80) == 0) {
+        return value;
+      }
+    }
+    throw BadPackedTPSet(ERS_HERE, "varint longer than 64 bits");
+  }
+
+  size_t remaining() const { return m_end - m_position; }
+
+private:
+  const uint8_t* m_position; // NOLINT(build/unsigned)
+  const uint8_t* m_end;      // NOLINT(build/unsigned)
+};
+
+} // namespace
+
+void
+pack(const TPSet& tpset, PackedTPSet& packed)
+{
+  auto& tps = tpset.objects;
+  thread_local ScratchBuffer scratch;
+  uint8_t* const begin = scratch.get(s_max_header_bytes + tps.size() * s_max_tp_bytes); // NOLINT(build/unsigned)
+  uint8_t* out = begin; // NOLINT(build/unsigned)
+
+  *out++ = s_format_version;
+  out = put_varint(out, tpset.seqno);
+  out = put_varint(out, tpset.run_number);
+  out = put_varint(out, to_wire(tpset.origin.subsystem));
+  out = put_varint(out, tpset.origin.id);
+  out = put_varint(out, to_wire(tpset.type));
+  out = put_varint(out, tpset.start_time);
+  out = put_varint(out, zigzag(static_cast<int64_t>(tpset.end_time - tpset.start_time)));
+  out = put_varint(out, tps.size());
+
+  if (!tps.empty()) {
+    uint8_t set_level_mask = 0; // NOLINT(build/unsigned)
+    for (size_t f = 0; f < s_n_set_level_fields; ++f) {
+      auto get = s_set_level_fields[f].get;
+      uint64_t first = get(tps.front()); // NOLINT(build/unsigned)
+      bool same = true;
+      for (size_t i = 1; same && i < tps.size(); ++i) {
+        same = get(tps[i]) == first;
+      }
+      if (same) {
+        set_level_mask |= 1 << f;
+      }
+    }
+    *out++ = set_level_mask;
+    for (size_t f = 0; f < s_n_set_level_fields; ++f) {
+      if (set_level_mask & (1 << f)) {
+        out = put_varint(out, s_set_level_fields[f].get(tps.front()));
+      }
+    }
+
+    auto previous_start = tpset.start_time;
+    for (auto& tp : tps) {
+      out = put_varint(out, zigzag(static_cast<int64_t>(tp.time_start - previous_start)));
+      out = put_varint(out, zigzag(static_cast<int64_t>(tp.time_peak - tp.time_start)));
+      out = put_varint(out, to_wire(tp.time_over_threshold));
+      out = put_varint(out, to_wire(tp.channel));
+      out = put_varint(out, to_wire(tp.adc_integral));
+      out = put_varint(out, to_wire(tp.adc_peak));
+      for (size_t f = 0; f < s_n_set_level_fields; ++f) {
+        if (!(set_level_mask & (1 << f))) {
+          out = put_varint(out, s_set_level_fields[f].get(tp));
+        }
+      }
+      previous_start = tp.time_start;
+    }
+  }
+  // Reuses the memory of packed.bytes
+  packed.bytes.assign(begin, out);
+}
+
+void
+unpack(const PackedTPSet& packed, TPSet& tpset)
+{
+  Reader in(packed.bytes.data(), packed.bytes.data() + packed.bytes.size());
+
+  auto version = in.byte();
+  if (version != s_format_version) {
+    throw BadPackedTPSet(ERS_HERE, "unknown format version " + std::to_string(version));
+  }
+  tpset.seqno = in.varint();
+  tpset.run_number = from_wire<decltype(tpset.run_number)>(in.varint());
+  tpset.origin.subsystem = from_wire<decltype(tpset.origin.subsystem)>(in.varint());
+  tpset.origin.id = from_wire<decltype(tpset.origin.id)>(in.varint());
+  tpset.type = from_wire<decltype(tpset.type)>(in.varint());
+  tpset.start_time = in.varint();
+  tpset.end_time = tpset.start_time + static_cast<uint64_t>(unzigzag(in.varint())); // NOLINT(build/unsigned)
+  uint64_t n_tps = in.varint(); // NOLINT(build/unsigned)
+  // Before making room for them, in case the count is garbage
+  if (n_tps > in.remaining() / s_min_tp_bytes) {
+    throw BadPackedTPSet(ERS_HERE, std::to_string(n_tps) + " TPs cannot fit in " +
+                                     std::to_string(in.remaining()) + " bytes");
+  }
+
+  tpset.objects.clear();
+  if (n_tps == 0) {
+    if (in.remaining() != 0) {
+      throw BadPackedTPSet(ERS_HERE, std::to_string(in.remaining()) + " trailing bytes after an empty TPSet");
+    }
+    return;
+  }
+  tpset.objects.reserve(n_tps);
+
+  uint8_t set_level_mask = in.byte(); // NOLINT(build/unsigned)
+  TP set_level_tp;
+  for (size_t f = 0; f < s_n_set_level_fields; ++f) {
+    if (set_level_mask & (1 << f)) {
+      s_set_level_fields[f].set(set_level_tp, in.varint());
+    }
+  }
+
+  auto previous_start = tpset.start_time;
+  for (uint64_t i = 0; i < n_tps; ++i) { // NOLINT(build/unsigned)
+    TP& tp = tpset.objects.emplace_back(set_level_tp);
+    tp.time_start = previous_start + static_cast<uint64_t>(unzigzag(in.varint())); // NOLINT(build/unsigned)
+    tp.time_peak = tp.time_start + static_cast<uint64_t>(unzigzag(in.varint()));   // NOLINT(build/unsigned)
+    tp.time_over_threshold = from_wire<decltype(tp.time_over_threshold)>(in.varint());
+    tp.channel = from_wire<decltype(tp.channel)>(in.varint());
+    tp.adc_integral = from_wire<decltype(tp.adc_integral)>(in.varint());
+    tp.adc_peak = from_wire<decltype(tp.adc_peak)>(in.varint());
+    for (size_t f = 0; f < s_n_set_level_fields; ++f) {
+      if (!(set_level_mask & (1 << f))) {
+        s_set_level_fields[f].set(tp, in.varint());
+      }
+    }
+    previous_start = tp.time_start;
+  }
+  if (in.remaining() != 0) {
+    throw BadPackedTPSet(ERS_HERE, std::to_string(in.remaining()) + " trailing bytes after the last TP");
+  }
+}
+
+} // namespace dunedaq::trigger
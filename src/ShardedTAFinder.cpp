@@ -0,0 +1,237 @@
+/**
+ * @file ShardedTAFinder.cpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/ShardedTAFinder.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <utility>
+
+namespace dunedaq::trigger {
+
+ShardedTAFinder::ShardedTAFinder(const finder_factory_t& make_finder,
+                                 size_t n_shards,
+                                 uint32_t channel_block) // NOLINT(build/unsigned)
+  : m_channel_block(std::max<uint32_t>(channel_block, 1)) // NOLINT(build/unsigned)
+{
+  n_shards = std::max<size_t>(n_shards, 1);
+  for (size_t i = 0; i < n_shards; ++i) {
+    m_shards.push_back(std::make_unique<Shard>());
+    m_shards.back()->find = make_finder();
+  }
+}
+
+ShardedTAFinder::~ShardedTAFinder()
+{
+  if (m_merge_thread.joinable()) {
+    stop();
+  }
+}
+
+void
+ShardedTAFinder::start(send_function_t send, const std::string& thread_name)
+{
+  m_send = std::move(send);
+  m_queue_full_count.store(0);
+  m_pushed_sequence.store(0);
+  m_merge_wait_sequence.store(0);
+  m_shards_done.store(false);
+  m_running.store(true);
+
+  for (size_t i = 0; i < m_shards.size(); ++i) {
+    auto& shard = *m_shards[i];
+    shard.pushed_sequence.store(0);
+    shard.processed_sequence.store(0);
+    shard.thread = std::thread(&ShardedTAFinder::run_shard, this, i);
+    pthread_setname_np(shard.thread.native_handle(), (thread_name + "-" + std::to_string(i)).substr(0, 15).c_str());
+  }
+  m_merge_thread = std::thread(&ShardedTAFinder::run_merge, this);
+  pthread_setname_np(m_merge_thread.native_handle(), (thread_name + "-m").substr(0, 15).c_str());
+}
+
+void
+ShardedTAFinder::stop()
+{
+  m_running.store(false);
+  for (auto& shard : m_shards) {
+    {
+      std::lock_guard<std::mutex> lock(shard->wait_mutex);
+      shard->wait_cv.notify_one();
+    }
+    shard->thread.join();
+  }
+  // The merge thread passes on whatever the shards left behind, then exits
+  m_shards_done.store(true);
+  {
+    std::lock_guard<std::mutex> lock(m_merge_mutex);
+    m_merge_cv.notify_one();
+  }
+  m_merge_thread.join();
+}
+
+void
+ShardedTAFinder::push(const triggeralgs::TriggerPrimitive& tp)
+{
+  auto& shard = *m_shards[shard_of(tp.channel)];
+  sequence_t sequence = m_pushed_sequence.load(std::memory_order_relaxed) + 1;
+  TaggedTP item{ sequence, tp };
+  if (!shard.tps.try_push(std::move(item))) {
+    m_queue_full_count++;
+    while (!shard.tps.try_push(std::move(item)) && m_running) {
+      std::this_thread::yield();
+    }
+  }
+  // Published after the TP, the shard's number before the overall one: the
+  // merge stage reads them the other way round, so a shard that it finds has
+  // processed all its TPs has nothing pending up to the overall number
+  shard.pushed_sequence.store(sequence, std::memory_order_release);
+  m_pushed_sequence.store(sequence, std::memory_order_release);
+
+  // Pairs with the fences of the shard and merge waits: either they see the
+  // TP before sleeping, or they are seen waiting here
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (shard.waiting.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(shard.wait_mutex);
+    shard.wait_cv.notify_one();
+  }
+  notify_merge(m_shards.size(), sequence, false);
+}
+
+void
+ShardedTAFinder::notify_merge(size_t source, sequence_t sequence, bool found_tas)
+{
+  sequence_t wait_sequence = m_merge_wait_sequence.load(std::memory_order_relaxed);
+  if (wait_sequence == 0) {
+    return;
+  }
+  if (found_tas || (sequence >= wait_sequence && m_merge_wait_shard.load(std::memory_order_relaxed) == source)) {
+    std::lock_guard<std::mutex> lock(m_merge_mutex);
+    m_merge_cv.notify_one();
+  }
+}
+
+void
+ShardedTAFinder::run_shard(size_t index)
+{
+  auto& shard = *m_shards[index];
+  TaggedTP item;
+  while (true) {
+    // Read the flag first, so that everything pushed before stop is processed
+    bool running = m_running.load();
+
+    if (!shard.tps.try_pop(item)) {
+      if (!running) {
+        break;
+      }
+      std::unique_lock<std::mutex> lock(shard.wait_mutex);
+      shard.waiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      shard.wait_cv.wait_for(lock, s_wait_timeout, [&] { return !shard.tps.empty() || !m_running.load(); });
+      shard.waiting.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    shard.found.clear();
+    shard.find(item.tp, shard.found);
+    bool found_tas = !shard.found.empty();
+    for (auto& ta : shard.found) {
+      TaggedTA tagged{ item.sequence, std::move(ta) };
+      while (!shard.tas.try_push(std::move(tagged))) {
+        std::this_thread::yield();
+      }
+    }
+    // After the TAs, so the merge stage never sees the number before the TAs
+    shard.processed_sequence.store(item.sequence, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    notify_merge(index, item.sequence, found_tas);
+  }
+}
+
+ShardedTAFinder::MergeState
+ShardedTAFinder::scan(std::vector<TaggedTA>& heads, std::vector<char>& has_head)
+{
+  size_t n_shards = m_shards.size();
+  MergeState state;
+  state.bound = std::numeric_limits<sequence_t>::max();
+  state.bound_shard = n_shards;
+
+  sequence_t pushed_sequence = m_pushed_sequence.load(std::memory_order_acquire);
+  for (size_t i = 0; i < n_shards; ++i) {
+    auto& shard = *m_shards[i];
+    if (!has_head[i]) {
+      sequence_t shard_pushed = shard.pushed_sequence.load(std::memory_order_acquire);
+      sequence_t processed = shard.processed_sequence.load(std::memory_order_acquire);
+      if (!shard.tas.try_pop(heads[i])) {
+        // A shard with no TP pending has nothing before the next TP pushed, to
+        // it or to any other shard; the pushing side is then what moves the bound
+        bool caught_up = processed >= shard_pushed;
+        sequence_t bound = caught_up ? pushed_sequence : processed;
+        if (bound < state.bound) {
+          state.bound = bound;
+          state.bound_shard = caught_up ? n_shards : i;
+        }
+        continue;
+      }
+      has_head[i] = true;
+    }
+    if (state.earliest == -1 || heads[i].tag < heads[state.earliest].tag) {
+      state.earliest = static_cast<int>(i);
+    }
+  }
+  return state;
+}
+
+void
+ShardedTAFinder::run_merge()
+{
+  size_t n_shards = m_shards.size();
+  std::vector<TaggedTA> heads(n_shards);
+  std::vector<char> has_head(n_shards, false);
+  auto releasable = [&heads](const MergeState& state) {
+    return state.earliest != -1 && heads[state.earliest].tag <= state.bound;
+  };
+
+  while (true) {
+    bool shards_done = m_shards_done.load();
+    MergeState state = scan(heads, has_head);
+
+    if (state.earliest != -1 && (releasable(state) || shards_done)) {
+      m_send(std::move(heads[state.earliest].ta));
+      has_head[state.earliest] = false;
+      continue;
+    }
+    if (state.earliest == -1 && shards_done) {
+      break;
+    }
+
+    // Sleep until a shard finds a TA, or the one that holds the earliest TA
+    // back gets past it. If what holds it back changes in the meantime, look
+    // again with the new target
+    std::unique_lock<std::mutex> lock(m_merge_mutex);
+    m_merge_wait_shard.store(state.bound_shard, std::memory_order_relaxed);
+    m_merge_wait_sequence.store(state.earliest == -1 ? std::numeric_limits<sequence_t>::max()
+                                                     : heads[state.earliest].tag,
+                                std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_merge_cv.wait_for(lock, s_wait_timeout, [&] {
+      if (m_shards_done.load()) {
+        return true;
+      }
+      MergeState next = scan(heads, has_head);
+      return releasable(next) || next.earliest != state.earliest ||
+             (next.earliest != -1 && next.bound_shard != state.bound_shard);
+    });
+    m_merge_wait_sequence.store(0, std::memory_order_relaxed);
+  }
+}
+
+} // namespace dunedaq::trigger
@@ -0,0 +1,361 @@
+/**
+ * @file TAFindingPipeline.cpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TAFindingPipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+
+namespace dunedaq::trigger {
+
+TAFindingPipeline::~TAFindingPipeline()
+{
+  if (m_running.load()) {
+    stop();
+  }
+}
+
+void
+TAFindingPipeline::configure(const TAFindingConfig& config)
+{
+  m_config = config;
+  m_config.tp_batch_size = std::max<size_t>(m_config.tp_batch_size, 1);
+  m_config.ta_shards = std::max<size_t>(m_config.ta_shards, 1);
+  m_config.tp_filter_batch_size = std::max<size_t>(m_config.tp_filter_batch_size, 1);
+  m_config.tp_batch_max_delay = std::max(m_config.tp_batch_max_delay, std::chrono::microseconds::zero());
+  m_filter.configure(m_config.filter);
+  m_filter_batch.clear();
+  m_filter_batch.reserve(m_config.tp_filter_batch_size);
+  m_algorithms.clear();
+  m_tasks.clear();
+}
+
+void
+TAFindingPipeline::add_algorithm(const maker_factory_t& make_maker, const histogram_factory_t& new_histogram)
+{
+  auto new_timing = [&new_histogram]() { return new_histogram ? new_histogram() : nullptr; };
+  m_algorithms.push_back(std::make_unique<Algorithm>());
+  auto& algorithm = *m_algorithms.back();
+
+  if (m_config.ta_shards > 1) {
+    // One maker per channel shard, each configured as the algorithm and timed on its own
+    auto make_finder = [&make_maker, &new_timing]() {
+      std::shared_ptr<triggeralgs::TriggerActivityMaker> shard_maker = make_maker();
+      auto shard_timing = new_timing();
+      if (!shard_timing) {
+        return ShardedTAFinder::find_function_t(
+          [shard_maker](const triggeralgs::TriggerPrimitive& tp, std::vector<triggeralgs::TriggerActivity>& tas) {
+            (*shard_maker)(tp, tas);
+          });
+      }
+      return ShardedTAFinder::find_function_t(
+        [shard_maker, shard_timing](const triggeralgs::TriggerPrimitive& tp,
+                                    std::vector<triggeralgs::TriggerActivity>& tas) {
+          shard_timing->time([&]() { (*shard_maker)(tp, tas); });
+        });
+    };
+    algorithm.sharded =
+      std::make_shared<ShardedTAFinder>(make_finder, m_config.ta_shards, m_config.ta_shard_channel_block);
+    m_tasks.push_back([this, &algorithm](const tp_t* tp) { find_ta_sharded(tp, algorithm); });
+    return;
+  }
+
+  algorithm.maker = make_maker();
+  algorithm.timing = new_timing();
+  if (m_config.tp_batch_size > 1) {
+    algorithm.batch_finder = std::make_shared<TABatchFinder>(algorithm.maker, m_config.tp_batch_size, algorithm.timing);
+    m_tasks.push_back([this, &algorithm](const tp_t* tp) { find_ta_batch(tp, algorithm); });
+  } else {
+    m_tasks.push_back([this, &algorithm](const tp_t* tp) { find_ta(tp, algorithm); });
+  }
+}
+
+void
+TAFindingPipeline::start(send_function_t send_ta, dispatch_function_t dispatch, Latency* latency)
+{
+  m_send = std::move(send_ta);
+  m_dispatch = std::move(dispatch);
+  m_latency = latency;
+  m_tp_received_count.store(0);
+  m_tp_filtered_count.store(0);
+  m_tp_broadcast_dropped_count.store(0);
+  m_tp_broadcast_full_count.store(0);
+  m_running.store(true);
+
+  for (size_t i = 0; i < m_algorithms.size(); ++i) {
+    auto& algorithm = *m_algorithms[i];
+    algorithm.finished = false;
+    if (algorithm.sharded) {
+      algorithm.sharded->start(m_send, "ta-" + std::to_string(i));
+    }
+  }
+
+  // One copy of each TP for all the algorithms, each reading it on a thread of its own
+  if (uses_broadcast_ring()) {
+    m_ring = std::make_unique<BroadcastRing<tp_t>>(m_config.tp_broadcast_capacity, m_tasks.size());
+    for (size_t i = 0; i < m_tasks.size(); ++i) {
+      m_ring_threads.emplace_back(&TAFindingPipeline::run_ta_finder, this, i);
+      pthread_setname_np(m_ring_threads.back().native_handle(), ("tp-ta-" + std::to_string(i)).c_str());
+    }
+  }
+
+  bool has_batches = (m_filter.enabled() && m_config.tp_filter_batch_size > 1) ||
+                     (m_config.tp_batch_size > 1 && m_config.ta_shards == 1 && !m_algorithms.empty());
+  if (has_batches && m_config.tp_batch_max_delay.count() > 0) {
+    m_flusher_stop = false;
+    m_flusher = std::thread(&TAFindingPipeline::run_flusher, this);
+    pthread_setname_np(m_flusher.native_handle(), "tp-batch-flush");
+  }
+}
+
+void
+TAFindingPipeline::push(const tp_t* item)
+{
+  // The filter only spares the algorithms: whatever holds the TP keeps it
+  if (m_filter.enabled()) {
+    if (m_config.tp_filter_batch_size > 1) {
+      std::lock_guard<std::mutex> lock(m_filter_mutex);
+      if (m_filter_batch.empty()) {
+        m_filter_batch_start = std::chrono::steady_clock::now();
+      }
+      m_filter_batch.push_back(*item);
+      if (m_filter_batch.size() >= m_config.tp_filter_batch_size) {
+        filter_tp_batch(false);
+      }
+      return;
+    }
+    if (!m_filter.keep(item->tp)) {
+      m_tp_filtered_count++;
+      return;
+    }
+  }
+  dispatch_tp(item);
+}
+
+void
+TAFindingPipeline::flush_filter_batch()
+{
+  std::lock_guard<std::mutex> lock(m_filter_mutex);
+  if (!m_filter_batch.empty()) {
+    filter_tp_batch(false);
+  }
+}
+
+void
+TAFindingPipeline::stop_flusher()
+{
+  if (!m_flusher.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_flusher_mutex);
+    m_flusher_stop = true;
+  }
+  m_flusher_cv.notify_all();
+  m_flusher.join();
+}
+
+void
+TAFindingPipeline::run_flusher()
+{
+  // Checking every half delay for batches started over half a delay ago, no TP waits a full delay
+  auto period = std::max(m_config.tp_batch_max_delay / 2, std::chrono::microseconds(1));
+  std::unique_lock<std::mutex> lock(m_flusher_mutex);
+  while (!m_flusher_cv.wait_for(lock, period, [this]() { return m_flusher_stop; })) {
+    flush_stale_batches(std::chrono::steady_clock::now() - period);
+  }
+}
+
+void
+TAFindingPipeline::flush_stale_batches(std::chrono::steady_clock::time_point started_before)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_filter_mutex);
+    if (!m_filter_batch.empty() && m_filter_batch_start <= started_before) {
+      filter_tp_batch(false);
+    }
+  }
+  for (auto& algorithm : m_algorithms) {
+    if (algorithm->batch_finder) {
+      std::lock_guard<std::mutex> lock(algorithm->batch_mutex);
+      if (!algorithm->batch_finder->empty() && algorithm->batch_start <= started_before) {
+        process_ta_batch(*algorithm->batch_finder);
+      }
+    }
+  }
+}
+
+void
+TAFindingPipeline::filter_tp_batch(bool stopping)
+{
+  m_tp_filtered_count +=
+    m_filter.select(m_filter_batch, [](const tp_t& item) -> const auto& { return item.tp; });
+  for (const auto& item : m_filter_batch) {
+    if (stopping && !m_ring) {
+      // Nothing is dispatched any more: run the algorithms here
+      for (auto& task : m_tasks) {
+        task(&item);
+      }
+    } else {
+      dispatch_tp(&item);
+    }
+  }
+  m_filter_batch.clear();
+}
+
+void
+TAFindingPipeline::dispatch_tp(const tp_t* item)
+{
+  if (!m_ring) {
+    m_dispatch(item);
+    return;
+  }
+  if (m_ring->try_push(*item)) {
+    return;
+  }
+  if (m_config.wait_for_broadcast_ring) {
+    m_tp_broadcast_full_count++;
+    while (!m_ring->try_push(*item)) {
+      std::this_thread::yield();
+    }
+    return;
+  }
+  // If the slowest algorithm is a ring behind, the TP is lost to all of them
+  m_tp_broadcast_dropped_count++;
+}
+
+void
+TAFindingPipeline::run_ta_finder(size_t consumer)
+{
+  auto& task = m_tasks[consumer];
+  auto find = [&task](const tp_t& tp) { task(&tp); };
+  while (true) {
+    // Read the flag first, so that everything pushed before stop is read. Once
+    // stopping, only what is left is read, without waiting for more
+    bool running = m_running.load();
+    size_t n_read = running ? m_ring->read_wait(consumer, find, s_max_tps_per_read, s_ring_wait_timeout)
+                            : m_ring->read(consumer, find, s_max_tps_per_read);
+    if (n_read == 0 && !running) {
+      break;
+    }
+  }
+}
+
+void
+TAFindingPipeline::find_ta(const tp_t* tp, Algorithm& algorithm)
+{
+  update_latency_in(tp->tp.time_start);
+  m_tp_received_count++;
+  auto& tas = algorithm.tas;
+  if (algorithm.timing) {
+    algorithm.timing->time([&]() { (*algorithm.maker)(tp->tp, tas); });
+  } else {
+    (*algorithm.maker)(tp->tp, tas);
+  }
+  while (tas.size()) {
+    m_send(std::move(tas.back()));
+    tas.pop_back();
+  }
+}
+
+void
+TAFindingPipeline::find_ta_batch(const tp_t* tp, Algorithm& algorithm)
+{
+  std::lock_guard<std::mutex> lock(algorithm.batch_mutex);
+  if (algorithm.batch_finder->empty()) {
+    algorithm.batch_start = std::chrono::steady_clock::now();
+  }
+  if (algorithm.batch_finder->add(tp->tp)) {
+    process_ta_batch(*algorithm.batch_finder);
+  }
+}
+
+void
+TAFindingPipeline::process_ta_batch(TABatchFinder& finder)
+{
+  // The input side is touched once per batch rather than once per TP
+  update_latency_in(finder.batch().back().time_start);
+  m_tp_received_count += finder.size();
+
+  for (auto& ta : finder.find()) {
+    m_send(std::move(ta));
+  }
+}
+
+void
+TAFindingPipeline::find_ta_sharded(const tp_t* tp, Algorithm& algorithm)
+{
+  update_latency_in(tp->tp.time_start);
+  m_tp_received_count++;
+  algorithm.sharded->push(tp->tp);
+}
+
+void
+TAFindingPipeline::finish(size_t index)
+{
+  auto& algorithm = *m_algorithms.at(index);
+  if (algorithm.finished) {
+    return;
+  }
+  algorithm.finished = true;
+  if (algorithm.sharded) {
+    // Nothing is pushed to the shards any more: let them finish and merge
+    algorithm.sharded->stop();
+  } else if (algorithm.batch_finder) {
+    std::lock_guard<std::mutex> lock(algorithm.batch_mutex);
+    if (!algorithm.batch_finder->empty()) {
+      process_ta_batch(*algorithm.batch_finder);
+    }
+  }
+}
+
+void
+TAFindingPipeline::stop()
+{
+  stop_flusher();
+
+  // TPs still waiting for the pre-filter go to the algorithms before they stop
+  {
+    std::lock_guard<std::mutex> lock(m_filter_mutex);
+    if (!m_filter_batch.empty()) {
+      filter_tp_batch(true);
+    }
+  }
+
+  m_running.store(false);
+
+  // The algorithm threads read what is left in the ring before they exit
+  if (m_ring) {
+    m_ring->wake();
+  }
+  for (auto& thread : m_ring_threads) {
+    thread.join();
+  }
+  m_ring_threads.clear();
+  m_ring.reset();
+
+  for (size_t i = 0; i < m_algorithms.size(); ++i) {
+    finish(i);
+  }
+}
+
+TAFindingPipeline::metric_counter_type
+TAFindingPipeline::shard_queue_full_count() const
+{
+  metric_counter_type count = 0;
+  for (auto& algorithm : m_algorithms) {
+    if (algorithm->sharded) {
+      count += algorithm->sharded->queue_full_count();
+    }
+  }
+  return count;
+}
+
+} // namespace dunedaq::trigger
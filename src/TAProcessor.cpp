@@ -6,6 +6,7 @@
  * received with this code.
  */
 #include "trigger/TAProcessor.hpp" // NOLINT(build/include)
+#include "trigger/ProcessorAttributes.hpp" // NOLINT(build/include)
 
 //#include "appfwk/DAQModuleHelper.hpp"
 #include "iomanager/Sender.hpp"
@@ -28,6 +29,9 @@
 #include "appmodel/TADataProcessor.hpp"
 #include "appmodel/TCAlgorithm.hpp"
 
+#include <algorithm>
+#include <chrono>
+
 using dunedaq::datahandlinglibs::logging::TLVL_BOOKKEEPING;
 using dunedaq::datahandlinglibs::logging::TLVL_TAKE_NOTE;
 
@@ -52,11 +56,20 @@ TAProcessor::start(const nlohmann::json& args)
   // Reset stats
   m_ta_received_count.store(0);
   m_tc_made_count.store(0);
-  m_tc_sent_count.store(0);
-  m_tc_failed_sent_count.store(0);
 
   m_running_flag.store(true);
 
+  if (m_tc_spill) {
+    m_tc_spill->start("tc-spill");
+  }
+  if (m_tc_set_spill) {
+    m_tc_set_spill->start("tc-set-spill");
+  }
+
+  if (m_tc_set_batcher) {
+    m_tc_set_batcher->start(std::bind(&TAProcessor::send_tc_set, this, std::placeholders::_1), m_sourceid, "tc-set");
+  }
+
   inherited::start(args);
 }
 
@@ -65,16 +78,36 @@ TAProcessor::stop(const nlohmann::json& args)
 {
   inherited::stop(args);
   m_running_flag.store(false);
+
+  // Every TC has been made: send the last TCSet
+  if (m_tc_set_batcher) {
+    m_tc_set_batcher->stop();
+  }
+
+  // Last retry of what backpressure left behind; what is still refused is dropped
+  if (m_tc_spill) {
+    m_tc_spill->stop();
+  }
+  if (m_tc_set_spill) {
+    m_tc_set_spill->stop();
+  }
   print_opmon_stats();
 }
 
 void
 TAProcessor::conf(const appmodel::DataHandlerModule* conf)
 {
+  std::string tc_connection;
+  std::string tc_set_connection;
   for (auto output : conf->get_outputs()) {
    try {
       if (output->get_data_type() == "TriggerCandidate") {
          m_tc_sink = get_iom_sender<triggeralgs::TriggerCandidate>(output->UID());
+         tc_connection = output->UID();
+      }
+      if (output->get_data_type() == "TCSet") {
+         m_tc_set_sink = get_iom_sender<TCSet>(output->UID());
+         tc_set_connection = output->UID();
       }
     } catch (const ers::Issue& excpt) {
       ers::error(datahandlinglibs::ResourceQueueError(ERS_HERE, "tc", "DefaultRequestHandlerModel", excpt));
@@ -88,6 +121,46 @@ TAProcessor::conf(const appmodel::DataHandlerModule* conf)
   auto proc_conf = dp->cast<appmodel::TADataProcessor>();
   if (proc_conf != nullptr && m_post_processing_enabled ) {
     tc_algorithms = proc_conf->get_algorithms();
+
+    // Tuning attributes; each defaults to the behaviour from before it existed
+    auto attributes = ProcessorAttributes::of(proc_conf);
+    m_timing_sample_period = attributes.get<uint32_t>("timing_sample_period", 0); // NOLINT(build/unsigned)
+    if (m_timing_sample_period > 0) {
+      TLOG() << "TC maker calls timed: 1 in " << m_timing_sample_period;
+    }
+
+    // TCs go out one by one unless a TCSet size is given
+    size_t tc_set_max_objects = attributes.get<size_t>("tc_set_max_objects", 0);
+    if (tc_set_max_objects > 0) {
+      if (m_tc_set_sink == nullptr) {
+        throw InvalidConfiguration(ERS_HERE, "TC output batching requires a TCSet output connection");
+      }
+      m_tc_set_batcher = std::make_unique<SetBatcher<triggeralgs::TriggerCandidate>>(
+        tc_set_max_objects,
+        attributes.get<uint64_t>("tc_set_max_time_span", 62500), // NOLINT(build/unsigned)
+        std::chrono::microseconds(attributes.get<int64_t>("tc_set_max_delay_us", 1000, 0)));
+      TLOG() << "TCs sent in TCSets of up to " << m_tc_set_batcher->max_objects() << " TCs, "
+             << m_tc_set_batcher->max_time_span() << " ticks and " << m_tc_set_batcher->max_delay().count() << " us";
+    }
+
+    // What the output connection does not take right away is dropped, unless spill_capacity
+    // sets up a ring to retry it from. A receiver in this process is sent to by move, skipping
+    // serialization
+    size_t spill_capacity = attributes.get<size_t>("spill_capacity", 0);
+    std::chrono::milliseconds drop_report_interval(attributes.get<int64_t>("drop_report_interval_ms", 1000, 1));
+    if (m_tc_set_batcher) {
+      m_tc_set_spill = std::make_unique<SpillingSender<TCSet>>(
+        "TCSet",
+        make_try_send<TCSet>(tc_set_connection, m_tc_set_sink),
+        spill_capacity,
+        drop_report_interval);
+    } else {
+      m_tc_spill = std::make_unique<SpillingSender<triggeralgs::TriggerCandidate>>(
+        "TC",
+        make_try_send<triggeralgs::TriggerCandidate>(tc_connection, m_tc_sink),
+        spill_capacity,
+        drop_report_interval);
+    }
     }
 
   for (auto algo : tc_algorithms)  {
@@ -95,8 +168,11 @@ TAProcessor::conf(const appmodel::DataHandlerModule* conf)
     std::shared_ptr<triggeralgs::TriggerCandidateMaker> maker = make_tc_maker(algo->class_name());
     nlohmann::json algo_json = algo->to_json(true);
     maker->configure(algo_json[algo->UID()]);
-    inherited::add_postprocess_task(std::bind(&TAProcessor::find_tc, this, std::placeholders::_1, maker));
+    AlgorithmTiming timing{ algo->UID(), {} };
+    inherited::add_postprocess_task(std::bind(
+      &TAProcessor::find_tc, this, std::placeholders::_1, maker, timing.add_histogram(m_timing_sample_period)));
     m_tcms.push_back(maker);
+    m_tc_timings.push_back(std::move(timing));
   }
   m_latency_monitoring.store( dp->get_latency_monitoring() );
   inherited::conf(conf);
@@ -109,11 +185,25 @@ TAProcessor::generate_opmon_data()
 
   info.set_ta_received_count( m_ta_received_count.load() );
   info.set_tc_made_count( m_tc_made_count.load() );
-  info.set_tc_sent_count( m_tc_sent_count.load() );
-  info.set_tc_failed_sent_count( m_tc_failed_sent_count.load() );
+  info.set_tc_sent_count( tc_sent_count() );
+  info.set_tc_failed_sent_count( tc_failed_sent_count() );
+  info.set_tc_set_sent_count( m_tc_set_spill ? m_tc_set_spill->sent_count() : 0 );
+  if (m_tc_spill) {
+    info.set_tc_spilled_count( m_tc_spill->spilled_count() );
+    info.set_tc_spill_occupancy( m_tc_spill->occupancy() );
+  } else if (m_tc_set_spill) {
+    info.set_tc_spilled_count( m_tc_set_spill->spilled_count() );
+    info.set_tc_spill_occupancy( m_tc_set_spill->occupancy() );
+  }
 
   this->publish(std::move(info));
 
+  if (m_timing_sample_period > 0) {
+    for (auto& timing : m_tc_timings) {
+      this->publish( timing.opmon_info(), {{"algorithm", timing.algorithm}} );
+    }
+  }
+
   if ( m_latency_monitoring.load() && m_running_flag.load() ) {
     opmon::TriggerLatency lat_info;
 
@@ -128,26 +218,57 @@ TAProcessor::generate_opmon_data()
  * Pipeline Stage 2.: Do software TPG
  * */
 void
-TAProcessor::find_tc(const TAWrapper* ta,  std::shared_ptr<triggeralgs::TriggerCandidateMaker> tca)
+TAProcessor::find_tc(const TAWrapper* ta,
+                     std::shared_ptr<triggeralgs::TriggerCandidateMaker> tca,
+                     std::shared_ptr<CycleHistogram> timing)
 {
   //time_activity gave 0 :/
   if (m_latency_monitoring.load()) m_latency_instance.update_latency_in( ta->activity.time_start );
   m_ta_received_count++;
   std::vector<triggeralgs::TriggerCandidate> tcs;
-  tca->operator()(ta->activity, tcs);
+  timing->time([&]() { tca->operator()(ta->activity, tcs); });
   for (auto tc : tcs) {
     m_tc_made_count++;
     if (m_latency_monitoring.load()) m_latency_instance.update_latency_out( tc.time_candidate );
-    if(!m_tc_sink->try_send(std::move(tc), iomanager::Sender::s_no_block)) {
-        ers::warning(TCDropped(ERS_HERE, tc.time_start, m_sourceid.id));
-        m_tc_failed_sent_count++;
-    } else {
-      m_tc_sent_count++;
+    if (m_tc_set_batcher) {
+      auto tc_time_candidate = tc.time_candidate;
+      m_tc_set_batcher->add(std::move(tc), tc_time_candidate);
+      continue;
     }
+    // The spilling sender counts what it sent and dropped, and reports drops as a periodic summary
+    auto tc_time_start = tc.time_start;
+    m_tc_spill->send(std::move(tc), tc_time_start);
   }
   return;
 }
 
+void
+TAProcessor::send_tc_set(TCSet&& tc_set)
+{
+  metric_counter_type n_tcs = tc_set.objects.size();
+  auto set_start_time = tc_set.start_time;
+  m_tc_set_spill->send(std::move(tc_set), set_start_time, n_tcs);
+}
+
+TAProcessor::metric_counter_type
+TAProcessor::tc_sent_count() const
+{
+  // Only what the output took: spilled TCs may still be dropped at stop
+  if (m_tc_set_spill) {
+    return m_tc_set_spill->sent_item_count();
+  }
+  return m_tc_spill ? m_tc_spill->sent_count() : 0;
+}
+
+TAProcessor::metric_counter_type
+TAProcessor::tc_failed_sent_count() const
+{
+  if (m_tc_set_spill) {
+    return m_tc_set_spill->dropped_item_count();
+  }
+  return m_tc_spill ? m_tc_spill->dropped_count() : 0;
+}
+
 void
 TAProcessor::print_opmon_stats()
 {
@@ -155,8 +276,9 @@ TAProcessor::print_opmon_stats()
   TLOG() << "------------------------------";
   TLOG() << "TAs received: \t\t" << m_ta_received_count;
   TLOG() << "TCs made: \t\t\t" << m_tc_made_count;
-  TLOG() << "TCs sent: \t\t\t" << m_tc_sent_count;
-  TLOG() << "TCs failed to send: \t" << m_tc_failed_sent_count;
+  TLOG() << "TCs sent: \t\t\t" << tc_sent_count();
+  TLOG() << "TCs failed to send: \t" << tc_failed_sent_count();
+  TLOG() << "TCSets sent: \t\t" << (m_tc_set_spill ? m_tc_set_spill->sent_count() : 0);
   TLOG();
 }
 
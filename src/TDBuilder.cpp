@@ -0,0 +1,554 @@
+/**
+ * @file TDBuilder.cpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TDBuilder.hpp"
+#include "trigger/Issues.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <numeric>
+
+namespace dunedaq::trigger {
+
+void
+TDBuilder::Counters::reset()
+{
+  tds_created_count.store(0);
+  tds_sent_count.store(0);
+  tds_spilled_count.store(0);
+  tds_dropped_count.store(0);
+  tds_failed_bitword_count.store(0);
+  tds_cleared_count.store(0);
+  tds_created_tc_count.store(0);
+  tds_sent_tc_count.store(0);
+  tds_spilled_tc_count.store(0);
+  tds_dropped_tc_count.store(0);
+  tds_failed_bitword_tc_count.store(0);
+  tds_cleared_tc_count.store(0);
+  td_sender_wakeup_count.store(0);
+  td_sender_lateness_total_us.store(0);
+  td_sender_lateness_max_us.store(0);
+  tc_queue_full_count.store(0);
+  tds_watermark_closed_count.store(0);
+  tc_rejected_count.store(0);
+  tc_pileup_dropped_count.store(0);
+  tcs_added_count.store(0);
+}
+
+TDBuilder::~TDBuilder()
+{
+  if (m_send_trigger_decisions_thread.joinable()) {
+    stop();
+  }
+}
+
+void
+TDBuilder::configure(const TDBuilderConfig& config)
+{
+  m_config = config;
+
+  // Component requests are the same for every TD, only the windows change
+  m_request_builder.configure(m_config.mandatory_links, m_config.group_links);
+
+  m_use_roi_readout = !m_config.roi_groups.empty();
+  if (m_use_roi_readout) {
+    std::vector<double> roi_probs;
+    for (const auto& group : m_config.roi_groups) {
+      roi_probs.push_back(group.prob);
+    }
+    m_roi_sampler.configure(roi_probs, static_cast<int>(m_config.group_links.size()), m_config.roi_seed);
+  }
+
+  // Per TC type readout windows and ignore flags
+  compile_tc_type_tables();
+
+  m_use_bitwords = m_config.use_bitwords;
+  if (m_use_bitwords) {
+    m_trigger_bitwords.configure(m_config.trigger_bitwords);
+    if (m_trigger_bitwords.empty()) {
+      TLOG() << "Warning, bitwords enabled but none configured, they won't be used!";
+      m_use_bitwords = false;
+    }
+  }
+
+  print_config();
+}
+
+void
+TDBuilder::start(send_function_t send)
+{
+  m_send = std::move(send);
+  m_counters.reset();
+  m_latest_tc_time.clear();
+
+  m_running_flag.store(true);
+  m_send_trigger_decisions_thread = std::thread(&TDBuilder::send_trigger_decisions, this);
+  pthread_setname_np(m_send_trigger_decisions_thread.native_handle(), "mlt-dec"); // TODO: originally mlt-trig-dec
+}
+
+void
+TDBuilder::stop()
+{
+  m_running_flag.store(false);
+
+  // Make sure condition_variable knows we flipped running flag
+  {
+    std::lock_guard<std::mutex> lock(m_td_builder_mutex);
+    m_cv.notify_all();
+  }
+
+  // Wait for the TD-building thread to stop
+  m_send_trigger_decisions_thread.join();
+
+  // Drop all TDs in vectors at run stage change. Have to do this
+  // after joining m_send_trigger_decisions_thread, which owns them
+  clear_td_vectors();
+
+  // A TC pushed while the builder thread was finishing is not left behind unaccounted
+  TCHandle tc;
+  while (m_tc_queue.try_pop(tc)) {
+    reject_tc(tc);
+  }
+}
+
+void
+TDBuilder::push(TCHandle&& tc)
+{
+  // Once stopped there is no builder thread left to take the TC
+  if (!m_running_flag) {
+    reject_tc(tc);
+    return;
+  }
+
+  // Hand the TC over to the TD builder thread, which owns the pending TDs
+  if (!m_tc_queue.try_push(std::move(tc))) {
+    m_counters.tc_queue_full_count++;
+    wake_td_builder();
+    while (!m_tc_queue.try_push(std::move(tc))) {
+      if (!m_running_flag) {
+        reject_tc(tc);
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+  wake_td_builder();
+}
+
+void
+TDBuilder::reject_tc(const TCHandle& tc)
+{
+  // Only the first TC turned away after a stop is logged, the others are counted
+  if (m_counters.tc_rejected_count++ == 0) {
+    TLOG() << "TD builder is not running, dropping TC of type " << static_cast<int>(tc.type) << " at time "
+           << tc.time_candidate << "; further TCs are only counted";
+  } else {
+    TLOG_DEBUG(3) << "TD builder is not running, dropping TC of type " << static_cast<int>(tc.type) << " at time "
+                  << tc.time_candidate;
+  }
+}
+
+void
+TDBuilder::wake_td_builder()
+{
+  // Pairs with the fence in send_trigger_decisions: either the builder sees
+  // the new TC before it sleeps, or we see that it is sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_td_builder_sleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(m_td_builder_mutex);
+    m_cv.notify_one();
+  }
+}
+
+/**
+ * The TD builder thread. It is the only one touching the pending TDs: it
+ * drains queued TCs into them and sends the TDs that are ready.
+ * */
+void
+TDBuilder::send_trigger_decisions()
+{
+  TCHandle tc;
+
+  while (m_running_flag) {
+    while (m_tc_queue.try_pop(tc)) {
+      update_watermark(tc);
+      add_tc(std::move(tc));
+    }
+    TLOG_DEBUG(10) << "pending tds size: " << m_pending_tds.size();
+
+    auto ready_tds = get_ready_tds();
+    TLOG_DEBUG(10) << "ready tds: " << ready_tds.size() << ", updated pending tds: " << m_pending_tds.size();
+
+    for (const auto& ready_td : ready_tds) {
+      call_tc_decision(ready_td);
+    }
+
+    // Sleep until the earliest pending TD expires, or until a new TC is queued
+    std::unique_lock<std::mutex> lock(m_td_builder_mutex);
+    m_td_builder_sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto wake_up = [this] { return !m_tc_queue.empty() || !m_running_flag; };
+    auto next_deadline = m_pending_tds.next_deadline();
+    if (next_deadline.has_value()) {
+      m_cv.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::milliseconds(*next_deadline)), wake_up);
+    } else {
+      m_cv.wait(lock, wake_up);
+    }
+    m_td_builder_sleeping.store(false, std::memory_order_relaxed);
+    m_counters.td_sender_wakeup_count++;
+  }
+
+  // TCs still queued at stop are cleared along with the pending TDs
+  while (m_tc_queue.try_pop(tc)) {
+    add_tc(std::move(tc));
+  }
+}
+
+void
+TDBuilder::call_tc_decision(const PendingTD& pending_td)
+{
+  if (m_use_bitwords) {
+    // Check trigger bitwords
+    auto td_bitword = get_TD_bitword(pending_td);
+    bool bitword_check = m_trigger_bitwords.matches(td_bitword.to_ullong());
+    TLOG_DEBUG(15) << "TD word: " << td_bitword << ", trigger?: " << bitword_check;
+    if (!bitword_check) {
+      m_counters.tds_failed_bitword_count++;
+      m_counters.tds_failed_bitword_tc_count += pending_td.contributing_tcs.size();
+      return;
+    }
+  }
+
+  switch (m_send(create_decision(pending_td), pending_td)) {
+    case SendOutcome::kSent:
+      m_counters.tds_sent_count++;
+      m_counters.tds_sent_tc_count += pending_td.contributing_tcs.size();
+      break;
+    case SendOutcome::kSpilled:
+      m_counters.tds_spilled_count++;
+      m_counters.tds_spilled_tc_count += pending_td.contributing_tcs.size();
+      break;
+    case SendOutcome::kDropped:
+      m_counters.tds_dropped_count++;
+      m_counters.tds_dropped_tc_count += pending_td.contributing_tcs.size();
+      break;
+  }
+}
+
+dfmessages::TriggerDecision
+TDBuilder::create_decision(const PendingTD& pending_td)
+{
+  int earliest_tc_index = get_earliest_tc_index(pending_td);
+  TLOG_DEBUG(5) << "earliest TC index: " << earliest_tc_index;
+
+  if (pending_td.contributing_tcs.size() > 1) {
+    TLOG_DEBUG(5) << "!!! TD created from " << pending_td.contributing_tcs.size() << " TCs !!!";
+  }
+
+  const auto& earliest_tc = pending_td.contributing_tcs[earliest_tc_index];
+
+  dfmessages::TriggerDecision decision;
+  decision.trigger_number = 0; // filled by MLT
+  decision.run_number = 0;     // filled by MLT
+  decision.trigger_timestamp = earliest_tc.time_candidate;
+  decision.readout_type = dfmessages::ReadoutType::kLocalized;
+
+  if (m_config.hsi_passthrough) {
+    if (earliest_tc.type == TCType::kTiming) {
+      decision.trigger_type = earliest_tc.detid & 0xff;
+    } else {
+      decision.trigger_type = (static_cast<int>(earliest_tc.type) << 8);
+    }
+  } else {
+    auto td_bitword = get_TD_bitword(pending_td);
+    TLOG_DEBUG(5) << "[MLT] TD has bitword: " << td_bitword << " "
+                  << static_cast<dfmessages::trigger_type_t>(td_bitword.to_ulong());
+    decision.trigger_type = static_cast<dfmessages::trigger_type_t>(td_bitword.to_ulong());
+  }
+
+  TLOG_DEBUG(3) << "HSI passthrough: " << m_config.hsi_passthrough << ", TC detid: " << earliest_tc.detid
+                << ", TC type: " << static_cast<int>(earliest_tc.type)
+                << ", TC cont number: " << pending_td.contributing_tcs.size()
+                << ", DECISION trigger type: " << decision.trigger_type
+                << ", DECISION timestamp: " << decision.trigger_timestamp
+                << ", request window begin: " << pending_td.readout_start
+                << ", request window end: " << pending_td.readout_end;
+
+  decision.components.reserve(m_request_builder.max_components());
+  if (!m_use_roi_readout) {
+    m_request_builder.add_readout_requests(decision, pending_td.readout_start, pending_td.readout_end);
+  } else { // using ROI readout
+    m_request_builder.add_mandatory_requests(decision, pending_td.readout_start, pending_td.readout_end);
+    roi_readout_make_requests(decision);
+  }
+
+  m_counters.tds_created_count++;
+  m_counters.tds_created_tc_count += pending_td.contributing_tcs.size();
+
+  return decision;
+}
+
+void
+TDBuilder::roi_readout_make_requests(dfmessages::TriggerDecision& decision)
+{
+  // Get configuration at random (weighted)
+  int group_pick = m_roi_sampler.pick_config();
+  if (group_pick != -1) {
+    const auto& this_group = m_config.roi_groups[group_pick];
+    triggeralgs::timestamp_t start = decision.trigger_timestamp - this_group.time_window;
+    triggeralgs::timestamp_t end = decision.trigger_timestamp + this_group.time_window;
+
+    TLOG_DEBUG(10) << "TD timestamp: " << decision.trigger_timestamp;
+    TLOG_DEBUG(10) << "group window: " << this_group.time_window;
+
+    // If mode is random, pick groups to request at random
+    if (this_group.mode == "kRandom") {
+      TLOG_DEBUG(10) << "RAND";
+      for (auto r_id : m_roi_sampler.pick_groups(this_group.n_links)) {
+        m_request_builder.add_group_requests(decision, r_id, start, end);
+      }
+      // Otherwise, read sequntially by IDs, starting at 0
+    } else {
+      TLOG_DEBUG(10) << "SEQ";
+      for (int r_id = 0; r_id < this_group.n_links; ++r_id) {
+        m_request_builder.add_group_requests(decision, r_id, start, end);
+      }
+    }
+  }
+}
+
+void
+TDBuilder::add_tc(TCHandle tc)
+{
+  int64_t tc_wallclock_arrived =
+    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  auto [tc_readout_start, tc_readout_end] = get_tc_readout_window(tc);
+
+  if (m_config.merge_overlapping_tcs || m_config.ignore_overlapping_tcs) {
+    auto it = m_pending_tds.find_overlap(tc_readout_start, tc_readout_end);
+
+    // If overlap and ignoring, we drop the TC and flag it as dealt with.
+    if (it != m_pending_tds.end() && m_config.ignore_overlapping_tcs) {
+      m_counters.tc_pileup_dropped_count++;
+      m_counters.tcs_added_count++;
+      TLOG_DEBUG(3) << "TC overlapping with a previous TD, dropping!";
+      return;
+    }
+
+    // If we're here, TC merging must be on, in which case we're actually
+    // going to merge the TC into the TD.
+    if (it != m_pending_tds.end()) {
+      TLOG_DEBUG(3) << "TC with start/end times " << tc_readout_start << "/" << tc_readout_end
+                    << " overlaps with pending TD with start/end times " << it->second.readout_start << "/"
+                    << it->second.readout_end;
+      it->second.contributing_tcs.push_back(std::move(tc));
+      it->second.walltime_expiration = tc_wallclock_arrived + m_config.buffer_timeout;
+      it = m_pending_tds.extend(it, tc_readout_start, tc_readout_end);
+      if (check_td_readout_length(it->second)) { // Pass on TDs with (too) long readout window straight away
+        m_pending_tds.reschedule(it, tc_wallclock_arrived);
+      }
+      m_counters.tcs_added_count++;
+      return;
+    }
+  }
+
+  // Create a new TD out of the TC
+  PendingTD td_candidate;
+  td_candidate.contributing_tcs.push_back(std::move(tc));
+  td_candidate.readout_start = tc_readout_start;
+  td_candidate.readout_end = tc_readout_end;
+  td_candidate.walltime_expiration = tc_wallclock_arrived + m_config.buffer_timeout;
+  auto it = m_pending_tds.insert(std::move(td_candidate));
+  if (check_td_readout_length(it->second)) { // Pass on TDs with (too) long readout window straight away
+    m_pending_tds.reschedule(it, tc_wallclock_arrived);
+  }
+  m_counters.tcs_added_count++;
+}
+
+std::pair<triggeralgs::timestamp_t, triggeralgs::timestamp_t>
+TDBuilder::get_tc_readout_window(const TCHandle& tc) const
+{
+  // The table entries of TC types without a readout map entry are never read
+  size_t type = static_cast<size_t>(tc.type);
+  if (type < s_n_tc_types && m_readout_window_mask[type]) {
+    return { tc.time_candidate - m_readout_window_table[type].first,
+             tc.time_candidate + m_readout_window_table[type].second };
+  }
+  return { tc.time_start, tc.time_end };
+}
+
+std::vector<PendingTD>
+TDBuilder::get_ready_tds()
+{
+  auto timestamp_now_us =
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+  std::vector<PendingTD> return_tds;
+
+  // Close TDs that the data has moved past, without waiting for the timeout
+  if (m_config.close_on_watermark && !m_latest_tc_time.empty()) {
+    auto watermark = get_watermark();
+    if (watermark >= m_config.watermark_margin) {
+      return_tds = m_pending_tds.extract_closed(watermark - m_config.watermark_margin);
+      m_counters.tds_watermark_closed_count += return_tds.size();
+    }
+  }
+
+  auto expired_tds = m_pending_tds.extract_expired(timestamp_now_us / 1000);
+  return_tds.insert(
+    return_tds.end(), std::make_move_iterator(expired_tds.begin()), std::make_move_iterator(expired_tds.end()));
+
+  // How long after its deadline did we get round to each TD
+  for (const auto& td : return_tds) {
+    metric_counter_type lateness_us = std::max<int64_t>(timestamp_now_us - td.walltime_expiration * 1000, 0);
+    m_counters.td_sender_lateness_total_us += lateness_us;
+    if (lateness_us > m_counters.td_sender_lateness_max_us.load()) {
+      m_counters.td_sender_lateness_max_us.store(lateness_us);
+    }
+  }
+  return return_tds;
+}
+
+void
+TDBuilder::update_watermark(const TCHandle& tc)
+{
+  auto [it, inserted] = m_latest_tc_time.try_emplace(tc.source, tc.time_candidate);
+  if (!inserted && tc.time_candidate > it->second) {
+    it->second = tc.time_candidate;
+  }
+}
+
+triggeralgs::timestamp_t
+TDBuilder::get_watermark() const
+{
+  // Data time that every source seen so far has moved past
+  triggeralgs::timestamp_t watermark = std::numeric_limits<triggeralgs::timestamp_t>::max();
+  for (const auto& [source, latest_time] : m_latest_tc_time) {
+    watermark = std::min(watermark, latest_time);
+  }
+  return watermark;
+}
+
+int
+TDBuilder::get_earliest_tc_index(const PendingTD& pending_td)
+{
+  int earliest_tc_index = 0;
+  for (int i = 1; i < static_cast<int>(pending_td.contributing_tcs.size()); i++) {
+    if (pending_td.contributing_tcs[i].time_candidate < pending_td.contributing_tcs[earliest_tc_index].time_candidate) {
+      earliest_tc_index = i;
+    }
+  }
+  return earliest_tc_index;
+}
+
+bool
+TDBuilder::check_td_readout_length(const PendingTD& pending_td) const
+{
+  bool td_too_long = false;
+  if (static_cast<int64_t>(pending_td.readout_end - pending_td.readout_start) >= m_config.td_readout_limit) {
+    td_too_long = true;
+    TLOG_DEBUG(3) << "Too long readout window: " << (pending_td.readout_end - pending_td.readout_start)
+                  << ", sending immediate TD!";
+  }
+  return td_too_long;
+}
+
+void
+TDBuilder::clear_td_vectors()
+{
+  m_counters.tds_cleared_count += m_pending_tds.size();
+  size_t tds_cleared_tc_count =
+    std::accumulate(m_pending_tds.begin(), m_pending_tds.end(), size_t(0), [](size_t sum, const auto& entry) {
+      return sum + entry.second.contributing_tcs.size();
+    });
+  m_counters.tds_cleared_tc_count += tds_cleared_tc_count;
+  m_pending_tds.clear();
+}
+
+std::bitset<64>
+TDBuilder::get_TD_bitword(const PendingTD& ready_td)
+{
+  return std::bitset<64>(TriggerBitwords::make_td_word(ready_td.contributing_tcs));
+}
+
+void
+TDBuilder::compile_tc_type_tables()
+{
+  m_readout_window_mask.reset();
+  m_readout_window_table.fill({ 0, 0 });
+  for (auto const& [tc_type, window] : m_config.readout_map) {
+    size_t type = static_cast<size_t>(tc_type);
+    if (type >= s_n_tc_types) {
+      throw(InvalidConfiguration(ERS_HERE, "Provided a TC type in the TCReadoutMap that does not fit in a TD bitword"));
+    }
+    m_readout_window_mask.set(type);
+    m_readout_window_table[type] = window;
+  }
+
+  m_ignored_tc_mask.reset();
+  for (auto tc_type : m_config.ignored_tc_types) {
+    if (tc_type >= s_n_tc_types) {
+      throw(InvalidConfiguration(ERS_HERE, "Provided a TC type to ignore that does not fit in a TD bitword"));
+    }
+    m_ignored_tc_mask.set(tc_type);
+  }
+}
+
+void
+TDBuilder::print_config() const
+{
+  TLOG_DEBUG(3) << "Allow merging: " << m_config.merge_overlapping_tcs;
+  TLOG_DEBUG(3) << "Ignore pileup: " << m_config.ignore_overlapping_tcs;
+  TLOG_DEBUG(3) << "Buffer timeout: " << m_config.buffer_timeout;
+  TLOG_DEBUG(3) << "TD readout limit: " << m_config.td_readout_limit;
+  TLOG_DEBUG(3) << "Close TDs on data-time watermark: " << m_config.close_on_watermark
+                << ", margin: " << m_config.watermark_margin;
+
+  TLOG_DEBUG(3) << "MLT Group Links:";
+  for (auto const& [key, val] : m_config.group_links) {
+    TLOG_DEBUG(3) << "Group: " << key;
+    for (auto const& link : val) {
+      TLOG_DEBUG(3) << link;
+    }
+  }
+  TLOG_DEBUG(3) << "Total group links: " << m_config.group_links.size();
+  TLOG_DEBUG(3) << "Max components per TD: " << m_request_builder.max_components();
+
+  TLOG_DEBUG(3) << "Use ROI readout?: " << m_use_roi_readout;
+  for (size_t id = 0; id < m_config.roi_groups.size(); ++id) {
+    const auto& group = m_config.roi_groups[id];
+    TLOG_DEBUG(3) << "ROI ID: " << id << ", n links: " << group.n_links << ", prob: " << group.prob
+                  << ", time: " << group.time_window << ", mode: " << group.mode;
+  }
+  if (m_use_roi_readout) {
+    TLOG_DEBUG(3) << "ROI sampler seed: " << m_config.roi_seed;
+  }
+
+  TLOG_DEBUG(3) << "MLT TD Readout map:";
+  for (auto const& [key, val] : m_config.readout_map) {
+    TLOG_DEBUG(3) << "Type: " << static_cast<int>(key) << ", before: " << val.first << ", after: " << val.second;
+  }
+
+  TLOG_DEBUG(3) << "TC types to ignore: ";
+  for (auto tc_type : m_config.ignored_tc_types) {
+    TLOG_DEBUG(3) << tc_type;
+  }
+
+  TLOG_DEBUG(3) << "Use bitwords: " << m_use_bitwords;
+  if (m_use_bitwords) {
+    TLOG_DEBUG(3) << "Configured trigger words:";
+    for (auto bitword : m_trigger_bitwords.words()) {
+      TLOG_DEBUG(3) << std::bitset<64>(bitword);
+    }
+  }
+}
+
+} // namespace dunedaq::trigger
@@ -0,0 +1,205 @@
+/**
+ * @file TPFilter.cpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TPFilter.hpp"
+#include "trigger/Issues.hpp"
+
+#include <algorithm>
+#include <string>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace dunedaq::trigger {
+
+void
+TPFilter::configure(const TPFilterConfig& config)
+{
+  m_mask_words.clear();
+  if (!config.masked_channels.empty()) {
+    uint32_t max_channel = *std::max_element(config.masked_channels.begin(), config.masked_channels.end()); // NOLINT
+    m_mask_words.assign(max_channel / 32 + 1, 0);
+    for (auto channel : config.masked_channels) {
+      m_mask_words[channel / 32] |= (1u << (channel % 32));
+    }
+  }
+
+  m_plane_period = config.plane_period;
+  m_plane_boundaries = config.plane_boundaries;
+  std::sort(m_plane_boundaries.begin(), m_plane_boundaries.end());
+  m_kept_planes = 0;
+  if (m_plane_period > 0) {
+    for (auto boundary : m_plane_boundaries) {
+      if (boundary == 0 || boundary >= m_plane_period) {
+        throw InvalidConfiguration(ERS_HERE,
+                                   "TP filter plane boundary " + std::to_string(boundary) +
+                                     " outside of the channel period " + std::to_string(m_plane_period));
+      }
+    }
+    if (m_plane_boundaries.size() >= 32) {
+      throw InvalidConfiguration(ERS_HERE, "TP filter supports at most 32 planes");
+    }
+    // Otherwise every TP would be rejected
+    if (config.planes.empty()) {
+      throw InvalidConfiguration(ERS_HERE, "TP filter plane selection is on but keeps no plane");
+    }
+    for (auto plane : config.planes) {
+      if (plane > m_plane_boundaries.size()) {
+        throw InvalidConfiguration(ERS_HERE, "TP filter selects plane " + std::to_string(plane) + ", which does not exist");
+      }
+      m_kept_planes |= (1u << plane);
+    }
+  }
+
+  m_min_time_over_threshold = config.min_time_over_threshold;
+  m_max_time_over_threshold = config.max_time_over_threshold;
+  m_min_adc_peak = config.min_adc_peak;
+  m_min_adc_integral = config.min_adc_integral;
+
+  m_enabled = !m_mask_words.empty() || m_plane_period > 0 || m_min_time_over_threshold > 0 ||
+              m_max_time_over_threshold < std::numeric_limits<uint32_t>::max() || m_min_adc_peak > 0 || // NOLINT
+              m_min_adc_integral > 0;
+}
+
+bool
+TPFilter::keep_fields(uint32_t channel,             // NOLINT(build/unsigned)
+                      uint32_t time_over_threshold, // NOLINT(build/unsigned)
+                      uint32_t adc_peak,            // NOLINT(build/unsigned)
+                      uint32_t adc_integral) const  // NOLINT(build/unsigned)
+{
+  if (channel / 32 < m_mask_words.size() && ((m_mask_words[channel / 32] >> (channel % 32)) & 1)) {
+    return false;
+  }
+  if (m_plane_period > 0) {
+    uint32_t offset = channel % m_plane_period; // NOLINT(build/unsigned)
+    uint32_t plane = 0;                         // NOLINT(build/unsigned)
+    for (auto boundary : m_plane_boundaries) {
+      plane += (offset >= boundary) ? 1 : 0;
+    }
+    if (((m_kept_planes >> plane) & 1) == 0) {
+      return false;
+    }
+  }
+  return time_over_threshold >= m_min_time_over_threshold && time_over_threshold <= m_max_time_over_threshold &&
+         adc_peak >= m_min_adc_peak && adc_integral >= m_min_adc_integral;
+}
+
+bool
+TPFilter::use_avx2()
+{
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+#else
+  return false;
+#endif
+}
+
+void
+TPFilter::mark(Lanes& lanes, size_t n) const
+{
+  if (!m_force_scalar && use_avx2()) {
+    mark_avx2(lanes, n);
+  } else {
+    mark_scalar(lanes, 0, n);
+  }
+}
+
+void
+TPFilter::mark_scalar(Lanes& lanes, size_t begin, size_t end) const
+{
+  for (size_t i = begin; i < end; ++i) {
+    lanes.keep[i] =
+      keep_fields(lanes.channel[i], lanes.time_over_threshold[i], lanes.adc_peak[i], lanes.adc_integral[i]) ? 1 : 0;
+  }
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2"))) void
+TPFilter::mark_avx2(Lanes& lanes, size_t n) const
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i low_bits = _mm256_set1_epi32(31);
+  const __m256i n_mask_words = _mm256_set1_epi32(static_cast<int>(m_mask_words.size()));
+  const __m256i period = _mm256_set1_epi32(static_cast<int>(m_plane_period));
+  const __m256i period_minus_one = _mm256_set1_epi32(static_cast<int>(m_plane_period) - 1);
+  const __m256 inverse_period = _mm256_set1_ps(m_plane_period > 0 ? 1.f / m_plane_period : 0.f);
+  const __m256i kept_planes = _mm256_set1_epi32(static_cast<int>(m_kept_planes));
+  const __m256i min_tot = _mm256_set1_epi32(static_cast<int>(m_min_time_over_threshold));
+  const __m256i max_tot = _mm256_set1_epi32(static_cast<int>(m_max_time_over_threshold));
+  const __m256i min_adc_peak = _mm256_set1_epi32(static_cast<int>(m_min_adc_peak));
+  const __m256i min_adc_integral = _mm256_set1_epi32(static_cast<int>(m_min_adc_integral));
+  // Channels the float division below is exact enough for
+  const __m256i large_channel = _mm256_set1_epi32(static_cast<int>(0xff000000));
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i channel = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes.channel[i]));
+    __m256i keep = _mm256_cmpeq_epi32(zero, zero);
+
+    if (!m_mask_words.empty()) {
+      __m256i word = _mm256_srli_epi32(channel, 5);
+      __m256i in_table = _mm256_cmpgt_epi32(n_mask_words, word);
+      __m256i words = _mm256_i32gather_epi32(
+        reinterpret_cast<const int*>(m_mask_words.data()), _mm256_and_si256(word, in_table), 4);
+      __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(channel, low_bits)), one);
+      keep = _mm256_andnot_si256(_mm256_and_si256(_mm256_cmpeq_epi32(bit, one), in_table), keep);
+    }
+
+    if (m_plane_period > 0) {
+      if (!_mm256_testz_si256(channel, large_channel)) {
+        mark_scalar(lanes, i, i + 8);
+        continue;
+      }
+      // channel % period, from a quotient that may be off by one either way
+      __m256i quotient = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(channel), inverse_period));
+      __m256i offset = _mm256_sub_epi32(channel, _mm256_mullo_epi32(quotient, period));
+      offset = _mm256_add_epi32(offset, _mm256_and_si256(_mm256_cmpgt_epi32(zero, offset), period));
+      offset = _mm256_sub_epi32(offset, _mm256_and_si256(_mm256_cmpgt_epi32(offset, period_minus_one), period));
+
+      __m256i plane = zero;
+      for (auto boundary : m_plane_boundaries) {
+        // cmpgt gives -1 where the offset is at or past the boundary
+        plane = _mm256_sub_epi32(plane,
+                                 _mm256_cmpgt_epi32(offset, _mm256_set1_epi32(static_cast<int>(boundary) - 1)));
+      }
+      __m256i plane_kept = _mm256_and_si256(_mm256_srlv_epi32(kept_planes, plane), one);
+      keep = _mm256_and_si256(keep, _mm256_cmpeq_epi32(plane_kept, one));
+    }
+
+    // Unsigned comparisons, through unsigned min and max
+    __m256i tot = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes.time_over_threshold[i]));
+    keep = _mm256_and_si256(keep, _mm256_cmpeq_epi32(_mm256_max_epu32(tot, min_tot), tot));
+    keep = _mm256_and_si256(keep, _mm256_cmpeq_epi32(_mm256_min_epu32(tot, max_tot), tot));
+    __m256i adc_peak = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes.adc_peak[i]));
+    keep = _mm256_and_si256(keep, _mm256_cmpeq_epi32(_mm256_max_epu32(adc_peak, min_adc_peak), adc_peak));
+    __m256i adc_integral = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&lanes.adc_integral[i]));
+    keep = _mm256_and_si256(keep, _mm256_cmpeq_epi32(_mm256_max_epu32(adc_integral, min_adc_integral), adc_integral));
+
+    int bits = _mm256_movemask_ps(_mm256_castsi256_ps(keep));
+    for (size_t lane = 0; lane < 8; ++lane) {
+      lanes.keep[i + lane] = (bits >> lane) & 1;
+    }
+  }
+  mark_scalar(lanes, i, n);
+}
+
+#else
+
+void
+TPFilter::mark_avx2(Lanes& lanes, size_t n) const
+{
+  mark_scalar(lanes, 0, n);
+}
+
+#endif
+
+} // namespace dunedaq::trigger
@@ -0,0 +1,71 @@
+/**
+ * @file TPLatenessTracker.cpp
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TPLatenessTracker.hpp"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+
+namespace dunedaq::trigger {
+
+namespace {
+
+std::mutex s_trackers_mutex;
+std::map<std::string, std::shared_ptr<TPLatenessTracker>> s_trackers;
+
+} // namespace
+
+TPLatenessTracker::Snapshot
+TPLatenessTracker::Snapshot::since(const Snapshot& earlier) const
+{
+  Snapshot difference;
+  difference.count = count - earlier.count;
+  for (size_t i = 0; i < s_n_buckets; ++i) {
+    difference.buckets[i] = buckets[i] - earlier.buckets[i];
+  }
+  return difference;
+}
+
+uint64_t // NOLINT(build/unsigned)
+TPLatenessTracker::Snapshot::quantile(double q) const
+{
+  uint64_t total = 0; // NOLINT(build/unsigned)
+  for (auto n : buckets) {
+    total += n;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  double target = std::clamp(q, 0., 1.) * total;
+  double below = 0;
+  for (size_t i = 0; i < s_n_buckets; ++i) {
+    if (buckets[i] == 0 || below + buckets[i] < target) {
+      below += buckets[i];
+      continue;
+    }
+    // Assume the TPs are spread evenly over the bucket
+    double low = i == 0 ? 0. : std::ldexp(1., i);
+    double high = std::ldexp(1., i + 1);
+    return static_cast<uint64_t>(std::ceil(low + (high - low) * (target - below) / buckets[i])); // NOLINT
+  }
+  return static_cast<uint64_t>(std::ldexp(1., s_n_buckets)); // NOLINT(build/unsigned)
+}
+
+std::shared_ptr<TPLatenessTracker>
+TPLatenessTracker::for_link(const std::string& link)
+{
+  std::lock_guard<std::mutex> lock(s_trackers_mutex);
+  auto& tracker = s_trackers[link];
+  if (!tracker) {
+    tracker = std::make_shared<TPLatenessTracker>();
+  }
+  return tracker;
+}
+
+} // namespace dunedaq::trigger
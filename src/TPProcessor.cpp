@@ -7,6 +7,7 @@
  */
 #include "trigger/TPProcessor.hpp" // NOLINT(build/include)
 #include "trigger/Issues.hpp" // NOLINT(build/include)
+#include "trigger/ProcessorAttributes.hpp" // NOLINT(build/include)
 
 #include "iomanager/Sender.hpp"
 #include "logging/Logging.hpp"
@@ -25,6 +26,11 @@
 #include "appmodel/TPDataProcessor.hpp"
 #include "appmodel/TAAlgorithm.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+
 using dunedaq::datahandlinglibs::logging::TLVL_BOOKKEEPING;
 using dunedaq::datahandlinglibs::logging::TLVL_TAKE_NOTE;
 
@@ -47,31 +53,75 @@ TPProcessor::start(const nlohmann::json& args)
 {
 
   // Reset stats
-  m_tp_received_count.store(0);
   m_ta_made_count.store(0);
-  m_ta_sent_count.store(0);
-  m_ta_failed_sent_count.store(0);
+  m_tp_lateness->start_run();
 
   m_running_flag.store(true);
 
+  if (m_ta_spill) {
+    m_ta_spill->start("ta-spill");
+  }
+  if (m_ta_set_spill) {
+    m_ta_set_spill->start("ta-set-spill");
+  }
+
+  if (m_ta_set_batcher) {
+    m_ta_set_batcher->start(std::bind(&TPProcessor::send_ta_set, this, std::placeholders::_1), m_sourceid, "ta-set");
+  }
+
+  // Without the broadcast ring, TPs go to the post-processing queue of each TA algorithm
+  m_ta_finding.start(std::bind(&TPProcessor::send_ta, this, std::placeholders::_1),
+                     [this](const TriggerPrimitiveTypeAdapter* item) { inherited::postprocess_item(item); },
+                     m_latency_monitoring.load() ? &m_latency_instance : nullptr);
+
   inherited::start(args);
 }
 
 void
 TPProcessor::stop(const nlohmann::json& args)
 {
+  // A partial pre-filter batch flushed now would go to post-processing threads that are stopping;
+  // what is left in the batches is passed on by the TA finding stop below
+  m_ta_finding.stop_flusher();
+
   inherited::stop(args);
+
   m_running_flag.store(false);
+
+  // The post-processing threads are done: the TPs still in the pre-filter batch, in the
+  // broadcast ring, in the batches and in the shards go through the algorithms
+  m_ta_finding.stop();
+
+  // Every TA has been made: send the last TASet
+  if (m_ta_set_batcher) {
+    m_ta_set_batcher->stop();
+  }
+
+  // Last retry of what backpressure left behind; what is still refused is dropped
+  if (m_ta_spill) {
+    m_ta_spill->stop();
+  }
+  if (m_ta_set_spill) {
+    m_ta_set_spill->stop();
+  }
+
   print_opmon_stats();
 }
 
 void
 TPProcessor::conf(const appmodel::DataHandlerModule* conf)
 {
+  std::string ta_connection;
+  std::string ta_set_connection;
   for (auto output : conf->get_outputs()) {
    try {
       if (output->get_data_type() == "TriggerActivity") {
          m_ta_sink = get_iom_sender<triggeralgs::TriggerActivity>(output->UID());
+         ta_connection = output->UID();
+      }
+      if (output->get_data_type() == "TASet") {
+         m_ta_set_sink = get_iom_sender<TASet>(output->UID());
+         ta_set_connection = output->UID();
       }
     } catch (const ers::Issue& excpt) {
       ers::error(datahandlinglibs::ResourceQueueError(ERS_HERE, "ta", "DefaultRequestHandlerModel", excpt));
@@ -80,24 +130,112 @@ TPProcessor::conf(const appmodel::DataHandlerModule* conf)
 
   m_sourceid.id = conf->get_source_id();
   m_sourceid.subsystem = TriggerPrimitiveTypeAdapter::subsystem;
+
+  // Lateness is measured as the TPs go into the latency buffer
+  m_tp_lateness = TPLatenessTracker::for_link(conf->UID());
+  inherited::add_preprocess_task(
+    [lateness = m_tp_lateness](TriggerPrimitiveTypeAdapter* tp) { lateness->record(tp->tp.time_start); });
   
   std::vector<const appmodel::TAAlgorithm*> ta_algorithms;
+  TAFindingConfig ta_finding_conf;
   auto dp = conf->get_module_configuration()->get_data_processor();
   auto proc_conf = dp->cast<appmodel::TPDataProcessor>();
   if (proc_conf != nullptr && m_post_processing_enabled) {
     ta_algorithms = proc_conf->get_algorithms();
+
+    // Tuning attributes; each defaults to the behaviour from before it existed
+    auto attributes = ProcessorAttributes::of(proc_conf);
+    ta_finding_conf.tp_batch_size = attributes.get<size_t>("tp_batch_size", 1, 1);
+    ta_finding_conf.tp_broadcast_capacity = attributes.get<size_t>("tp_broadcast_capacity", 0, 0);
+    ta_finding_conf.ta_shards = attributes.get<size_t>("ta_shards", 1, 1);
+    ta_finding_conf.ta_shard_channel_block =
+      attributes.get<uint32_t>("ta_shard_channel_block", 256, 1); // NOLINT(build/unsigned)
+    m_timing_sample_period = attributes.get<uint32_t>("timing_sample_period", 0); // NOLINT(build/unsigned)
+
+    // Optional cuts on the TPs, before they reach the algorithms
+    auto& filter_conf = ta_finding_conf.filter;
+    filter_conf.masked_channels = attributes.get("tp_filter_masked_channels", filter_conf.masked_channels);
+    filter_conf.plane_period = attributes.get("tp_filter_plane_period", filter_conf.plane_period);
+    filter_conf.plane_boundaries = attributes.get("tp_filter_plane_boundaries", filter_conf.plane_boundaries);
+    filter_conf.planes = attributes.get("tp_filter_planes", filter_conf.planes);
+    filter_conf.min_time_over_threshold =
+      attributes.get("tp_filter_min_time_over_threshold", filter_conf.min_time_over_threshold);
+    filter_conf.max_time_over_threshold =
+      attributes.get("tp_filter_max_time_over_threshold", filter_conf.max_time_over_threshold);
+    filter_conf.min_adc_peak = attributes.get("tp_filter_min_adc_peak", filter_conf.min_adc_peak);
+    filter_conf.min_adc_integral = attributes.get("tp_filter_min_adc_integral", filter_conf.min_adc_integral);
+    ta_finding_conf.tp_filter_batch_size = attributes.get<size_t>("tp_filter_batch_size", 64, 1);
+    ta_finding_conf.tp_batch_max_delay =
+      std::chrono::microseconds(attributes.get<int64_t>("tp_batch_max_delay_us", 1000, 0));
+
+    // TAs go out one by one unless a TASet size is given
+    size_t ta_set_max_objects = attributes.get<size_t>("ta_set_max_objects", 0);
+    if (ta_set_max_objects > 0) {
+      if (m_ta_set_sink == nullptr) {
+        throw InvalidConfiguration(ERS_HERE, "TA output batching requires a TASet output connection");
+      }
+      m_ta_set_batcher = std::make_unique<SetBatcher<triggeralgs::TriggerActivity>>(
+        ta_set_max_objects,
+        attributes.get<uint64_t>("ta_set_max_time_span", 62500), // NOLINT(build/unsigned)
+        std::chrono::microseconds(attributes.get<int64_t>("ta_set_max_delay_us", 1000, 0)));
+      TLOG() << "TAs sent in TASets of up to " << m_ta_set_batcher->max_objects() << " TAs, "
+             << m_ta_set_batcher->max_time_span() << " ticks and " << m_ta_set_batcher->max_delay().count() << " us";
+    }
+
+    // What the output connection does not take right away is dropped, unless spill_capacity
+    // sets up a ring to retry it from. A receiver in this process is sent to by move, skipping
+    // serialization
+    size_t spill_capacity = attributes.get<size_t>("spill_capacity", 0);
+    std::chrono::milliseconds drop_report_interval(attributes.get<int64_t>("drop_report_interval_ms", 1000, 1));
+    if (m_ta_set_batcher) {
+      m_ta_set_spill = std::make_unique<SpillingSender<TASet>>(
+        "TASet",
+        make_try_send<TASet>(ta_set_connection, m_ta_set_sink),
+        spill_capacity,
+        drop_report_interval);
+    } else {
+      m_ta_spill = std::make_unique<SpillingSender<triggeralgs::TriggerActivity>>(
+        "TA",
+        make_try_send<triggeralgs::TriggerActivity>(ta_connection, m_ta_sink),
+        spill_capacity,
+        drop_report_interval);
+    }
     }
+  m_ta_finding.configure(ta_finding_conf);
+  TLOG() << "TPs per TA finding batch: " << ta_finding_conf.tp_batch_size;
+  TLOG() << "TP pre-filter: " << m_ta_finding.filter().enabled()
+         << ", TPs per filter batch: " << ta_finding_conf.tp_filter_batch_size << ", AVX2: " << TPFilter::use_avx2();
+  TLOG() << "Partial TP batches flushed after [us]: " << ta_finding_conf.tp_batch_max_delay.count();
+  TLOG() << "Channel shards per TA algorithm: " << ta_finding_conf.ta_shards
+         << ", channels per block: " << ta_finding_conf.ta_shard_channel_block;
+  if (m_timing_sample_period > 0) {
+    TLOG() << "TA maker calls timed: 1 in " << m_timing_sample_period;
+  }
 
   for (auto algo : ta_algorithms)  {
     TLOG() << "Selected TA algorithm: " << algo->UID() << " from class " << algo->class_name();
-    std::shared_ptr<triggeralgs::TriggerActivityMaker> maker = make_ta_maker(algo->class_name());
     nlohmann::json algo_json = algo->to_json(true);
 
     TLOG() << "Algo config:\n" << algo_json.dump();
 
-    maker->configure(algo_json[algo->UID()]);
-    inherited::add_postprocess_task(std::bind(&TPProcessor::find_ta, this, std::placeholders::_1, maker));
-    m_tams.push_back(maker);
+    // One maker per channel shard, if sharded, each configured as the algorithm and timed on its own
+    AlgorithmTiming timing{ algo->UID(), {} };
+    m_ta_finding.add_algorithm(
+      [class_name = algo->class_name(), maker_conf = algo_json[algo->UID()]]() {
+        std::shared_ptr<triggeralgs::TriggerActivityMaker> maker = make_ta_maker(class_name);
+        maker->configure(maker_conf);
+        return maker;
+      },
+      [&timing, this]() { return timing.add_histogram(m_timing_sample_period); });
+    m_ta_timings.push_back(std::move(timing));
+  }
+
+  // One queue per algorithm is only worth it for a single algorithm
+  TLOG() << "TP broadcast ring for TA algorithms: " << m_ta_finding.uses_broadcast_ring();
+  if (!m_ta_finding.uses_broadcast_ring()) {
+    for (auto& task : m_ta_finding.tasks()) {
+      inherited::add_postprocess_task(TAFindingPipeline::task_t(task));
+    }
   }
   m_latency_monitoring.store( dp->get_latency_monitoring() );
   inherited::conf(conf);
@@ -109,13 +247,30 @@ TPProcessor::generate_opmon_data()
 {
   opmon::TPProcessorInfo info;
 
-  info.set_tp_received_count( m_tp_received_count.load() );
+  info.set_tp_received_count( m_ta_finding.tp_received_count() );
   info.set_ta_made_count( m_ta_made_count.load() );
-  info.set_ta_sent_count( m_ta_sent_count.load() );
-  info.set_ta_failed_sent_count( m_ta_failed_sent_count.load() );
+  info.set_ta_sent_count( ta_sent_count() );
+  info.set_ta_failed_sent_count( ta_failed_sent_count() );
+  info.set_tp_broadcast_dropped_count( m_ta_finding.tp_broadcast_dropped_count() );
+  info.set_ta_shard_queue_full_count( m_ta_finding.shard_queue_full_count() );
+  info.set_ta_set_sent_count( m_ta_set_spill ? m_ta_set_spill->sent_count() : 0 );
+  info.set_tp_filtered_count( m_ta_finding.tp_filtered_count() );
+  if (m_ta_spill) {
+    info.set_ta_spilled_count( m_ta_spill->spilled_count() );
+    info.set_ta_spill_occupancy( m_ta_spill->occupancy() );
+  } else if (m_ta_set_spill) {
+    info.set_ta_spilled_count( m_ta_set_spill->spilled_count() );
+    info.set_ta_spill_occupancy( m_ta_set_spill->occupancy() );
+  }
 
   this->publish(std::move(info));
 
+  if (m_timing_sample_period > 0) {
+    for (auto& timing : m_ta_timings) {
+      this->publish( timing.opmon_info(), {{"algorithm", timing.algorithm}} );
+    }
+  }
+
   if ( m_latency_monitoring.load() && m_running_flag.load() ) {
     opmon::TriggerLatency lat_info;
 
@@ -126,29 +281,52 @@ TPProcessor::generate_opmon_data()
   }
 }
 
-/**
- * Pipeline Stage 2.: Do software TPG
- * */
 void
-TPProcessor::find_ta(const TriggerPrimitiveTypeAdapter* tp,  std::shared_ptr<triggeralgs::TriggerActivityMaker> taa)
+TPProcessor::postprocess_item(const TriggerPrimitiveTypeAdapter* item)
 {
-  if (m_latency_monitoring.load()) m_latency_instance.update_latency_in( tp->tp.time_start ); // time_start or time_peak ?
-  m_tp_received_count++;	
-  std::vector<triggeralgs::TriggerActivity> tas;
-  taa->operator()(tp->tp, tas);
-
-  while (tas.size()) {
-      m_ta_made_count++;
-      if (m_latency_monitoring.load()) m_latency_instance.update_latency_out( tas.back().time_start );
-      if (!m_ta_sink->try_send(std::move(tas.back()), iomanager::Sender::s_no_block)) {
-        ers::warning(TADropped(ERS_HERE, tp->tp.time_start, m_sourceid.id));
-        m_ta_failed_sent_count++;
-      } else {
-        m_ta_sent_count++;
-      }
-      tas.pop_back();
+  // The TP is in the latency buffer already: the filter only spares the algorithms
+  m_ta_finding.push(item);
+}
+
+void
+TPProcessor::send_ta(triggeralgs::TriggerActivity&& ta)
+{
+  m_ta_made_count++;
+  auto ta_time_start = ta.time_start;
+  if (m_latency_monitoring.load()) m_latency_instance.update_latency_out( ta_time_start );
+  if (m_ta_set_batcher) {
+    m_ta_set_batcher->add(std::move(ta), ta_time_start);
+    return;
+  }
+  // The spilling sender counts what it sent and dropped, and reports drops as a periodic summary
+  m_ta_spill->send(std::move(ta), ta_time_start);
+}
+
+void
+TPProcessor::send_ta_set(TASet&& ta_set)
+{
+  metric_counter_type n_tas = ta_set.objects.size();
+  auto set_start_time = ta_set.start_time;
+  m_ta_set_spill->send(std::move(ta_set), set_start_time, n_tas);
+}
+
+TPProcessor::metric_counter_type
+TPProcessor::ta_sent_count() const
+{
+  // Only what the output took: spilled TAs may still be dropped at stop
+  if (m_ta_set_spill) {
+    return m_ta_set_spill->sent_item_count();
+  }
+  return m_ta_spill ? m_ta_spill->sent_count() : 0;
+}
+
+TPProcessor::metric_counter_type
+TPProcessor::ta_failed_sent_count() const
+{
+  if (m_ta_set_spill) {
+    return m_ta_set_spill->dropped_item_count();
   }
-  return;
+  return m_ta_spill ? m_ta_spill->dropped_count() : 0;
 }
 
 void
@@ -156,10 +334,13 @@ TPProcessor::print_opmon_stats()
 {
   TLOG() << "TPProcessor opmon counters summary:";
   TLOG() << "------------------------------";
-  TLOG() << "TPs received: \t\t" << m_tp_received_count;
+  TLOG() << "TPs received: \t\t" << m_ta_finding.tp_received_count();
   TLOG() << "TAs made: \t\t\t" << m_ta_made_count;
-  TLOG() << "TAs sent: \t\t\t" << m_ta_sent_count;
-  TLOG() << "TAs failed to send: \t" << m_ta_failed_sent_count;
+  TLOG() << "TAs sent: \t\t\t" << ta_sent_count();
+  TLOG() << "TAs failed to send: \t" << ta_failed_sent_count();
+  TLOG() << "TASets sent: \t\t" << (m_ta_set_spill ? m_ta_set_spill->sent_count() : 0);
+  TLOG() << "TPs dropped by broadcast ring: \t" << m_ta_finding.tp_broadcast_dropped_count();
+  TLOG() << "TPs rejected by pre-filter: \t" << m_ta_finding.tp_filtered_count();
   TLOG();
 }
 
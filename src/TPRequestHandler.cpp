@@ -1,9 +1,15 @@
 #include "trigger/TPRequestHandler.hpp"
+#include "trigger/Issues.hpp"
+#include "trigger/ProcessorAttributes.hpp"
 #include "appmodel/DataHandlerConf.hpp"
 #include "appmodel/RequestHandler.hpp"
+#include "appmodel/TPDataProcessor.hpp"
 
 #include "rcif/cmd/Nljs.hpp"
 
+#include <algorithm>
+#include <limits>
+
 namespace dunedaq {
 namespace trigger {
 
@@ -18,6 +24,42 @@ TPRequestHandler::conf(const appmodel::DataHandlerModule* conf) {
             throw datahandlinglibs::ResourceQueueError(ERS_HERE, "tp queue", "DefaultRequestHandlerModel", excpt);
          }
       }
+      if (output->get_data_type() == "PackedTPSet") {
+         try {
+            m_packed_tpset_sink = iomanager::IOManager::get()->get_sender<dunedaq::trigger::PackedTPSet>(output->UID());
+         } catch (const ers::Issue& excpt) {
+            throw datahandlinglibs::ResourceQueueError(ERS_HERE, "tp queue", "DefaultRequestHandlerModel", excpt);
+         }
+      }
+   }
+
+   // Transmission delay, sized from the TP lateness seen by the processor of
+   // this link, and the time index over the buffer
+   unsigned index_bucket_bits = 16;
+   size_t index_buckets = 16384;
+   auto proc_conf = conf->get_module_configuration()->get_data_processor()->cast<appmodel::TPDataProcessor>();
+   if (proc_conf != nullptr) {
+      auto attributes = ProcessorAttributes::of(proc_conf);
+      m_delay_quantile = attributes.get("tpset_delay_quantile", 1., 0., 1.);
+      m_delay_min_ticks = attributes.get<uint64_t>("tpset_delay_min_ticks", 62500); // NOLINT(build/unsigned)
+      m_delay_max_ticks = attributes.get<uint64_t>("tpset_delay_max_ticks", 6250000); // NOLINT(build/unsigned)
+      m_delay_min_samples = attributes.get<uint64_t>("tpset_delay_min_samples", 10000); // NOLINT(build/unsigned)
+      index_bucket_bits = attributes.get<unsigned>("tp_index_bucket_bits", 16, 0, 48);
+      index_buckets = attributes.get<size_t>("tp_index_buckets", 16384, 1);
+   }
+   if (m_delay_min_ticks > m_delay_max_ticks) {
+      throw InvalidConfiguration(ERS_HERE, "TPSet delay floor must be below its ceiling");
+   }
+   m_tp_lateness = TPLatenessTracker::for_link(conf->UID());
+   m_tp_index = std::make_unique<tp_index_t>(index_bucket_bits, index_buckets);
+   TLOG() << "TPSet delay: quantile " << m_delay_quantile << " of the TP lateness, between " << m_delay_min_ticks
+          << " and " << m_delay_max_ticks << " ticks";
+   TLOG() << "TP time index: " << index_buckets << " buckets of " << m_tp_index->bucket_ticks() << " ticks";
+
+   m_tp_vector_pool.clear();
+   while (m_tp_vector_pool.size() < s_tp_vector_pool_size) {
+      m_tp_vector_pool.emplace_back();
+      m_tp_vector_pool.back().reserve(m_tp_vector_reserve);
    }
    inherited2::conf(conf);
 }
@@ -30,6 +72,17 @@ TPRequestHandler::start(const nlohmann::json& args) {
    m_start_win_ts=0;
    m_end_win_ts=0;
    m_first_cycle = true;
+
+   // Start cautious, until enough TPs have been seen
+   m_ts_set_sender_offset_ticks = m_delay_max_ticks;
+   m_lateness_quantile_ticks = 0;
+   m_lateness_snapshot = m_tp_lateness->snapshot();
+   m_run_lateness_snapshot = m_lateness_snapshot;
+
+   // Before the periodic transmission, which builds the index, is started
+   m_tp_index->clear();
+   m_num_index_hits = 0;
+   m_num_index_misses = 0;
 	
    inherited2::start(args);
    rcif::cmd::StartParams start_params = args.get<rcif::cmd::StartParams>();
@@ -39,7 +92,6 @@ TPRequestHandler::start(const nlohmann::json& args) {
 
 void
 TPRequestHandler::periodic_data_transmission() {
-   dunedaq::dfmessages::DataRequest dr;
 
    {
       std::unique_lock<std::mutex> lock(m_cv_mutex);
@@ -48,55 +100,49 @@ TPRequestHandler::periodic_data_transmission() {
    }
    m_cv.notify_all();
    if(m_latency_buffer->occupancy() != 0) {
-       // Prepare response
-       RequestResult rres(ResultCode::kUnknown, dr);
-       std::vector<std::pair<void*, size_t>> frag_pieces;
-
        // Get the newest TP
        SkipListAcc acc(inherited2::m_latency_buffer->get_skip_list());
        auto tail = acc.last();
-       auto head = acc.first();
        m_newest_ts = (*tail).get_timestamp();
-       m_oldest_ts = (*head).get_timestamp();
+       update_transmission_delay();
        
        if (m_first_cycle) {
+          m_oldest_ts = (*acc.first()).get_timestamp();
     	  m_start_win_ts = m_oldest_ts;
 	  m_first_cycle = false;
        }
        if (m_newest_ts - m_start_win_ts > m_ts_set_sender_offset_ticks) {
          m_end_win_ts = m_newest_ts - m_ts_set_sender_offset_ticks;
-         frag_pieces = get_fragment_pieces(m_start_win_ts, m_end_win_ts, rres);
-         auto num_tps = frag_pieces.size();
          trigger::TPSet tpset;
          tpset.run_number = m_run_number;
-         tpset.type = num_tps>0 ? trigger::TPSet::Type::kPayload : trigger::TPSet::Type::kHeartbeat;
          tpset.origin = m_sourceid;
          tpset.start_time = m_start_win_ts; // provisory timestamp, will be filled with first TP
          tpset.end_time = m_end_win_ts; // provisory timestamp, will be filled with last TP
          tpset.seqno = m_next_tpset_seqno++; // NOLINT(runtime/increment_decrement)
-       // reserve the space for efficiency
-         if (num_tps > 0) {    
-            tpset.objects.reserve(frag_pieces.size());
-            bool first_tp = true;
-            for( auto f : frag_pieces) {
-               trgdataformats::TriggerPrimitive tp = *(static_cast<trgdataformats::TriggerPrimitive*>(f.first));
-	       
-               if(first_tp) {
-                  tpset.start_time = tp.time_start;
-                  first_tp = false;
-               }
-	       tpset.end_time = tp.time_start;
-               tpset.objects.emplace_back(std::move(tp)); 
-            }
-	      } 
-         if(!m_tpset_sink->try_send(std::move(tpset), iomanager::Sender::s_no_block)) {
+         tpset.objects = take_tp_vector();
+
+         // The cursor is the end of the last TPSet. Each period seeks back to
+         // it and walks forward from there, indexing the TPs on the way
+         for (auto it = seek(acc, m_start_win_ts); it != acc.end() && it->get_timestamp() < m_end_win_ts; ++it) {
+            m_tp_index->record(it, it->get_timestamp());
+            tpset.objects.push_back(it->tp);
+         }
+         if (!tpset.objects.empty()) {
+            tpset.start_time = tpset.objects.front().time_start;
+            tpset.end_time = tpset.objects.back().time_start;
+         }
+         tpset.type = tpset.objects.empty() ? trigger::TPSet::Type::kHeartbeat : trigger::TPSet::Type::kPayload;
+
+         if(!send_tpset(tpset)) {
             ers::warning(DroppedTPSet(ERS_HERE, m_start_win_ts, m_end_win_ts));
             m_num_periodic_send_failed++;
          }
          m_num_periodic_sent++;
+         recycle_tp_vector(std::move(tpset.objects));
 
          //remember what we sent for the next loop
          m_start_win_ts = m_end_win_ts;
+         m_tp_lateness->set_sent_until(m_end_win_ts);
        }
     }
     {
@@ -107,5 +153,152 @@ TPRequestHandler::periodic_data_transmission() {
    return;
 }
 
+std::optional<TPRequestHandler::SkipListAcc::iterator>
+TPRequestHandler::find_in_index(SkipListAcc& acc, timestamp_t ts)
+{
+   // The index drops the entries of the TPs the cleanup removed, see cleanup()
+   auto entry = m_tp_index->find(ts);
+   if (!entry) {
+      return std::nullopt;
+   }
+   auto it = entry->before;
+   while (it != acc.end() && it->get_timestamp() < ts) {
+      ++it;
+   }
+   return it;
+}
+
+TPRequestHandler::SkipListAcc::iterator
+TPRequestHandler::seek(SkipListAcc& acc, timestamp_t ts)
+{
+   if (auto it = find_in_index(acc, ts)) {
+      return *it;
+   }
+   TriggerPrimitiveTypeAdapter key;
+   key.tp.time_start = ts;
+   key.tp.channel = std::numeric_limits<decltype(key.tp.channel)>::lowest();
+   return acc.lower_bound(key);
+}
+
+TPRequestHandler::RequestResult
+TPRequestHandler::data_request(dfmessages::DataRequest dr)
+{
+   const timestamp_t start_win_ts = dr.request_information.window_begin;
+   const timestamp_t end_win_ts = dr.request_information.window_end;
+   {
+      SkipListAcc acc(inherited2::m_latency_buffer->get_skip_list());
+      // Only a window entirely in the buffer is found here; the skip list
+      // handler deals with windows that are not there yet or already gone
+      if (!acc.empty() && acc.first()->get_timestamp() <= start_win_ts &&
+          end_win_ts <= acc.last()->get_timestamp()) {
+         if (auto start = find_in_index(acc, start_win_ts)) {
+            // Counted as the skip list handler counts a found window, so that
+            // its opmon sees every request whichever path served it
+            m_num_index_hits++;
+            m_num_requests_found++;
+            RequestResult rres(ResultCode::kFound, dr);
+            std::vector<std::pair<void*, size_t>> frag_pieces;
+            for (auto it = *start; it != acc.end() && it->get_timestamp() < end_win_ts; ++it) {
+               frag_pieces.emplace_back(const_cast<void*>(static_cast<const void*>(&it->tp)), kTriggerPrimitiveSize);
+            }
+            // The fragment copies the TPs, while the accessor still holds them
+            rres.fragment = std::make_unique<daqdataformats::Fragment>(frag_pieces);
+            rres.fragment->set_header_fields(create_fragment_header(dr));
+            return rres;
+         }
+      }
+   }
+   m_num_index_misses++;
+   return inherited2::data_request(dr);
+}
+
+void
+TPRequestHandler::cleanup()
+{
+   inherited2::cleanup();
+   // The cleanup runs while no request nor transmission does, so the index
+   // knows about the removed TPs before anyone uses it again. Everything up to
+   // the new head may be gone, even if late TPs are inserted before it later
+   SkipListAcc acc(inherited2::m_latency_buffer->get_skip_list());
+   if (acc.empty()) {
+      m_tp_index->clear();
+   } else {
+      m_tp_index->release(acc.first()->get_timestamp());
+   }
+}
+
+void
+TPRequestHandler::update_transmission_delay()
+{
+   if (m_delay_quantile <= 0.) {
+      return;
+   }
+   // Only the TPs since the last update count, so the delay follows changes of the link
+   auto snapshot = m_tp_lateness->snapshot();
+   auto recent = snapshot.since(m_lateness_snapshot);
+   if (recent.count < m_delay_min_samples) {
+      return;
+   }
+   m_lateness_snapshot = snapshot;
+   // Without a quantile to trade TPs for delay, no TP as late as one already
+   // seen in the run is left out: the delay covers the whole run's maximum,
+   // rounded up to its lateness bucket
+   uint64_t quantile = m_delay_quantile >= 1. ? snapshot.since(m_run_lateness_snapshot).quantile(1.) // NOLINT
+                                              : recent.quantile(m_delay_quantile);
+   m_lateness_quantile_ticks = quantile;
+   m_ts_set_sender_offset_ticks = std::clamp(quantile, m_delay_min_ticks, m_delay_max_ticks);
+}
+
+void
+TPRequestHandler::generate_opmon_data()
+{
+   inherited2::generate_opmon_data();
+
+   opmon::TPRequestHandlerInfo info;
+   info.set_tpset_delay_ticks( m_ts_set_sender_offset_ticks.load() );
+   info.set_lateness_quantile_ticks( m_lateness_quantile_ticks.load() );
+   info.set_late_tp_count( m_tp_lateness ? m_tp_lateness->late_count() : 0 );
+   info.set_index_hit_count( m_num_index_hits.load() );
+   info.set_index_miss_count( m_num_index_misses.load() );
+   this->publish(std::move(info));
+}
+
+bool
+TPRequestHandler::send_tpset(TPSet& tpset)
+{
+   if (m_packed_tpset_sink) {
+      // The TPSet stays here, and the packed bytes are reused unless the sender took them
+      pack(tpset, m_packed_tpset);
+      return m_packed_tpset_sink->try_send(std::move(m_packed_tpset), iomanager::Sender::s_no_block);
+   }
+   return m_tpset_sink->try_send(std::move(tpset), iomanager::Sender::s_no_block);
+}
+
+TPRequestHandler::tp_vector_t
+TPRequestHandler::take_tp_vector()
+{
+   if (m_tp_vector_pool.empty()) {
+      tp_vector_t tps;
+      tps.reserve(m_tp_vector_reserve);
+      return tps;
+   }
+   tp_vector_t tps = std::move(m_tp_vector_pool.back());
+   m_tp_vector_pool.pop_back();
+   return tps;
+}
+
+void
+TPRequestHandler::recycle_tp_vector(tp_vector_t&& tps)
+{
+   // A sender that moved the TPSet away left nothing to recycle
+   if (tps.capacity() == 0 || m_tp_vector_pool.size() >= s_tp_vector_pool_size) {
+      return;
+   }
+   // New vectors are reserved for the largest TPSet so far
+   m_tp_vector_reserve = std::max(m_tp_vector_reserve, tps.capacity());
+   tps.clear();
+   m_tp_vector_pool.push_back(std::move(tps));
+}
+
 } // namespace fdreadoutlibs
 } // namespace dunedaq
@@ -0,0 +1,55 @@
+/**
+ * @file AlgorithmTiming.hpp Sampled CPU cost of one trigger algorithm, for opmon
+ *
+ * This is part of the DUNE DAQ , copyright 2022.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef TRIGGER_SRC_TRIGGER_ALGORITHMTIMING_HPP_
+#define TRIGGER_SRC_TRIGGER_ALGORITHMTIMING_HPP_
+
+#include "trigger/CycleHistogram.hpp"
+#include "trigger/opmon/algorithm_timing_info.pb.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace trigger {
+
+struct AlgorithmTiming
+{
+  std::string algorithm;
+  // One per thread running the algorithm, e.g. per channel shard
+  std::vector<std::shared_ptr<CycleHistogram>> histograms;
+
+  std::shared_ptr<CycleHistogram> add_histogram(uint32_t sample_period) // NOLINT(build/unsigned)
+  {
+    histograms.push_back(std::make_shared<CycleHistogram>(sample_period));
+    return histograms.back();
+  }
+
+  opmon::AlgorithmTimingInfo opmon_info() const
+  {
+    CycleHistogram::Snapshot total;
+    for (auto& histogram : histograms) {
+      total.add(histogram->snapshot());
+    }
+    opmon::AlgorithmTimingInfo info;
+    info.set_call_count( total.call_count );
+    info.set_sampled_count( total.sampled_count );
+    info.set_total_ticks( total.total_ticks );
+    info.set_max_ticks( total.max_ticks );
+    info.set_ticks_per_us( CycleHistogram::ticks_per_us() );
+    for (auto count : total.buckets) {
+      info.add_bucket_counts( count );
+    }
+    return info;
+  }
+};
+
+} // namespace trigger
+} // namespace dunedaq
+
+#endif // TRIGGER_SRC_TRIGGER_ALGORITHMTIMING_HPP_
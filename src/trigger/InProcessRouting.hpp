@@ -0,0 +1,65 @@
+/**
+ * @file InProcessRouting.hpp Choice between iomanager and an in-process channel for trigger object connections
+ *
+ * This is part of the DUNE DAQ , copyright 2022.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef TRIGGER_SRC_TRIGGER_INPROCESSROUTING_HPP_
+#define TRIGGER_SRC_TRIGGER_INPROCESSROUTING_HPP_
+
+#include "iomanager/IOManager.hpp"
+#include "iomanager/Sender.hpp"
+#include "logging/Logging.hpp"
+#include "confmodel/Connection.hpp"
+#include "confmodel/NetworkConnection.hpp"
+
+#include "trigger/InProcessChannel.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace dunedaq {
+namespace trigger {
+
+// Trigger objects waiting between two modules of the same process
+constexpr size_t s_in_process_channel_capacity = 16384;
+
+/**
+ * @brief Receiving end: the in-process channel of an input connection, if it may have one
+ *
+ * Only point-to-point network connections qualify: with a queue, iomanager
+ * already moves objects without serializing them, and a publication may
+ * have subscribers in other processes too.
+ */
+template<typename T>
+std::shared_ptr<InProcessChannel<T>>
+open_in_process_channel(const confmodel::Connection* input)
+{
+  auto network_connection = input->cast<confmodel::NetworkConnection>();
+  if (network_connection == nullptr || network_connection->get_connection_type() != "kSendRecv") {
+    return nullptr;
+  }
+  return InProcessChannelRegistry::open<T>(input->UID(), s_in_process_channel_capacity);
+}
+
+/**
+ * @brief Sending end: send to an output connection by move if its receiver is in
+ * this process, through iomanager otherwise. The function does not block
+ */
+template<typename T>
+std::function<bool(T&&)>
+make_try_send(const std::string& connection, std::shared_ptr<iomanager::SenderConcept<T>> sink)
+{
+  if (auto channel = InProcessChannelRegistry::find<T>(connection)) {
+    TLOG() << "Receiver of " << connection << " is in this process, sending to it by move";
+    return [channel](T&& object) { return channel->try_push(std::move(object)); };
+  }
+  return [sink](T&& object) { return sink->try_send(std::move(object), iomanager::Sender::s_no_block); };
+}
+
+} // namespace trigger
+} // namespace dunedaq
+
+#endif // TRIGGER_SRC_TRIGGER_INPROCESSROUTING_HPP_
@@ -0,0 +1,170 @@
+/**
+ * @file ProcessorAttributes.hpp
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef TRIGGER_SRC_TRIGGER_PROCESSORATTRIBUTES_HPP_
+#define TRIGGER_SRC_TRIGGER_PROCESSORATTRIBUTES_HPP_
+
+#include "trigger/Issues.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dunedaq::trigger {
+
+/**
+ * @brief Typed access to the tuning attributes of a data processor configuration
+ *
+ * The attributes that tune the trigger processors and the TP request handler
+ * (ring capacities, batch sizes, spill rings, timing...) are read by name
+ * from the configuration object, through its JSON form, so that the same
+ * code serves objects whose class declares them and objects whose class
+ * does not yet. An attribute that is not set takes the default given by the
+ * caller, which is always the behaviour from before the attribute existed.
+ * An attribute that is set must hold a value of the requested type, within
+ * the given range: anything else is an InvalidConfiguration, rather than
+ * silently falling back to the default.
+ */
+class ProcessorAttributes
+{
+public:
+  ProcessorAttributes() = default;
+
+  ProcessorAttributes(std::string uid, nlohmann::json attributes)
+    : m_uid(std::move(uid))
+    , m_attributes(std::move(attributes))
+  {
+  }
+
+  /// @brief The attributes of an appmodel configuration object
+  template<class Conf>
+  static ProcessorAttributes of(const Conf* conf)
+  {
+    if (conf == nullptr) {
+      return ProcessorAttributes();
+    }
+    return ProcessorAttributes(conf->UID(), conf->to_json(true)[conf->UID()]);
+  }
+
+  bool has(const std::string& name) const
+  {
+    return m_attributes.is_object() && m_attributes.contains(name) && !m_attributes[name].is_null();
+  }
+
+  /**
+   * @brief The attribute of the given name, or default_value if it is not set
+   * @throw InvalidConfiguration if the attribute is set to a value that T cannot hold
+   */
+  template<class T>
+  T get(const std::string& name, const T& default_value) const
+  {
+    if (!has(name)) {
+      return default_value;
+    }
+    const auto& value = m_attributes[name];
+    if (!holds<T>(value)) {
+      throw InvalidConfiguration(ERS_HERE,
+                                 m_uid + ": attribute " + name + " = " + value.dump() + " is not a " + type_name<T>());
+    }
+    return value.get<T>();
+  }
+
+  /**
+   * @brief As get, for a number that must be within [min_value, max_value]
+   * @throw InvalidConfiguration if the attribute is set outside of the range
+   */
+  template<class T>
+  T get(const std::string& name,
+        const T& default_value,
+        const T& min_value,
+        const T& max_value = std::numeric_limits<T>::max()) const
+  {
+    static_assert(std::is_arithmetic_v<T>, "Only numbers have a range");
+    T value = get<T>(name, default_value);
+    if (value < min_value || value > max_value) {
+      throw InvalidConfiguration(ERS_HERE,
+                                 m_uid + ": attribute " + name + " = " + std::to_string(value) + " is outside of [" +
+                                   std::to_string(min_value) + ", " + std::to_string(max_value) + "]");
+    }
+    return value;
+  }
+
+  const std::string& uid() const { return m_uid; }
+
+private:
+  template<class T>
+  struct is_vector : std::false_type
+  {};
+
+  template<class T>
+  struct is_vector<std::vector<T>> : std::true_type
+  {};
+
+  template<class T>
+  static bool holds(const nlohmann::json& value)
+  {
+    if constexpr (std::is_same_v<T, bool>) {
+      return value.is_boolean();
+    } else if constexpr (std::is_integral_v<T>) {
+      // Integers written from a signed attribute are signed in the JSON, even when positive
+      if (value.is_number_unsigned()) {
+        return value.get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<T>::max()); // NOLINT
+      }
+      if (value.is_number_integer()) {
+        auto number = value.get<int64_t>();
+        return number >= 0 ? static_cast<uint64_t>(number) <= static_cast<uint64_t>(std::numeric_limits<T>::max()) // NOLINT
+                           : std::is_signed_v<T> && number >= static_cast<int64_t>(std::numeric_limits<T>::min());
+      }
+      return false;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return value.is_number();
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      return value.is_string();
+    } else if constexpr (is_vector<T>::value) {
+      if (!value.is_array()) {
+        return false;
+      }
+      for (const auto& element : value) {
+        if (!holds<typename T::value_type>(element)) {
+          return false;
+        }
+      }
+      return true;
+    } else {
+      static_assert(!sizeof(T*), "Unsupported attribute type");
+    }
+  }
+
+  template<class T>
+  static std::string type_name()
+  {
+    if constexpr (std::is_same_v<T, bool>) {
+      return "boolean";
+    } else if constexpr (std::is_integral_v<T>) {
+      return std::is_signed_v<T> ? "signed integer of " + std::to_string(8 * sizeof(T)) + " bits"
+                                 : "non-negative integer of " + std::to_string(8 * sizeof(T)) + " bits";
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return "number";
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      return "string";
+    } else {
+      return "list of " + type_name<typename T::value_type>();
+    }
+  }
+
+  std::string m_uid;
+  nlohmann::json m_attributes;
+};
+
+} // namespace dunedaq::trigger
+
+#endif // TRIGGER_SRC_TRIGGER_PROCESSORATTRIBUTES_HPP_
@@ -19,6 +19,11 @@
 #include "trigger/Issues.hpp"
 #include "trigger/TAWrapper.hpp"
 #include "trigger/Latency.hpp"
+#include "trigger/SetBatcher.hpp"
+#include "trigger/SpillingSender.hpp"
+#include "trigger/TCSet.hpp"
+#include "trigger/AlgorithmTiming.hpp"
+#include "trigger/InProcessRouting.hpp"
 #include "trigger/opmon/taprocessor_info.pb.h"
 #include "trigger/opmon/latency_info.pb.h"
 
@@ -59,21 +64,41 @@ protected:
    * Pipeline Stage 2.: Do TA finding
    * */
 
-  void find_tc(const TAWrapper* ta, std::shared_ptr<triggeralgs::TriggerCandidateMaker> tcm);
+  void find_tc(const TAWrapper* ta,
+               std::shared_ptr<triggeralgs::TriggerCandidateMaker> tcm,
+               std::shared_ptr<CycleHistogram> timing);
+
+  /**
+   * Pipeline Stage 3., batched: send the TCs collected in a TCSet
+   * */
+  void send_tc_set(TCSet&& tc_set);
 
   private:
 
   std::vector<std::shared_ptr<triggeralgs::TriggerCandidateMaker>> m_tcms;
 
+  // CPU cost of 1 in m_timing_sample_period calls to each TC maker; off (0) unless configured
+  uint32_t m_timing_sample_period{ 0 }; // NOLINT(build/unsigned)
+  std::vector<AlgorithmTiming> m_tc_timings;
+
   std::shared_ptr<iomanager::SenderConcept<triggeralgs::TriggerCandidate>> m_tc_sink;
 
+  // Optionally, TCs are sent in TCSets, to pay the per-message cost once per set
+  std::shared_ptr<iomanager::SenderConcept<TCSet>> m_tc_set_sink;
+  std::unique_ptr<SetBatcher<triggeralgs::TriggerCandidate>> m_tc_set_batcher;
+
+  // Retries what the TC or TCSet output does not take right away; only the one in use exists
+  std::unique_ptr<SpillingSender<triggeralgs::TriggerCandidate>> m_tc_spill;
+  std::unique_ptr<SpillingSender<TCSet>> m_tc_set_spill;
+
   daqdataformats::SourceID m_sourceid;
 
   using metric_counter_type = uint64_t;
   std::atomic<metric_counter_type> m_ta_received_count{ 0 };  // NOLINT(build/unsigned)
   std::atomic<metric_counter_type> m_tc_made_count{ 0 };
-  std::atomic<metric_counter_type> m_tc_sent_count{ 0 };
-  std::atomic<metric_counter_type> m_tc_failed_sent_count{ 0 };
+  // TCs sent and dropped, as counted by the spilling sender in use
+  metric_counter_type tc_sent_count() const;
+  metric_counter_type tc_failed_sent_count() const;
   void print_opmon_stats();
 
   // Create an instance of the Latency class
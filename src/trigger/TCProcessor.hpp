@@ -22,6 +22,8 @@
 #include "trigger/Issues.hpp"
 #include "trigger/TCWrapper.hpp"
 #include "trigger/Latency.hpp"
+#include "trigger/SpillingSender.hpp"
+#include "trigger/TDBuilder.hpp"
 #include "trigger/opmon/tcprocessor_info.pb.h"
 #include "trigger/opmon/latency_info.pb.h"
 
@@ -32,6 +34,10 @@
 #include "trgdataformats/Types.hpp"
 #include "triggeralgs/TriggerCandidate.hpp"
 
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace dunedaq {
 namespace trigger {
 
@@ -61,136 +67,35 @@ protected:
 
 private:
   using TCType = triggeralgs::TriggerCandidate::Type;
-  void send_trigger_decisions();
-  std::thread m_send_trigger_decisions_thread;
 
   // TD requests
-  std::vector<daqdataformats::SourceID> m_mandatory_links;
-  std::map<int, std::vector<daqdataformats::SourceID>> m_group_links;
   nlohmann::json m_group_links_data;
-  int m_total_group_links;
-  void parse_group_links(const nlohmann::json& data);
-  void print_group_links();
-
-  dfmessages::ComponentRequest create_request_for_link(daqdataformats::SourceID link,
-                                                       triggeralgs::timestamp_t start,
-                                                       triggeralgs::timestamp_t end);
-  std::vector<dfmessages::ComponentRequest> create_all_decision_requests(std::vector<daqdataformats::SourceID> links,
-                                                                         triggeralgs::timestamp_t start,
-                                                                         triggeralgs::timestamp_t end);
-  void add_requests_to_decision(dfmessages::TriggerDecision& decision,
-                                std::vector<dfmessages::ComponentRequest> requests);
+  void parse_group_links(const nlohmann::json& data, std::map<int, std::vector<dfmessages::SourceID>>& group_links);
 
   // ROI
-  bool m_use_roi_readout;
-  struct roi_group
-  {
-    int n_links;
-    float prob;
-    triggeralgs::timestamp_t time_window;
-    std::string mode;
-  };
-  std::map<int, roi_group> m_roi_conf;
   std::vector<const appmodel::ROIGroupConf*> m_roi_conf_data;
-  void parse_roi_conf(const std::vector<const appmodel::ROIGroupConf*>& data);
-  void print_roi_conf(std::map<int, roi_group> roi_conf);
-  std::vector<int> m_roi_conf_ids;
-  std::vector<float> m_roi_conf_probs;
-  std::vector<float> m_roi_conf_probs_c;
-  float get_random_num_float(float limit);
-  int get_random_num_int();
-  int pick_roi_group_conf();
-  void roi_readout_make_requests(dfmessages::TriggerDecision& decision);
-
-  int m_repeat_trigger_count{ 1 };
-  std::atomic<bool> m_hsi_passthrough;
-  std::atomic<bool> m_tc_merging;
-
-  /// @brief Ignore TCs that overlap with already made TD
-  bool m_ignore_tc_pileup;
-
-  dfmessages::trigger_number_t m_last_trigger_number;
-
-  dfmessages::run_number_t m_run_number;
-
-  std::atomic<bool> m_running_flag{ false };
-
-  // New buffering
-  struct PendingTD
-  {
-    std::vector<triggeralgs::TriggerCandidate> contributing_tcs;
-    triggeralgs::timestamp_t readout_start;
-    triggeralgs::timestamp_t readout_end;
-    int64_t walltime_expiration;
-  };
-  std::vector<PendingTD> m_pending_tds;
-  std::mutex m_td_vector_mutex;
-  std::condition_variable m_cv;
-
-  void add_tc(const triggeralgs::TriggerCandidate tc);
-  void add_tc_ignored(const triggeralgs::TriggerCandidate tc);
-  void call_tc_decision(const PendingTD& pending_td);
-  bool check_overlap(const triggeralgs::TriggerCandidate& tc, const PendingTD& pending_td);
-  //bool check_overlap_td(const PendingTD& pending_td);
-  bool check_td_readout_length(const PendingTD&);
-  void clear_td_vectors();
-  std::vector<PendingTD> get_ready_tds(std::vector<PendingTD>& pending_tds);
-  int64_t m_buffer_timeout;
-  int64_t m_td_readout_limit;
-  std::atomic<bool> m_send_timed_out_tds;
-  int m_earliest_tc_index;
-  int get_earliest_tc_index(const PendingTD& pending_td);
-
-  // Bitwords logic
-  bool m_use_bitwords;
-  nlohmann::json m_trigger_bitwords_json;
-  bool m_bitword_check;
-  std::bitset<64> m_TD_bitword;
-  std::vector<std::bitset<64>> m_trigger_bitwords;
-  std::bitset<64> get_TD_bitword(const PendingTD& ready_td);
-  void print_trigger_bitwords(std::vector<std::bitset<64>> trigger_bitwords);
-  bool check_trigger_bitwords();
-  void print_bitword_flags(nlohmann::json m_trigger_bitwords_json);
-  void set_trigger_bitwords();
-  void set_trigger_bitwords(const std::vector<std::string>& _bitwords);
+  void parse_roi_conf(const std::vector<const appmodel::ROIGroupConf*>& data,
+                      std::vector<TDBuilderConfig::ROIGroup>& roi_groups);
 
   // Readout map config
-  bool m_use_readout_map;
-  std::vector<const appmodel::TCReadoutMap*>  m_readout_window_map_data;
-  std::map<TCType, std::pair<triggeralgs::timestamp_t, triggeralgs::timestamp_t>>
-    m_readout_window_map;
-  void parse_readout_map(const std::vector<const appmodel::TCReadoutMap*>& data);
-  void print_readout_map(std::map<TCType,
-                                  std::pair<triggeralgs::timestamp_t, triggeralgs::timestamp_t>> map);
-
-  // Create the next trigger decision
-  dfmessages::TriggerDecision create_decision(const PendingTD& pending_td);
-  dfmessages::trigger_type_t m_trigger_type_shifted;
+  std::vector<const appmodel::TCReadoutMap*> m_readout_window_map_data;
+  void parse_readout_map(const std::vector<const appmodel::TCReadoutMap*>& data,
+                         std::map<TCType, TDBuilderConfig::readout_window_t>& readout_map);
 
-  // Optional list of TC types to ignore
-  std::vector<unsigned int> m_ignored_tc_types;
-  bool m_ignoring_tc_types;
-  bool check_trigger_type_ignore(unsigned int tc_type);
+  std::atomic<bool> m_send_timed_out_tds;
 
+  // Groups TCs into TDs on its own thread, and passes them to send_decision
+  TDBuilder m_td_builder;
+  SendOutcome send_decision(dfmessages::TriggerDecision&& decision, const PendingTD& pending_td);
 
  // output queue for TDs
   std::shared_ptr<iomanager::SenderConcept<dfmessages::TriggerDecision>> m_td_sink;
+  // Retries what the TD output does not take right away
+  std::unique_ptr<SpillingSender<dfmessages::TriggerDecision>> m_td_spill;
 
-  // opmon
-  using metric_counter_type = uint64_t; 
-  std::atomic<metric_counter_type> m_tds_created_count{ 0 };  // NOLINT(build/unsigned)
-  std::atomic<metric_counter_type> m_tds_sent_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_dropped_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_failed_bitword_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_cleared_count{ 0 };
-
-  // opmon: per TC
+  // opmon. The TD counters live in the TD builder
+  using metric_counter_type = TDBuilder::metric_counter_type;
   std::atomic<metric_counter_type> m_tc_received_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_created_tc_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_sent_tc_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_dropped_tc_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_failed_bitword_tc_count{ 0 };
-  std::atomic<metric_counter_type> m_tds_cleared_tc_count{ 0 };
   std::atomic<metric_counter_type> m_tc_ignored_count{ 0 };
 
   // latency
@@ -17,6 +17,13 @@
 //#include "triggger/Issues.hpp"
 #include "trigger/TriggerPrimitiveTypeAdapter.hpp"
 #include "trigger/Latency.hpp"
+#include "trigger/TAFindingPipeline.hpp"
+#include "trigger/SetBatcher.hpp"
+#include "trigger/SpillingSender.hpp"
+#include "trigger/TPLatenessTracker.hpp"
+#include "trigger/TASet.hpp"
+#include "trigger/AlgorithmTiming.hpp"
+#include "trigger/InProcessRouting.hpp"
 #include "trigger/opmon/tpprocessor_info.pb.h"
 #include "trigger/opmon/latency_info.pb.h"
 
@@ -26,6 +33,9 @@
 
 #include "appmodel/DataHandlerModule.hpp"
 
+#include <memory>
+#include <vector>
+
 namespace dunedaq {
 namespace trigger {
 
@@ -50,30 +60,55 @@ public:
 
   void generate_opmon_data() override;
 
+  /**
+   * TPs go through the TA finding pipeline: those rejected by the pre-filter
+   * stop there, and with the broadcast ring, TPs go into the ring instead of
+   * one queue per TA algorithm
+   * */
+  void postprocess_item(const TriggerPrimitiveTypeAdapter* item) override;
+
 protected:
   // Internals
   dunedaq::daqdataformats::timestamp_t m_previous_ts = 0;
   dunedaq::daqdataformats::timestamp_t m_current_ts = 0;
 
   /**
-   * Pipeline Stage 2.: Do TA finding
+   * Pipeline Stage 2.: Do TA finding, with the tasks of the TA finding pipeline
    * */
+  TAFindingPipeline m_ta_finding;
 
-  void find_ta(const TriggerPrimitiveTypeAdapter* tp,  std::shared_ptr<triggeralgs::TriggerActivityMaker> tam);
+  /**
+   * Pipeline Stage 3.: Send a TA, or add it to the TASet being filled
+   * */
+  void send_ta(triggeralgs::TriggerActivity&& ta);
+  void send_ta_set(TASet&& ta_set);
 
   private:
 
-  std::vector<std::shared_ptr<triggeralgs::TriggerActivityMaker>> m_tams;
+  // CPU cost of 1 in m_timing_sample_period calls to each TA maker; off (0) unless configured
+  uint32_t m_timing_sample_period{ 0 }; // NOLINT(build/unsigned)
+  std::vector<AlgorithmTiming> m_ta_timings;
+
+  // How late the TPs of this link arrive, for the transmission delay of the request handler
+  std::shared_ptr<TPLatenessTracker> m_tp_lateness;
 
   std::shared_ptr<iomanager::SenderConcept<triggeralgs::TriggerActivity>> m_ta_sink;
 
+  // Optionally, TAs are sent in TASets, to pay the per-message cost once per set
+  std::shared_ptr<iomanager::SenderConcept<TASet>> m_ta_set_sink;
+  std::unique_ptr<SetBatcher<triggeralgs::TriggerActivity>> m_ta_set_batcher;
+
+  // Retries what the TA or TASet output does not take right away; only the one in use exists
+  std::unique_ptr<SpillingSender<triggeralgs::TriggerActivity>> m_ta_spill;
+  std::unique_ptr<SpillingSender<TASet>> m_ta_set_spill;
+
   daqdataformats::SourceID m_sourceid;
 
   using metric_counter_type = uint64_t;
-  std::atomic<metric_counter_type> m_tp_received_count{ 0 };  // NOLINT(build/unsigned)
-  std::atomic<metric_counter_type> m_ta_made_count{ 0 };
-  std::atomic<metric_counter_type> m_ta_sent_count{ 0 };
-  std::atomic<metric_counter_type> m_ta_failed_sent_count{ 0 };
+  std::atomic<metric_counter_type> m_ta_made_count{ 0 };  // NOLINT(build/unsigned)
+  // TAs sent and dropped, as counted by the spilling sender in use
+  metric_counter_type ta_sent_count() const;
+  metric_counter_type ta_failed_sent_count() const;
   void print_opmon_stats();
 
   // Create an instance of the Latency class
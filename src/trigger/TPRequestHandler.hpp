@@ -13,6 +13,8 @@
 #include "iomanager/Sender.hpp"
 
 #include "appmodel/DataHandlerModule.hpp"
+#include "daqdataformats/Fragment.hpp"
+#include "dfmessages/DataRequest.hpp"
 
 #include "datahandlinglibs/ReadoutLogging.hpp"
 #include "datahandlinglibs/utils/ReusableThread.hpp"
@@ -23,10 +25,17 @@
 
 #include "trigger/TriggerPrimitiveTypeAdapter.hpp"
 #include "trigger/TPSet.hpp"
+#include "trigger/PackedTPSet.hpp"
+#include "trigger/TPLatenessTracker.hpp"
+#include "trigger/TimeBucketIndex.hpp"
+#include "trigger/opmon/tprequesthandler_info.pb.h"
  
 #include <atomic>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 using dunedaq::datahandlinglibs::logging::TLVL_WORK_STEPS;
 
@@ -62,11 +71,34 @@ public:
  
   void conf(const appmodel::DataHandlerModule* conf) override;
   void start(const nlohmann::json& args) override;
+  /**
+   * Sends the TPs from the end of the last TPSet up to the transmission delay
+   * before the newest TP, walking forward from a cursor instead of collecting
+   * the whole window as fragment pieces
+   * */
   void periodic_data_transmission() override;
+
+  void generate_opmon_data() override;
+
+protected:
+  /**
+   * Windows that are in the buffer and in the time index are served from the
+   * index; anything else goes to the skip list handler
+   * */
+  RequestResult data_request(dfmessages::DataRequest dr) override;
+  /**
+   * Tells the time index which TPs the skip list cleanup removed
+   * */
+  void cleanup() override;
   
 private:
   using timestamp_t = std::uint64_t;
+  using tp_vector_t = std::vector<trgdataformats::TriggerPrimitive>;
   std::shared_ptr<iomanager::SenderConcept<dunedaq::trigger::TPSet>> m_tpset_sink;
+  // Set instead of m_tpset_sink when the output connection carries packed TPSets
+  std::shared_ptr<iomanager::SenderConcept<dunedaq::trigger::PackedTPSet>> m_packed_tpset_sink;
+  PackedTPSet m_packed_tpset;
+  bool send_tpset(TPSet& tpset);
   uint64_t m_run_number;
   uint64_t m_next_tpset_seqno;
 
@@ -75,7 +107,40 @@ private:
   timestamp_t m_start_win_ts=0;
   timestamp_t m_end_win_ts=0;
   bool m_first_cycle = true;
-  uint64_t m_ts_set_sender_offset_ticks = 6250000; // 100 ms delay in transmission
+  std::atomic<uint64_t> m_ts_set_sender_offset_ticks{ 6250000 }; // 100 ms delay in transmission
+
+  // The delay follows how late the TPs of this link arrive, between a floor
+  // and a ceiling. By default it covers the latest TP seen in the run; a
+  // quantile below 1 follows the recent TPs and gives up the latest ones to
+  // a shorter delay, and a quantile of 0 keeps the delay at the ceiling
+  std::shared_ptr<TPLatenessTracker> m_tp_lateness;
+  TPLatenessTracker::Snapshot m_lateness_snapshot;
+  TPLatenessTracker::Snapshot m_run_lateness_snapshot;
+  double m_delay_quantile{ 1. };
+  uint64_t m_delay_min_ticks{ 62500 };
+  uint64_t m_delay_max_ticks{ 6250000 };
+  uint64_t m_delay_min_samples{ 10000 };
+  std::atomic<uint64_t> m_lateness_quantile_ticks{ 0 };
+  void update_transmission_delay();
+
+  // Coarse time index over the buffer, built by the periodic transmission as
+  // it walks the TPs in time order, so that it and the data requests find the
+  // start of a window without searching the skip list
+  using tp_index_t = TimeBucketIndex<SkipListAcc::iterator>;
+  std::unique_ptr<tp_index_t> m_tp_index;
+  // Data requests only: the periodic transmission also seeks through the index
+  std::atomic<uint64_t> m_num_index_hits{ 0 };
+  std::atomic<uint64_t> m_num_index_misses{ 0 };
+  std::optional<SkipListAcc::iterator> find_in_index(SkipListAcc& acc, timestamp_t ts);
+  SkipListAcc::iterator seek(SkipListAcc& acc, timestamp_t ts);
+
+  // TPSet vectors, reserved up front and recycled from one period to the
+  // next: a sender that serializes the TPSet leaves the vector behind
+  static constexpr size_t s_tp_vector_pool_size = 4;
+  size_t m_tp_vector_reserve{ 1024 };
+  std::vector<tp_vector_t> m_tp_vector_pool;
+  tp_vector_t take_tp_vector();
+  void recycle_tp_vector(tp_vector_t&& tps);
 
 };
 
@@ -22,6 +22,8 @@
 #include "logging/Logging.hpp"
 #include "confmodel/DaqModule.hpp"
 #include "appmodel/DataSubscriberModule.hpp"
+#include "trigger/Issues.hpp"
+#include "trigger/PackedTPSet.hpp"
 #include "trigger/TPSet.hpp"
 #include "trigger/TriggerPrimitiveTypeAdapter.hpp"
 
@@ -53,7 +55,12 @@ public:
     if (cfg->get_inputs().size() != 1) {
       throw datahandlinglibs::InitializationError(ERS_HERE, "Only 1 input supported for subscribers");
     }
-    m_data_receiver = get_iom_receiver<trigger::TPSet>(cfg->get_inputs()[0]->UID());
+    // The data type of the connection tells whether its TPSets are packed
+    if (cfg->get_inputs()[0]->get_data_type() == "PackedTPSet") {
+      m_packed_receiver = get_iom_receiver<trigger::PackedTPSet>(cfg->get_inputs()[0]->UID());
+    } else {
+      m_data_receiver = get_iom_receiver<trigger::TPSet>(cfg->get_inputs()[0]->UID());
+    }
 /*
     auto data_reader = cfg->cast<appmodel::DataSubscriberModule>();
     if (data_reader == nullptr) {
@@ -70,11 +77,31 @@ public:
   }
 
   void start() {
-    m_data_receiver->add_callback(std::bind(&TPSetSourceModel::handle_payload, this, std::placeholders::_1));
+    if (m_packed_receiver) {
+      m_packed_receiver->add_callback(std::bind(&TPSetSourceModel::handle_packed, this, std::placeholders::_1));
+    } else {
+      m_data_receiver->add_callback(std::bind(&TPSetSourceModel::handle_payload, this, std::placeholders::_1));
+    }
   }  
 
   void stop() {
-    m_data_receiver->remove_callback();
+    if (m_packed_receiver) {
+      m_packed_receiver->remove_callback();
+    } else {
+      m_data_receiver->remove_callback();
+    }
+  }
+
+  void handle_packed(trigger::PackedTPSet& packed)
+  {
+    // Decoded into the same TPSet every time, so its TP vector is reused
+    try {
+      unpack(packed, m_unpacked);
+    } catch (const BadPackedTPSet& excpt) {
+      ers::warning(excpt);
+      return;
+    }
+    handle_payload(m_unpacked);
   }
 
   bool handle_payload(trigger::TPSet& data) // NOLINT(build/unsigned)
@@ -93,6 +120,10 @@ private:
   using source_t = dunedaq::iomanager::ReceiverConcept<trigger::TPSet>;
   std::shared_ptr<source_t> m_data_receiver;
 
+  using packed_source_t = dunedaq::iomanager::ReceiverConcept<trigger::PackedTPSet>;
+  std::shared_ptr<packed_source_t> m_packed_receiver;
+  trigger::TPSet m_unpacked;
+
   using sink_t = dunedaq::iomanager::SenderConcept<trigger::TriggerPrimitiveTypeAdapter>;
   std::shared_ptr<sink_t> m_data_sender;
 
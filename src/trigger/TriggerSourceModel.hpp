@@ -24,12 +24,25 @@
 #include "appmodel/DataSubscriberModule.hpp"
 #include "trigger/TAWrapper.hpp"
 #include "trigger/TCWrapper.hpp"
+#include "trigger/Set.hpp"
+#include "trigger/InProcessRouting.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
 
 //#include "appmodel/HSI2TCTranslatorConf.hpp" 
 //#include "appmodel/HSISignalWindow.hpp" 
 
 namespace dunedaq::trigger {
 
+// Whether a received object is a Set of trigger objects, to be passed on one object at a time
+template<class T>
+struct is_trigger_set : std::false_type {};
+
+template<class T>
+struct is_trigger_set<Set<T>> : std::true_type {};
 
 template<class TriggerXObject, class TXWrapper>
 class TriggerSourceModel : public datahandlinglibs::SourceConcept
@@ -55,6 +68,8 @@ public:
       throw datahandlinglibs::InitializationError(ERS_HERE, "Only 1 input supported for subscribers");
     }
     m_data_receiver = get_iom_receiver<TriggerXObject>(cfg->get_inputs()[0]->UID());
+    // A sender in this process finds this channel at conf and skips the network connection
+    m_in_process_channel = open_in_process_channel<TriggerXObject>(cfg->get_inputs()[0]);
 /*
     auto data_reader = cfg->cast<appmodel::DataSubscriberModule>();
     if (data_reader == nullptr) {
@@ -72,28 +87,81 @@ public:
 
   void start() {
     m_data_receiver->add_callback(std::bind(&TriggerSourceModel::handle_payload, this, std::placeholders::_1));
+    if (m_in_process_channel) {
+      // Objects pushed after the last stop, e.g. by a sender flushing at its own stop, belong to the last run
+      if (auto n_stale = m_in_process_channel->clear(); n_stale > 0) {
+        TLOG() << "Dropped " << n_stale << " objects left in the in-process channel by the last run";
+      }
+      m_running.store(true);
+      m_in_process_thread = std::thread(&TriggerSourceModel::run_in_process_channel, this);
+    }
   }  
 
   void stop() {
     m_data_receiver->remove_callback();
+    if (m_in_process_thread.joinable()) {
+      m_running.store(false);
+      m_in_process_channel->wake();
+      m_in_process_thread.join();
+    }
   }
 
   bool handle_payload(TriggerXObject& data) // NOLINT(build/unsigned)
   {
-    TXWrapper tx(data);
-    if (!m_data_sender->try_send(std::move(tx), iomanager::Sender::s_no_block)) {
-      ++m_dropped_packets;
+    if constexpr (is_trigger_set<TriggerXObject>::value) {
+      for (auto& object : data.objects) {
+        send_wrapped(object, &data.origin);
+      }
+    } else {
+      send_wrapped(data);
     }
     return true;
   }
 
 private:
+  // Objects from a sender in this process, which were moved rather than serialized
+  void run_in_process_channel()
+  {
+    TriggerXObject data;
+    while (true) {
+      // Read the flag first, so that everything pushed before stop is handled.
+      // Sleeps until a sender pushes, stop wakes it up
+      bool running = m_running.load();
+      bool popped = running ? m_in_process_channel->pop_wait(data, std::chrono::milliseconds(100))
+                            : m_in_process_channel->try_pop(data);
+      if (popped) {
+        handle_payload(data);
+      } else if (!running) {
+        break;
+      }
+    }
+  }
+
+  template<class T>
+  void send_wrapped(T& object, const daqdataformats::SourceID* origin = nullptr)
+  {
+    // The received object is not used again
+    TXWrapper tx(std::move(object));
+    if constexpr (std::is_same_v<TXWrapper, TCWrapper>) {
+      if (origin != nullptr) {
+        tx.set_origin(*origin);
+      }
+    }
+    if (!m_data_sender->try_send(std::move(tx), iomanager::Sender::s_no_block)) {
+      ++m_dropped_packets;
+    }
+  }
+
   using source_t = dunedaq::iomanager::ReceiverConcept<TriggerXObject>;
   std::shared_ptr<source_t> m_data_receiver;
 
   using sink_t = dunedaq::iomanager::SenderConcept<TXWrapper>;
   std::shared_ptr<sink_t> m_data_sender;
 
+  std::shared_ptr<InProcessChannel<TriggerXObject>> m_in_process_channel;
+  std::atomic<bool> m_running{ false };
+  std::thread m_in_process_thread;
+
   //Stats
   std::atomic<uint64_t> m_dropped_packets{0};
 };
@@ -0,0 +1,126 @@
+/**
+ * @file bitword_speed.cxx Measure the TD bitword check rate
+ *
+ * Compares TriggerBitwords, as used by TCProcessor, with the previous
+ * check: copy the TC types into a vector, std::unique them, set a
+ * std::bitset<64> and loop over the configured std::bitset<64> words.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "logging/Logging.hpp"
+#include "trigger/TriggerBitwords.hpp"
+#include "triggeralgs/TriggerCandidate.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Return the current steady clock in microseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_us()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+using TDs = std::vector<std::vector<triggeralgs::TriggerCandidate>>;
+
+// TDs built from a handful of TCs with types drawn from the first 8 types
+TDs
+make_tds(int n_tds, int tcs_per_td)
+{
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> type(1, 8);
+  TDs tds(n_tds, std::vector<triggeralgs::TriggerCandidate>(tcs_per_td));
+  for (auto& td : tds) {
+    for (auto& tc : td) {
+      tc.type = static_cast<triggeralgs::TriggerCandidate::Type>(type(generator));
+    }
+  }
+  return tds;
+}
+
+// Bitwords of one or two of the first 8 types
+std::vector<dunedaq::trigger::TriggerBitwords::word_t>
+make_words(int n_words)
+{
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> type(1, 8);
+  std::vector<dunedaq::trigger::TriggerBitwords::word_t> words;
+  for (int i = 0; i < n_words; ++i) {
+    words.push_back((uint64_t(1) << type(generator)) | (uint64_t(1) << type(generator))); // NOLINT(build/unsigned)
+  }
+  return words;
+}
+
+double
+time_bitsets(const TDs& tds, const std::vector<dunedaq::trigger::TriggerBitwords::word_t>& words, size_t& passed)
+{
+  std::vector<std::bitset<64>> bitwords(words.begin(), words.end());
+  passed = 0;
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  for (const auto& td : tds) {
+    std::vector<int> tc_types;
+    for (auto tc : td) {
+      tc_types.push_back(static_cast<int>(tc.type));
+    }
+    tc_types.erase(std::unique(tc_types.begin(), tc_types.end()), tc_types.end());
+    std::bitset<64> td_bitword;
+    for (auto tc_type : tc_types) {
+      td_bitword.set(tc_type);
+    }
+    bool trigger_check = false;
+    for (auto bitword : bitwords) {
+      trigger_check = ((td_bitword & bitword) == bitword);
+      if (trigger_check == true)
+        break;
+    }
+    passed += trigger_check;
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+  return tds.size() / (1e-6 * (end_time - start_time + 1));
+}
+
+double
+time_engine(const TDs& tds, const std::vector<dunedaq::trigger::TriggerBitwords::word_t>& words, size_t& passed)
+{
+  dunedaq::trigger::TriggerBitwords bitwords;
+  for (auto word : words) {
+    bitwords.add(word);
+  }
+  passed = 0;
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  for (const auto& td : tds) {
+    passed += bitwords.matches(dunedaq::trigger::TriggerBitwords::make_td_word(td));
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+  return tds.size() / (1e-6 * (end_time - start_time + 1));
+}
+
+} // namespace
+
+int
+main()
+{
+  const int n_tds = 200000;
+  TLOG() << "TCs/TD \tbitwords \tbitsets [TD/s] \tTriggerBitwords [TD/s] \tpassed";
+  for (int tcs_per_td : { 1, 4, 16 }) {
+    auto tds = make_tds(n_tds, tcs_per_td);
+    for (int n_words : { 1, 8, 32 }) {
+      auto words = make_words(n_words);
+      size_t bitset_passed = 0;
+      size_t engine_passed = 0;
+      double bitset_rate = time_bitsets(tds, words, bitset_passed);
+      double engine_rate = time_engine(tds, words, engine_passed);
+      TLOG() << tcs_per_td << " \t" << n_words << " \t\t" << bitset_rate << " \t" << engine_rate << " \t\t"
+             << bitset_passed << "/" << engine_passed;
+    }
+  }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file broadcast_ring_speed.cxx Measure TP fan-out to several TA algorithm threads
+ *
+ * Compares one SPSCRing per consumer, each getting its own copy of every
+ * TP (as with one post-processing queue per TA algorithm), with a single
+ * BroadcastRing whose slots all the consumers read in place.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "logging/Logging.hpp"
+#include "trigger/BroadcastRing.hpp"
+#include "trigger/SPSCRing.hpp"
+#include "triggeralgs/TriggerPrimitive.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Return the current steady clock in microseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_us()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+using TP = triggeralgs::TriggerPrimitive;
+
+const size_t s_capacity = 65536;
+
+double
+time_queues(int n_tps, size_t n_consumers, uint64_t& checksum) // NOLINT(build/unsigned)
+{
+  std::vector<std::unique_ptr<dunedaq::trigger::SPSCRing<TP>>> queues;
+  for (size_t i = 0; i < n_consumers; ++i) {
+    queues.push_back(std::make_unique<dunedaq::trigger::SPSCRing<TP>>(s_capacity));
+  }
+  std::vector<uint64_t> sums(n_consumers, 0); // NOLINT(build/unsigned)
+
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  std::vector<std::thread> consumers;
+  for (size_t i = 0; i < n_consumers; ++i) {
+    consumers.emplace_back([&, i] {
+      TP tp;
+      uint64_t sum = 0; // NOLINT(build/unsigned)
+      for (int n = 0; n < n_tps;) {
+        if (queues[i]->try_pop(tp)) {
+          sum += tp.time_start;
+          ++n;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      sums[i] = sum;
+    });
+  }
+  for (int n = 0; n < n_tps; ++n) {
+    TP tp;
+    tp.time_start = n;
+    for (auto& queue : queues) {
+      TP copy = tp;
+      while (!queue->try_push(std::move(copy))) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+  checksum = 0;
+  for (auto sum : sums) {
+    checksum += sum;
+  }
+  return n_tps / (1e-6 * (end_time - start_time + 1));
+}
+
+double
+time_broadcast(int n_tps, size_t n_consumers, uint64_t& checksum) // NOLINT(build/unsigned)
+{
+  dunedaq::trigger::BroadcastRing<TP> ring(s_capacity, n_consumers);
+  std::vector<uint64_t> sums(n_consumers, 0); // NOLINT(build/unsigned)
+
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  std::vector<std::thread> consumers;
+  for (size_t i = 0; i < n_consumers; ++i) {
+    consumers.emplace_back([&, i] {
+      uint64_t sum = 0; // NOLINT(build/unsigned)
+      for (int n = 0; n < n_tps;) {
+        size_t n_read = ring.read(i, [&](const TP& tp) { sum += tp.time_start; }, 256);
+        if (n_read == 0) {
+          std::this_thread::yield();
+        }
+        n += n_read;
+      }
+      sums[i] = sum;
+    });
+  }
+  for (int n = 0; n < n_tps; ++n) {
+    TP tp;
+    tp.time_start = n;
+    while (!ring.try_push(tp)) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+  checksum = 0;
+  for (auto sum : sums) {
+    checksum += sum;
+  }
+  return n_tps / (1e-6 * (end_time - start_time + 1));
+}
+
+} // namespace
+
+int
+main()
+{
+  const int n_tps = 2000000;
+  TLOG() << "consumers \tqueue per consumer [TP/s] \tbroadcast ring [TP/s] \tchecksums";
+  for (size_t n_consumers : { 1, 2, 4, 8 }) {
+    uint64_t queue_checksum = 0;     // NOLINT(build/unsigned)
+    uint64_t broadcast_checksum = 0; // NOLINT(build/unsigned)
+    double queue_rate = time_queues(n_tps, n_consumers, queue_checksum);
+    double broadcast_rate = time_broadcast(n_tps, n_consumers, broadcast_checksum);
+    TLOG() << n_consumers << " \t\t" << queue_rate << " \t\t\t" << broadcast_rate << " \t\t"
+           << (queue_checksum == broadcast_checksum ? "match" : "MISMATCH");
+  }
+}
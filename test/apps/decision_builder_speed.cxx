@@ -0,0 +1,138 @@
+/**
+ * @file decision_builder_speed.cxx Measure the cost of filling TD component requests against link count
+ *
+ * Compares the DecisionRequestBuilder used by TCProcessor with the
+ * per-TD assembly (by-value link and request vectors, push_back per link)
+ * that it replaced.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "logging/Logging.hpp"
+#include "trigger/DecisionRequestBuilder.hpp"
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+// Return the current steady clock in nanoseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_ns()
+{
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+using dunedaq::dfmessages::ComponentRequest;
+using dunedaq::dfmessages::SourceID;
+using dunedaq::dfmessages::TriggerDecision;
+using timestamp_t = triggeralgs::timestamp_t;
+
+std::vector<ComponentRequest>
+create_all_decision_requests(std::vector<SourceID> links, timestamp_t start, timestamp_t end)
+{
+  std::vector<ComponentRequest> requests;
+  for (auto link : links) {
+    ComponentRequest request;
+    request.component = link;
+    request.window_begin = start;
+    request.window_end = end;
+    requests.push_back(request);
+  }
+  return requests;
+}
+
+void
+add_requests_to_decision(TriggerDecision& decision, std::vector<ComponentRequest> requests)
+{
+  for (auto request : requests) {
+    decision.components.push_back(request);
+  }
+}
+
+// Half the links are mandatory, and the enabled list repeats all of them
+// (as the TriggerDataHandlerModule config does); the rest are in 4 groups
+void
+make_links(int n_links, std::vector<SourceID>& mandatory, std::map<int, std::vector<SourceID>>& groups)
+{
+  mandatory.clear();
+  groups.clear();
+  for (int i = 0; i < n_links; ++i) {
+    SourceID link{ SourceID::Subsystem::kDetectorReadout, static_cast<SourceID::ID_t>(i) };
+    if (i % 2 == 0) {
+      mandatory.push_back(link);
+    } else {
+      groups[i % 4 / 2 + 2 * (i % 8 / 4)].push_back(link);
+    }
+  }
+  auto enabled = mandatory;
+  mandatory.insert(mandatory.end(), enabled.begin(), enabled.end());
+}
+
+double
+time_per_td_assembly(int n_tds,
+                     const std::vector<SourceID>& mandatory,
+                     const std::map<int, std::vector<SourceID>>& groups,
+                     size_t& n_components)
+{
+  n_components = 0;
+  uint64_t start_time = now_ns(); // NOLINT(build/unsigned)
+  for (int i = 0; i < n_tds; ++i) {
+    TriggerDecision decision;
+    auto requests = create_all_decision_requests(mandatory, i, i + 1000);
+    add_requests_to_decision(decision, requests);
+    for (const auto& [key, value] : groups) {
+      auto group_requests = create_all_decision_requests(value, i, i + 1000);
+      add_requests_to_decision(decision, group_requests);
+    }
+    n_components += decision.components.size();
+  }
+  uint64_t end_time = now_ns(); // NOLINT(build/unsigned)
+  return static_cast<double>(end_time - start_time) / n_tds;
+}
+
+double
+time_builder(int n_tds,
+             const std::vector<SourceID>& mandatory,
+             const std::map<int, std::vector<SourceID>>& groups,
+             size_t& n_components)
+{
+  dunedaq::trigger::DecisionRequestBuilder builder;
+  builder.configure(mandatory, groups);
+
+  n_components = 0;
+  uint64_t start_time = now_ns(); // NOLINT(build/unsigned)
+  for (int i = 0; i < n_tds; ++i) {
+    TriggerDecision decision;
+    decision.components.reserve(builder.max_components());
+    builder.add_readout_requests(decision, i, i + 1000);
+    n_components += decision.components.size();
+  }
+  uint64_t end_time = now_ns(); // NOLINT(build/unsigned)
+  return static_cast<double>(end_time - start_time) / n_tds;
+}
+
+} // namespace
+
+int
+main()
+{
+  const int n_tds = 20000;
+  std::vector<int> link_counts{ 1, 10, 100, 500, 1000, 2000 };
+  TLOG() << "Links \tper-TD assembly [ns/TD] \tbuilder [ns/TD] \tcomponents/TD";
+  for (auto n_links : link_counts) {
+    std::vector<SourceID> mandatory;
+    std::map<int, std::vector<SourceID>> groups;
+    make_links(n_links, mandatory, groups);
+    size_t old_components = 0;
+    size_t new_components = 0;
+    double old_ns = time_per_td_assembly(n_tds, mandatory, groups, old_components);
+    double new_ns = time_builder(n_tds, mandatory, groups, new_components);
+    TLOG() << n_links << " \t" << old_ns << " \t\t\t" << new_ns << " \t\t" << old_components / n_tds << "/"
+           << new_components / n_tds;
+  }
+}
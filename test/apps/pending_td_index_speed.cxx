@@ -0,0 +1,118 @@
+/**
+ * @file pending_td_index_speed.cxx Measure TC ingestion rate against the number of pending TDs
+ *
+ * Compares the PendingTDIndex overlap lookup used by TCProcessor with the
+ * linear scan over a flat vector of pending TDs that it replaced.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "logging/Logging.hpp"
+#include "trigger/PendingTDIndex.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Return the current steady clock in microseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_us()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+const triggeralgs::timestamp_t window_length = 1000;
+const triggeralgs::timestamp_t window_spacing = 10000;
+
+dunedaq::trigger::PendingTD
+make_pending_td(triggeralgs::timestamp_t start)
+{
+  dunedaq::trigger::PendingTD td;
+  td.readout_start = start;
+  td.readout_end = start + window_length;
+  td.walltime_expiration = 0;
+  return td;
+}
+
+// TC windows land anywhere in the range covered by the pending TDs, so
+// roughly one in ten of them overlaps a TD
+std::vector<triggeralgs::timestamp_t>
+make_tc_starts(int n_tcs, int depth)
+{
+  std::default_random_engine generator;
+  std::uniform_int_distribution<triggeralgs::timestamp_t> uniform(0, depth * window_spacing);
+  std::vector<triggeralgs::timestamp_t> starts(n_tcs);
+  for (auto& start : starts) {
+    start = uniform(generator);
+  }
+  return starts;
+}
+
+double
+time_flat_vector(int depth, const std::vector<triggeralgs::timestamp_t>& tc_starts, size_t& overlaps)
+{
+  std::vector<dunedaq::trigger::PendingTD> pending_tds;
+  for (int i = 0; i < depth; ++i) {
+    pending_tds.push_back(make_pending_td(i * window_spacing));
+  }
+
+  overlaps = 0;
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  for (auto tc_start : tc_starts) {
+    auto tc_end = tc_start + window_length / 10;
+    for (auto& td : pending_tds) {
+      if (!((tc_end < td.readout_start) || (tc_start > td.readout_end))) {
+        ++overlaps;
+        break;
+      }
+    }
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+
+  return tc_starts.size() / (1e-6 * (end_time - start_time + 1));
+}
+
+double
+time_index(int depth, const std::vector<triggeralgs::timestamp_t>& tc_starts, size_t& overlaps)
+{
+  dunedaq::trigger::PendingTDIndex pending_tds;
+  for (int i = 0; i < depth; ++i) {
+    pending_tds.insert(make_pending_td(i * window_spacing));
+  }
+
+  overlaps = 0;
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  for (auto tc_start : tc_starts) {
+    auto tc_end = tc_start + window_length / 10;
+    if (pending_tds.find_overlap(tc_start, tc_end) != pending_tds.end()) {
+      ++overlaps;
+    }
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+
+  return tc_starts.size() / (1e-6 * (end_time - start_time + 1));
+}
+
+} // namespace
+
+int
+main()
+{
+  const int n_tcs = 200000;
+  std::vector<int> depths{ 1, 10, 100, 1000, 10000 };
+  TLOG() << "Pending TDs \tflat vector [TC/s] \tindex [TC/s] \toverlapping TCs";
+  for (auto depth : depths) {
+    auto tc_starts = make_tc_starts(n_tcs, depth);
+    size_t vector_overlaps = 0;
+    size_t index_overlaps = 0;
+    double vector_rate = time_flat_vector(depth, tc_starts, vector_overlaps);
+    double index_rate = time_index(depth, tc_starts, index_overlaps);
+    TLOG() << depth << " \t\t" << vector_rate << " \t\t" << index_rate << " \t\t" << vector_overlaps << "/"
+           << index_overlaps;
+  }
+}
@@ -1,5 +1,5 @@
 /**
- * @file set_serialization_speed.cxx Test the amount of time it takes to serialize a TASet
+ * @file set_serialization_speed.cxx Test the amount of time it takes to serialize a TPSet, with msgpack and packed
  *
  * This is part of the DUNE DAQ Application Framework, copyright 2020.
  * Licensing/copyright details are in the COPYING file that you should have
@@ -8,14 +8,17 @@
 
 #include "logging/Logging.hpp"
 #include "serialization/Serialization.hpp"
+#include "trigger/PackedTPSet.hpp"
 #include "trigger/TASet.hpp"
 #include "trigger/TPSet.hpp"
 #include "triggeralgs/TriggerPrimitive.hpp"
 #include "trgdataformats/Types.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <random>
+#include <string>
 #include <vector>
 
 // Return the current steady clock in microseconds
@@ -27,10 +30,27 @@ now_us()
   return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
+void
+report(const std::string& codec,
+       int n_sets,
+       int tps_per_set,
+       size_t n_bytes,
+       uint64_t encode_us, // NOLINT(build/unsigned)
+       uint64_t decode_us) // NOLINT(build/unsigned)
+{
+  const int N = n_sets;
+  double bytes_per_tp = tps_per_set > 0 ? static_cast<double>(n_bytes) / (N * tps_per_set) : 0.;
+  double encode_kHz = 1e-3 * tps_per_set * N / (1e-6 * std::max<uint64_t>(encode_us, 1)); // NOLINT(build/unsigned)
+  double decode_kHz = 1e-3 * tps_per_set * N / (1e-6 * std::max<uint64_t>(decode_us, 1)); // NOLINT(build/unsigned)
+  TLOG() << "  " << codec << ": " << 1. * n_bytes / N << " bytes per set, " << bytes_per_tp << " bytes per TP, encoded at "
+         << encode_kHz << " kHz of TPs, decoded at " << decode_kHz << " kHz of TPs";
+}
+
 void
 time_serialization(int tps_per_set)
 {
-  const int N = 100000;
+  // Fewer of the biggest sets, to keep both encodings of all of them in memory
+  const int N = tps_per_set > 100 ? 10000 : 100000;
   int total = 0;
 
   std::default_random_engine generator;
@@ -44,9 +64,10 @@ time_serialization(int tps_per_set)
     set.end_time = (i + 2) * 5000 - 1;
     for (int j = 0; j < tps_per_set; ++j) {
       triggeralgs::TriggerPrimitive tp;
-      tp.time_start = 1234963454;
-      tp.time_peak = tp.time_start + 10000;
+      // In time order within the set, as TPRequestHandler sends them
+      tp.time_start = set.start_time + j * 5000 / tps_per_set;
       tp.time_over_threshold = uniform(generator);
+      tp.time_peak = tp.time_start + tp.time_over_threshold / 2;
       tp.channel = uniform(generator);
       tp.adc_integral = uniform(generator);
       tp.adc_peak = uniform(generator);
@@ -60,21 +81,47 @@ time_serialization(int tps_per_set)
     sets.push_back(set);
   }
 
+  // msgpack, as TPSet connections do
+  std::vector<std::vector<uint8_t>> msgpack_bytes(N); // NOLINT(build/unsigned)
   uint64_t start_time = now_us(); // NOLINT(build/unsigned)
-
   for (int i = 0; i < N; ++i) {
-    // NOLINTNEXTLINE(build/unsigned)
-    std::vector<uint8_t> bytes = dunedaq::serialization::serialize(sets[i], dunedaq::serialization::kMsgPack);
-    dunedaq::trigger::TPSet set_recv = dunedaq::serialization::deserialize<dunedaq::trigger::TPSet>(bytes);
+    msgpack_bytes[i] = dunedaq::serialization::serialize(sets[i], dunedaq::serialization::kMsgPack);
+  }
+  uint64_t encoded_time = now_us(); // NOLINT(build/unsigned)
+  for (int i = 0; i < N; ++i) {
+    dunedaq::trigger::TPSet set_recv = dunedaq::serialization::deserialize<dunedaq::trigger::TPSet>(msgpack_bytes[i]);
     total += set_recv.seqno;
   }
   uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+  size_t n_bytes = 0;
+  for (auto& bytes : msgpack_bytes) {
+    n_bytes += bytes.size();
+  }
+  report("msgpack", N, tps_per_set, n_bytes, encoded_time - start_time, end_time - encoded_time);
 
-  double time_taken_s = 1e-6 * (end_time - start_time);
-  double msg_kHz = 1e-3 * N / time_taken_s;
-  double tp_kHz = 1e-3 * tps_per_set * N / time_taken_s;
-  TLOG() << "Sent " << N << " messages in " << time_taken_s << " (" << msg_kHz << " kHz of msgs, " << tp_kHz
-         << " kHz of TPs) " << total;
+  // Packed, as PackedTPSet connections do: the packed bytes go through msgpack
+  // as one binary field
+  std::vector<std::vector<uint8_t>> packed_bytes(N); // NOLINT(build/unsigned)
+  dunedaq::trigger::PackedTPSet packed;
+  start_time = now_us();
+  for (int i = 0; i < N; ++i) {
+    dunedaq::trigger::pack(sets[i], packed);
+    packed_bytes[i] = dunedaq::serialization::serialize(packed, dunedaq::serialization::kMsgPack);
+  }
+  encoded_time = now_us();
+  dunedaq::trigger::TPSet set_recv;
+  for (int i = 0; i < N; ++i) {
+    packed = dunedaq::serialization::deserialize<dunedaq::trigger::PackedTPSet>(packed_bytes[i]);
+    dunedaq::trigger::unpack(packed, set_recv);
+    total += set_recv.seqno;
+  }
+  end_time = now_us();
+  n_bytes = 0;
+  for (auto& bytes : packed_bytes) {
+    n_bytes += bytes.size();
+  }
+  report("packed", N, tps_per_set, n_bytes, encoded_time - start_time, end_time - encoded_time);
+  TLOG() << "(checksum " << total << ")";
 }
 
 int
@@ -0,0 +1,153 @@
+/**
+ * @file ta_batch_speed.cxx Measure TA finding throughput against the number of TPs per batch
+ *
+ * Compares the per-TP TA finding of TPProcessor::find_ta (fresh output
+ * vector, latency flag loads and counter increments for every TP) with the
+ * batched mode (TABatchFinder, counters and flags once per batch), for
+ * 1, 16 and 256 TPs per batch.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "logging/Logging.hpp"
+#include "trigger/AlgorithmPlugins.hpp"
+#include "trigger/TABatchFinder.hpp"
+#include "triggeralgs/TriggerActivityMaker.hpp"
+#include "triggeralgs/TriggerPrimitive.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Return the current steady clock in microseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_us()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+using metric_counter_type = uint64_t; // NOLINT(build/unsigned)
+
+// Stand-ins for the TPProcessor state touched by TA finding
+struct ProcessorState
+{
+  std::atomic<bool> latency_monitoring{ true };
+  std::atomic<metric_counter_type> latency_in{ 0 };
+  std::atomic<metric_counter_type> latency_out{ 0 };
+  std::atomic<metric_counter_type> tp_received_count{ 0 };
+  std::atomic<metric_counter_type> ta_made_count{ 0 };
+  std::atomic<metric_counter_type> ta_sent_count{ 0 };
+};
+
+std::vector<triggeralgs::TriggerPrimitive>
+make_tps(int n_tps)
+{
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> channel(0, 2559);
+  std::uniform_int_distribution<int> adc(100, 10000);
+  std::vector<triggeralgs::TriggerPrimitive> tps(n_tps);
+  uint64_t time = 0; // NOLINT(build/unsigned)
+  for (auto& tp : tps) {
+    time += 32;
+    tp.time_start = time;
+    tp.channel = channel(generator);
+    tp.adc_integral = adc(generator);
+  }
+  return tps;
+}
+
+std::shared_ptr<triggeralgs::TriggerActivityMaker>
+make_maker(const std::string& plugin_name)
+{
+  std::shared_ptr<triggeralgs::TriggerActivityMaker> maker = dunedaq::trigger::make_ta_maker(plugin_name);
+  nlohmann::json config;
+  config["prescale"] = 100;
+  maker->configure(config);
+  return maker;
+}
+
+// As TPProcessor::find_ta, with a sink that always accepts
+double
+time_per_tp(const std::vector<triggeralgs::TriggerPrimitive>& tps, const std::string& plugin_name, ProcessorState& state)
+{
+  auto maker = make_maker(plugin_name);
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  for (const auto& tp : tps) {
+    if (state.latency_monitoring.load()) state.latency_in.store(tp.time_start);
+    state.tp_received_count++;
+    std::vector<triggeralgs::TriggerActivity> tas;
+    (*maker)(tp, tas);
+    while (tas.size()) {
+      state.ta_made_count++;
+      if (state.latency_monitoring.load()) state.latency_out.store(tas.back().time_start);
+      state.ta_sent_count++;
+      tas.pop_back();
+    }
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+  return tps.size() / (1e-6 * (end_time - start_time + 1));
+}
+
+// As TPProcessor::find_ta_batch and process_ta_batch, with a sink that always accepts
+double
+time_batched(const std::vector<triggeralgs::TriggerPrimitive>& tps,
+             const std::string& plugin_name,
+             size_t batch_size,
+             ProcessorState& state)
+{
+  dunedaq::trigger::TABatchFinder finder(make_maker(plugin_name), batch_size);
+  auto process_batch = [&] {
+    bool latency_monitoring = state.latency_monitoring.load();
+    if (latency_monitoring) state.latency_in.store(finder.batch().back().time_start);
+    metric_counter_type n_tps = finder.size();
+    auto& tas = finder.find();
+    for (auto& ta : tas) {
+      if (latency_monitoring) state.latency_out.store(ta.time_start);
+    }
+    state.tp_received_count += n_tps;
+    state.ta_made_count += tas.size();
+    state.ta_sent_count += tas.size();
+  };
+
+  uint64_t start_time = now_us(); // NOLINT(build/unsigned)
+  for (const auto& tp : tps) {
+    if (finder.add(tp)) {
+      process_batch();
+    }
+  }
+  if (!finder.empty()) {
+    process_batch();
+  }
+  uint64_t end_time = now_us(); // NOLINT(build/unsigned)
+  return tps.size() / (1e-6 * (end_time - start_time + 1));
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::string plugin_name = (argc > 1) ? argv[1] : "TriggerActivityMakerPrescalePlugin";
+  const int n_tps = 2000000;
+  auto tps = make_tps(n_tps);
+
+  ProcessorState state;
+  TLOG() << "TA maker: " << plugin_name;
+  TLOG() << "TPs/batch \tper TP [TP/s] \tbatched [TP/s] \tTAs made (both)";
+  for (size_t batch_size : { 1, 16, 256 }) {
+    state.ta_made_count = 0;
+    double per_tp_rate = time_per_tp(tps, plugin_name, state);
+    double batched_rate = time_batched(tps, plugin_name, batch_size, state);
+    TLOG() << batch_size << " \t\t" << per_tp_rate << " \t" << batched_rate << " \t" << state.ta_made_count;
+  }
+}
@@ -0,0 +1,261 @@
+/**
+ * @file tcprocessor_bench.cxx Drive the TCProcessor TD logic with synthetic TCs
+ *
+ * Runs the TDBuilder used by TCProcessor on its own: a producer thread
+ * pushes TCs at a fixed rate, as the TCProcessor post-processing task does,
+ * and the TDs go to an in-process sink instead of a connection. As there,
+ * each TC is copied into the handle the builder shares, in the measured
+ * loop. Reports the TD rate up to the last TC added, the time the last TDs
+ * then wait for the buffer timeout, the latency from the first contributing
+ * TC going in to the TD coming out, and the heap allocations per TD.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "CLI/CLI.hpp"
+
+#include "logging/Logging.hpp"
+#include "trigger/TDBuilder.hpp"
+#include "triggeralgs/TriggerCandidate.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> g_allocations{ 0 };
+
+// Return the current steady clock in nanoseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_ns()
+{
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+using dunedaq::dfmessages::SourceID;
+using dunedaq::trigger::PendingTD;
+using dunedaq::trigger::TCHandle;
+using dunedaq::trigger::TDBuilder;
+using dunedaq::trigger::TDBuilderConfig;
+using TCType = triggeralgs::TriggerCandidate::Type;
+using timestamp_t = triggeralgs::timestamp_t;
+
+// Readout half-window of the synthetic TCs, in ticks
+const timestamp_t s_half_window = 1000;
+
+/**
+ * TCs with increasing candidate times. A TC overlaps the readout window of
+ * the previous one with the given probability, and otherwise starts well
+ * clear of it. Types cycle through the given list.
+ */
+std::vector<triggeralgs::TriggerCandidate>
+make_tcs(size_t n_tcs, double overlap_fraction, const std::vector<int>& types)
+{
+  std::default_random_engine generator;
+  std::bernoulli_distribution overlap(overlap_fraction);
+  std::vector<triggeralgs::TriggerCandidate> tcs(n_tcs);
+  timestamp_t time = 10 * s_half_window;
+  for (size_t i = 0; i < n_tcs; ++i) {
+    time += overlap(generator) ? s_half_window : 8 * s_half_window;
+    auto& tc = tcs[i];
+    tc.type = static_cast<TCType>(types[i % types.size()]);
+    tc.time_candidate = time;
+    tc.time_start = time - s_half_window;
+    tc.time_end = time + s_half_window;
+  }
+  return tcs;
+}
+
+// Half the links are mandatory, the rest are spread over the link groups
+void
+make_links(int n_links, int n_groups, TDBuilderConfig& config)
+{
+  for (int i = 0; i < n_links; ++i) {
+    SourceID link{ SourceID::Subsystem::kDetectorReadout, static_cast<SourceID::ID_t>(i) };
+    if (i % 2 == 0 || n_groups == 0) {
+      config.mandatory_links.push_back(link);
+    } else {
+      config.group_links[(i / 2) % n_groups].push_back(link);
+    }
+  }
+}
+
+uint64_t // NOLINT(build/unsigned)
+percentile(std::vector<uint64_t>& values, double fraction) // NOLINT(build/unsigned)
+{
+  if (values.empty()) {
+    return 0;
+  }
+  auto nth = values.begin() + static_cast<size_t>(fraction * (values.size() - 1));
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+
+} // namespace
+
+void*
+operator new(size_t size)
+{
+  ++g_allocations;
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+int
+main(int argc, char** argv)
+{
+  CLI::App app{ "Drive the TCProcessor TD logic with synthetic TCs" };
+
+  double rate = 100000;
+  double duration = 5;
+  double overlap_fraction = 0.2;
+  std::vector<int> types{ 1, 2, 3 };
+  bool merge = false;
+  bool ignore_pileup = false;
+  bool watermark = false;
+  int64_t buffer_timeout = 10;
+  int n_links = 100;
+  int n_groups = 4;
+  bool roi = false;
+  app.add_option("-r,--rate", rate, "TC rate in Hz, 0 for as fast as possible");
+  app.add_option("-d,--duration", duration, "Seconds worth of TCs at the given rate (or at 1 MHz)");
+  app.add_option("-o,--overlap", overlap_fraction, "Fraction of TCs overlapping the previous TC");
+  app.add_option("-t,--types", types, "TC types, used in turn");
+  app.add_flag("-m,--merge", merge, "Merge overlapping TCs into one TD");
+  app.add_flag("-p,--ignore-pileup", ignore_pileup, "Drop TCs overlapping a pending TD");
+  app.add_flag("-w,--watermark", watermark, "Close TDs on the data-time watermark");
+  app.add_option("-b,--buffer-timeout", buffer_timeout, "TD buffer timeout in ms");
+  app.add_option("-l,--links", n_links, "Number of links to read out");
+  app.add_option("-g,--groups", n_groups, "Number of link groups");
+  app.add_flag("--roi", roi, "Read out a random half of the link groups per TD");
+
+  CLI11_PARSE(app, argc, argv);
+
+  if (types.empty()) {
+    types = { 1 };
+  }
+
+  TDBuilderConfig config;
+  config.merge_overlapping_tcs = merge;
+  config.ignore_overlapping_tcs = ignore_pileup;
+  config.close_on_watermark = watermark;
+  config.buffer_timeout = buffer_timeout;
+  make_links(n_links, n_groups, config);
+  if (roi && n_groups > 0) {
+    config.roi_groups.push_back({ std::max(n_groups / 2, 1), 1.0, 2 * s_half_window, "kRandom" });
+  }
+
+  size_t n_tcs = static_cast<size_t>((rate > 0 ? rate : 1e6) * duration);
+  auto tcs = make_tcs(n_tcs, overlap_fraction, types);
+  // Candidate times are sorted, so the sink finds a TC's push time by time
+  std::vector<timestamp_t> tc_times(n_tcs);
+  for (size_t i = 0; i < n_tcs; ++i) {
+    tc_times[i] = tcs[i].time_candidate;
+  }
+  // Written before the TC is pushed, so the builder thread sees it
+  std::vector<uint64_t> push_time_ns(n_tcs); // NOLINT(build/unsigned)
+
+  // Sink: only runs on the builder thread
+  std::vector<uint64_t> latency_ns; // NOLINT(build/unsigned)
+  latency_ns.reserve(n_tcs);
+  auto sink = [&](dunedaq::dfmessages::TriggerDecision&&, const PendingTD& pending_td) {
+    uint64_t now = now_ns(); // NOLINT(build/unsigned)
+    uint64_t first_in = now; // NOLINT(build/unsigned)
+    for (const auto& tc : pending_td.contributing_tcs) {
+      auto i = std::lower_bound(tc_times.begin(), tc_times.end(), tc.time_candidate) - tc_times.begin();
+      first_in = std::min(first_in, push_time_ns[i]);
+    }
+    latency_ns.push_back(now - first_in);
+    return dunedaq::trigger::SendOutcome::kSent;
+  };
+
+  TDBuilder builder;
+  builder.configure(config);
+
+  size_t allocations_before = g_allocations.load();
+  uint64_t start_time = now_ns(); // NOLINT(build/unsigned)
+  builder.start(sink);
+
+  // Producer, as the TCProcessor post-processing task: copy each TC into a handle and push it
+  std::thread producer([&] {
+    double period_ns = (rate > 0) ? 1e9 / rate : 0;
+    for (size_t i = 0; i < n_tcs; ++i) {
+      if (period_ns > 0) {
+        uint64_t due = start_time + static_cast<uint64_t>(i * period_ns); // NOLINT(build/unsigned)
+        while (now_ns() < due) {
+          std::this_thread::yield();
+        }
+      }
+      push_time_ns[i] = now_ns();
+      builder.push(TCHandle(std::make_shared<const triggeralgs::TriggerCandidate>(tcs[i])));
+    }
+  });
+  producer.join();
+
+  // The TD building is done once the builder has added every TC
+  auto& counters = builder.counters();
+  uint64_t give_up = now_ns() + 1000000000 + buffer_timeout * 2000000; // NOLINT(build/unsigned)
+  while (counters.tcs_added_count.load() < n_tcs && now_ns() < give_up) {
+    std::this_thread::yield();
+  }
+  uint64_t end_time = now_ns(); // NOLINT(build/unsigned)
+
+  // Let the last TDs expire before stopping, so they are sent and not cleared. That is
+  // waiting out the buffer timeout, not building, so it is timed on its own
+  auto tcs_accounted = [&] {
+    return counters.tds_created_tc_count.load() + counters.tds_failed_bitword_tc_count.load() +
+           counters.tc_pileup_dropped_count.load();
+  };
+  size_t tcs_open_at_last_tc = n_tcs - tcs_accounted();
+  while (tcs_accounted() < n_tcs && now_ns() < give_up) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  uint64_t tail_ns = now_ns() - end_time; // NOLINT(build/unsigned)
+  builder.stop();
+  size_t allocations = g_allocations.load() - allocations_before;
+
+  size_t n_tds = counters.tds_sent_count.load();
+  double elapsed_s = 1e-9 * (end_time - start_time);
+  TLOG() << "TC rate [Hz]: \t\t" << rate << " \t(achieved " << n_tcs / elapsed_s << ")";
+  TLOG() << "TCs: \t\t\t" << n_tcs << " \tof types " << types.size() << ", overlap " << overlap_fraction;
+  TLOG() << "Merge / ignore pileup: \t" << merge << " / " << ignore_pileup << ", watermark: " << watermark
+         << ", buffer timeout [ms]: " << buffer_timeout;
+  TLOG() << "Links: \t\t\t" << n_links << " \tin " << n_groups << " groups, ROI: " << roi;
+  TLOG() << "------------------------------";
+  TLOG() << "TDs sent: \t\t" << n_tds << " \t(" << counters.tds_sent_tc_count << " TCs)";
+  TLOG() << "TDs cleared: \t\t" << counters.tds_cleared_count << " \t(" << counters.tds_cleared_tc_count << " TCs)";
+  TLOG() << "TCs dropped as pileup: \t" << counters.tc_pileup_dropped_count;
+  TLOG() << "TC queue full: \t\t" << counters.tc_queue_full_count;
+  TLOG() << "TD rate [TD/s]: \t" << n_tds / elapsed_s << " \t(up to the last TC added)";
+  TLOG() << "TD timeout tail [ms]: \t" << 1e-6 * tail_ns << " \t(" << tcs_open_at_last_tc
+         << " TCs in TDs still open after the last TC)";
+  TLOG() << "Latency p50 [us]: \t" << 1e-3 * percentile(latency_ns, 0.5);
+  TLOG() << "Latency p99 [us]: \t" << 1e-3 * percentile(latency_ns, 0.99);
+  TLOG() << "Latency p999 [us]: \t" << 1e-3 * percentile(latency_ns, 0.999);
+  TLOG() << "Allocations / TD: \t" << (n_tds ? double(allocations) / n_tds : 0.0) << " \t("
+         << double(allocations) / n_tcs << " per TC)";
+}
@@ -0,0 +1,228 @@
+/**
+ * @file tp_index_speed.cxx Measure the latency of TP data requests against the depth of the TP latency buffer
+ *
+ * Compares a lower_bound on the skip list, as the skip list request handler
+ * does, with a seek through the TimeBucketIndex used by TPRequestHandler,
+ * while another thread fills the buffer and cleans it up from the front and
+ * a third one walks it and builds the index, as the periodic transmission does.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "logging/Logging.hpp"
+#include "trigger/TimeBucketIndex.hpp"
+#include "trigger/TriggerPrimitiveTypeAdapter.hpp"
+
+#include "folly/ConcurrentSkipList.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Return the current steady clock in nanoseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_ns()
+{
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+using dunedaq::trigger::TriggerPrimitiveTypeAdapter;
+using SkipList = folly::ConcurrentSkipList<TriggerPrimitiveTypeAdapter>;
+using Index = dunedaq::trigger::TimeBucketIndex<SkipList::Accessor::iterator>;
+using timestamp_t = uint64_t; // NOLINT(build/unsigned)
+
+// About 2 MHz of TPs on the 62.5 MHz clock, some of them arriving late
+const timestamp_t tp_spacing = 32;
+const timestamp_t max_lateness = 20000;
+// Requests of the usual TP readout window, and the transmission delay
+const timestamp_t window_length = 5000;
+const timestamp_t walker_delay = 62500;
+
+struct Latencies
+{
+  std::vector<uint64_t> lower_bound_ns; // NOLINT(build/unsigned)
+  std::vector<uint64_t> index_ns;       // NOLINT(build/unsigned)
+  size_t index_misses{ 0 };
+  size_t mismatches{ 0 };
+};
+
+TriggerPrimitiveTypeAdapter
+make_key(timestamp_t ts)
+{
+  TriggerPrimitiveTypeAdapter key;
+  key.tp.time_start = ts;
+  key.tp.channel = std::numeric_limits<decltype(key.tp.channel)>::lowest();
+  return key;
+}
+
+// The TPs of the window, as the request handler collects them
+size_t
+collect(SkipList::Accessor& acc, SkipList::Accessor::iterator it, timestamp_t end)
+{
+  size_t n = 0;
+  for (; it != acc.end() && it->get_timestamp() < end; ++it) {
+    ++n;
+  }
+  return n;
+}
+
+// As TPRequestHandler::find_in_index: the writer releases what it removes
+std::optional<SkipList::Accessor::iterator>
+find_in_index(const Index& index, SkipList::Accessor& acc, timestamp_t ts)
+{
+  auto entry = index.find(ts);
+  if (!entry) {
+    return std::nullopt;
+  }
+  auto it = entry->before;
+  while (it != acc.end() && it->get_timestamp() < ts) {
+    ++it;
+  }
+  return it;
+}
+
+uint64_t // NOLINT(build/unsigned)
+percentile(std::vector<uint64_t>& values, double q) // NOLINT(build/unsigned)
+{
+  if (values.empty()) {
+    return 0;
+  }
+  size_t i = std::min(values.size() - 1, static_cast<size_t>(q * values.size()));
+  std::nth_element(values.begin(), values.begin() + i, values.end());
+  return values[i];
+}
+
+Latencies
+time_requests(size_t depth, int n_requests)
+{
+  auto skip_list = SkipList::createInstance();
+  Index index;
+  std::atomic<timestamp_t> newest{ 0 };
+  std::atomic<timestamp_t> walked_until{ 0 };
+  std::atomic<bool> running{ true };
+
+  // Fill the buffer to its depth before the clock starts. The generator is
+  // the writer's from then on
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> channels(0, 3000);
+  std::uniform_int_distribution<timestamp_t> lateness(0, max_lateness);
+  std::bernoulli_distribution late(0.01);
+  auto make_tp = [&](timestamp_t now) {
+    TriggerPrimitiveTypeAdapter tp;
+    tp.tp.time_start = late(generator) ? now - std::min(now, lateness(generator)) : now;
+    tp.tp.channel = channels(generator);
+    return tp;
+  };
+  {
+    SkipList::Accessor acc(skip_list);
+    for (size_t i = 0; i < depth; ++i) {
+      acc.insert(make_tp(max_lateness + i * tp_spacing));
+    }
+    newest = max_lateness + depth * tp_spacing;
+  }
+
+  // The writer keeps the buffer at its depth, as the latency buffer and its cleanup do
+  std::thread writer([&] {
+    SkipList::Accessor acc(skip_list);
+    timestamp_t now = newest;
+    while (running) {
+      for (int i = 0; i < 1000; ++i) {
+        now += tp_spacing;
+        acc.insert(make_tp(now));
+      }
+      newest = now;
+      while (acc.size() > depth) {
+        acc.erase(*acc.first());
+      }
+      index.release(acc.first()->get_timestamp());
+    }
+  });
+
+  // The walker indexes the buffer up to the transmission delay, as the periodic transmission does
+  std::thread walker([&] {
+    timestamp_t cursor = 0;
+    while (running) {
+      {
+        SkipList::Accessor acc(skip_list);
+        timestamp_t end = newest - walker_delay;
+        auto start = find_in_index(index, acc, cursor);
+        for (auto it = start ? *start : acc.lower_bound(make_key(cursor));
+             it != acc.end() && it->get_timestamp() < end;
+             ++it) {
+          index.record(it, it->get_timestamp());
+        }
+        cursor = end;
+        walked_until = end;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  while (walked_until == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::default_random_engine request_generator;
+  Latencies latencies;
+  for (int i = 0; i < n_requests; ++i) {
+    SkipList::Accessor acc(skip_list);
+    // Anywhere between the head of the buffer and what the walker has seen
+    timestamp_t head = acc.first()->get_timestamp() + max_lateness;
+    timestamp_t tail = walked_until - window_length;
+    if (tail <= head) {
+      continue;
+    }
+    std::uniform_int_distribution<timestamp_t> uniform(head, tail);
+    timestamp_t start = uniform(request_generator);
+    timestamp_t end = start + window_length;
+
+    uint64_t t0 = now_ns(); // NOLINT(build/unsigned)
+    size_t n_lower_bound = collect(acc, acc.lower_bound(make_key(start)), end);
+    uint64_t t1 = now_ns(); // NOLINT(build/unsigned)
+    auto it = find_in_index(index, acc, start);
+    size_t n_index = it ? collect(acc, *it, end) : 0;
+    uint64_t t2 = now_ns(); // NOLINT(build/unsigned)
+
+    latencies.lower_bound_ns.push_back(t1 - t0);
+    if (it) {
+      latencies.index_ns.push_back(t2 - t1);
+      if (n_index != n_lower_bound) {
+        ++latencies.mismatches;
+      }
+    } else {
+      ++latencies.index_misses;
+    }
+  }
+
+  running = false;
+  writer.join();
+  walker.join();
+  return latencies;
+}
+
+} // namespace
+
+int
+main()
+{
+  const int n_requests = 100000;
+  std::vector<size_t> depths{ 10000, 100000, 1000000, 4000000 };
+  TLOG() << "Buffered TPs \tlower_bound p50/p99 [ns] \tindex p50/p99 [ns] \tindex misses \tmismatches";
+  for (auto depth : depths) {
+    auto latencies = time_requests(depth, n_requests);
+    TLOG() << depth << " \t\t" << percentile(latencies.lower_bound_ns, 0.5) << "/"
+           << percentile(latencies.lower_bound_ns, 0.99) << " \t\t\t" << percentile(latencies.index_ns, 0.5) << "/"
+           << percentile(latencies.index_ns, 0.99) << " \t\t" << latencies.index_misses << " \t\t"
+           << latencies.mismatches;
+  }
+}
@@ -0,0 +1,414 @@
+/**
+ * @file trigger_chain_driver.cxx Run the TP -> TA -> TC -> TD chain over a TP file as fast as possible
+ *
+ * Reads TPs from an HDF5 file, as generate_tpset_from_hdf5 does, and passes
+ * them through the logic of the trigger processors with the configured
+ * algorithms: the TA makers of TPProcessor, the TC makers of TAProcessor
+ * and the TDBuilder of TCProcessor. Objects go from one stage to the next
+ * in memory, with no connections and no pacing, so the numbers are the
+ * throughput of the algorithms and of the TD building themselves. Each TA
+ * algorithm sees every TP and each TC algorithm every TA, as in the
+ * processors; the outputs of several algorithms are put in time order
+ * before the next stage, as the latency buffers do. TDs are closed on the
+ * data-time watermark; only the last ones wait for the buffer timeout, which
+ * is reported on its own rather than in the TD building rate.
+ *
+ * On the TP side, the TPs go through the TAFindingPipeline of TPProcessor,
+ * with options of the same meaning as the TPDataProcessor attributes of the
+ * same name: the TP pre-filter, the broadcast ring that runs several TA
+ * algorithms on threads of their own, channel-sharded TA finding, batched
+ * TA finding and TASet batching. Without the ring, the TPs that pass the
+ * filter are queued, as for the post-processing threads of TPProcessor,
+ * and each algorithm is timed over the queue on its own. Unlike
+ * TPProcessor, a full broadcast ring is waited for rather than dropping
+ * TPs, so that every run sees the same TPs.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "CLI/CLI.hpp"
+
+#include "logging/Logging.hpp"
+#include "trigger/AlgorithmPlugins.hpp"
+#include "trigger/SetBatcher.hpp"
+#include "trigger/TAFindingPipeline.hpp"
+#include "trigger/TASet.hpp"
+#include "trigger/TDBuilder.hpp"
+#include "trigger/TriggerPrimitiveTypeAdapter.hpp"
+#include "trgdataformats/TriggerPrimitive.hpp"
+#include "triggeralgs/TriggerActivity.hpp"
+#include "triggeralgs/TriggerCandidate.hpp"
+
+#include "daqdataformats/Fragment.hpp"
+#include "daqdataformats/SourceID.hpp"
+#include "hdf5libs/HDF5RawDataFile.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Return the current steady clock in microseconds
+inline uint64_t // NOLINT(build/unsigned)
+now_us()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+using dunedaq::trigger::PendingTD;
+using dunedaq::trigger::TAFindingPipeline;
+using dunedaq::trigger::TCHandle;
+using dunedaq::trigger::TDBuilder;
+using dunedaq::trigger::TDBuilderConfig;
+using timestamp_t = triggeralgs::timestamp_t;
+using TP = triggeralgs::TriggerPrimitive;
+using TPAdapter = dunedaq::trigger::TriggerPrimitiveTypeAdapter;
+using TA = triggeralgs::TriggerActivity;
+
+// The TASets of TPProcessor, as configured by its TPDataProcessor attributes
+struct TASetOptions
+{
+  size_t ta_set_max_objects{ 0 };
+  timestamp_t ta_set_max_time_span{ 62500 };
+  int64_t ta_set_max_delay_us{ 1000 };
+};
+
+// Where the TA finders put their TAs, from any thread: straight into the
+// output, or through a SetBatcher into TASets first, as TPProcessor sends them
+class TASink
+{
+public:
+  explicit TASink(const TASetOptions& options)
+  {
+    if (options.ta_set_max_objects > 0) {
+      m_batcher = std::make_unique<dunedaq::trigger::SetBatcher<TA>>(
+        options.ta_set_max_objects,
+        options.ta_set_max_time_span,
+        std::chrono::microseconds(options.ta_set_max_delay_us));
+      m_batcher->start(
+        [this](dunedaq::trigger::TASet&& ta_set) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          ++m_n_sets;
+          std::move(ta_set.objects.begin(), ta_set.objects.end(), std::back_inserter(m_tas));
+        },
+        dunedaq::trigger::TASet::origin_t(),
+        "ta-set");
+    }
+  }
+
+  void send(TA&& ta)
+  {
+    ++m_n_sent;
+    if (m_batcher) {
+      auto ta_time_start = ta.time_start;
+      m_batcher->add(std::move(ta), ta_time_start);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tas.push_back(std::move(ta));
+  }
+
+  /// @brief Send the last TASet, and take all the TAs
+  std::vector<TA> finish()
+  {
+    if (m_batcher) {
+      m_batcher->stop();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::move(m_tas);
+  }
+
+  size_t n_sent() const { return m_n_sent.load(); }
+  size_t n_sets() const { return m_n_sets; }
+
+private:
+  std::unique_ptr<dunedaq::trigger::SetBatcher<TA>> m_batcher;
+  std::mutex m_mutex;
+  std::vector<TA> m_tas;
+  std::atomic<size_t> m_n_sent{ 0 };
+  size_t m_n_sets{ 0 };
+};
+
+// The TPs of the file, in time order, or nothing if the file cannot be used
+std::vector<triggeralgs::TriggerPrimitive>
+read_tps(const std::string& filename)
+{
+  std::vector<triggeralgs::TriggerPrimitive> tps;
+  dunedaq::hdf5libs::HDF5RawDataFile input_file(filename);
+  if (!input_file.is_timeslice_type()) {
+    TLOG() << "Not a timeslice type: " << filename;
+    return {};
+  }
+  for (auto& fragment_path : input_file.get_all_fragment_dataset_paths()) {
+    auto frag = input_file.get_frag_ptr(fragment_path);
+    if (frag->get_fragment_type() != dunedaq::daqdataformats::FragmentType::kTriggerPrimitive ||
+        frag->get_element_id().subsystem != dunedaq::daqdataformats::SourceID::Subsystem::kTrigger) {
+      continue;
+    }
+    size_t num_tps = frag->get_data_size() / sizeof(dunedaq::trgdataformats::TriggerPrimitive);
+    auto tp_array = static_cast<dunedaq::trgdataformats::TriggerPrimitive*>(frag->get_data());
+    for (size_t i = 0; i < num_tps; ++i) {
+      if (!tps.empty() && tp_array[i].time_start < tps.back().time_start) {
+        TLOG() << "TPs are unsorted in " << filename;
+        return {};
+      }
+      tps.push_back(tp_array[i]);
+    }
+  }
+  return tps;
+}
+
+// The file played loops times in a row, shifted in time as TriggerPrimitiveMaker does
+void
+repeat_tps(std::vector<triggeralgs::TriggerPrimitive>& tps, int loops)
+{
+  if (tps.empty() || loops <= 1) {
+    return;
+  }
+  size_t n_tps = tps.size();
+  timestamp_t duration = tps.back().time_start - tps.front().time_start + 1;
+  tps.reserve(n_tps * loops);
+  for (int loop = 1; loop < loops; ++loop) {
+    for (size_t i = 0; i < n_tps; ++i) {
+      auto tp = tps[i];
+      tp.time_start += loop * duration;
+      tp.time_peak += loop * duration;
+      tps.push_back(tp);
+    }
+  }
+}
+
+struct StageResult
+{
+  std::string name;
+  size_t n_in{ 0 };
+  size_t n_out{ 0 };
+  uint64_t time_us{ 0 }; // NOLINT(build/unsigned)
+};
+
+void
+print_stage(const StageResult& stage)
+{
+  double seconds = 1e-6 * std::max<uint64_t>(stage.time_us, 1); // NOLINT(build/unsigned)
+  TLOG() << stage.name << " \t" << stage.n_in << " \t" << stage.n_out << " \t" << 1e-3 * stage.time_us << " \t"
+         << stage.n_in / seconds;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  CLI::App app{ "Run the TP -> TA -> TC -> TD chain over a TP file as fast as possible" };
+
+  std::string filename;
+  std::vector<std::string> ta_algorithms{ "TriggerActivityMakerPrescalePlugin" };
+  std::string ta_config = R"({"prescale": 100})";
+  std::vector<std::string> tc_algorithms{ "TriggerCandidateMakerPrescalePlugin" };
+  std::string tc_config = R"({"prescale": 10})";
+  int loops = 1;
+  dunedaq::trigger::TAFindingConfig tp_side;
+  auto& filter_config = tp_side.filter;
+  TASetOptions ta_set_options;
+  int n_links = 10;
+  timestamp_t watermark_margin = 0;
+  int64_t buffer_timeout = 10;
+  app.add_option("-f,--file", filename, "Input HDF5 file")->required();
+  app.add_option("-a,--ta-algorithms", ta_algorithms, "TA maker plugins");
+  app.add_option("--ta-config", ta_config, "JSON configuration of the TA makers");
+  app.add_option("-c,--tc-algorithms", tc_algorithms, "TC maker plugins");
+  app.add_option("--tc-config", tc_config, "JSON configuration of the TC makers");
+  app.add_option("-l,--loops", loops, "Times to play the file, shifted in time");
+  app.add_option("-b,--tp-batch-size", tp_side.tp_batch_size, "TPs per TA finding batch, as TPProcessor tp_batch_size");
+  app.add_option("--tp-broadcast-capacity",
+                 tp_side.tp_broadcast_capacity,
+                 "Broadcast ring running several TA algorithms on threads of their own; 0 runs them one after the other");
+  app.add_option("--ta-shards", tp_side.ta_shards, "Channel shards per TA algorithm");
+  app.add_option("--ta-shard-channel-block", tp_side.ta_shard_channel_block, "Consecutive channels per shard");
+  app.add_option("--ta-set-max-objects", ta_set_options.ta_set_max_objects, "TAs per TASet; 0 sends TAs one by one");
+  app.add_option("--ta-set-max-time-span", ta_set_options.ta_set_max_time_span, "Ticks spanned by the TAs of a TASet");
+  app.add_option("--ta-set-max-delay-us", ta_set_options.ta_set_max_delay_us, "Time a TASet may wait for more TAs");
+  app.add_option("--tp-filter-masked-channels", filter_config.masked_channels, "Channels rejected by the pre-filter");
+  app.add_option("--tp-filter-plane-period", filter_config.plane_period, "Channel period of the planes");
+  app.add_option("--tp-filter-plane-boundaries", filter_config.plane_boundaries, "First channels of the planes after the first");
+  app.add_option("--tp-filter-planes", filter_config.planes, "Planes kept by the pre-filter");
+  app.add_option("--tp-filter-min-time-over-threshold", filter_config.min_time_over_threshold, "Pre-filter cut");
+  app.add_option("--tp-filter-max-time-over-threshold", filter_config.max_time_over_threshold, "Pre-filter cut");
+  app.add_option("--tp-filter-min-adc-peak", filter_config.min_adc_peak, "Pre-filter cut");
+  app.add_option("--tp-filter-min-adc-integral", filter_config.min_adc_integral, "Pre-filter cut");
+  app.add_option("--tp-filter-batch-size", tp_side.tp_filter_batch_size, "TPs per pre-filter batch");
+  int64_t tp_batch_max_delay_us = tp_side.tp_batch_max_delay.count();
+  app.add_option("--tp-batch-max-delay-us", tp_batch_max_delay_us, "Time a partial TP batch may wait for more TPs");
+  app.add_option("--links", n_links, "Number of links read out by each TD");
+  app.add_option("--watermark-margin", watermark_margin, "Ticks the data time must be past a TD to close it");
+  app.add_option("--buffer-timeout", buffer_timeout, "TD buffer timeout in ms, only for the last TDs");
+
+  CLI11_PARSE(app, argc, argv);
+
+  uint64_t load_start = now_us(); // NOLINT(build/unsigned)
+  auto tps = read_tps(filename);
+  if (tps.empty()) {
+    TLOG() << "No TPs to run on";
+    return 1;
+  }
+  repeat_tps(tps, loops);
+  TLOG() << "Read " << tps.size() << " TPs (" << loops << " loops over " << filename << ") in "
+         << 1e-3 * (now_us() - load_start) << " ms";
+
+  // The TPs as they come out of the latency buffer of TPProcessor
+  std::vector<TPAdapter> tp_items(tps.size());
+  std::transform(tps.begin(), tps.end(), tp_items.begin(), [](const TP& tp) { return TPAdapter{ tp }; });
+
+  std::vector<StageResult> stages;
+
+  // TPProcessor: every TA algorithm over every TP that passes the pre-filter
+  tp_side.tp_batch_max_delay = std::chrono::microseconds(tp_batch_max_delay_us);
+  tp_side.wait_for_broadcast_ring = true;
+  TAFindingPipeline ta_finding;
+  ta_finding.configure(tp_side);
+  for (auto& algorithm : ta_algorithms) {
+    ta_finding.add_algorithm([algorithm, config = nlohmann::json::parse(ta_config)]() {
+      std::shared_ptr<triggeralgs::TriggerActivityMaker> maker = dunedaq::trigger::make_ta_maker(algorithm);
+      maker->configure(config);
+      return maker;
+    });
+  }
+  TASink ta_sink(ta_set_options);
+  std::vector<TPAdapter> queued_tps;
+  queued_tps.reserve(tp_items.size());
+  ta_finding.start([&ta_sink](TA&& ta) { ta_sink.send(std::move(ta)); },
+                   [&queued_tps](const TPAdapter* item) { queued_tps.push_back(*item); });
+
+  if (ta_finding.uses_broadcast_ring()) {
+    StageResult stage{ "TA " + std::to_string(ta_algorithms.size()) + " algorithms, broadcast", tp_items.size() };
+    uint64_t start = now_us(); // NOLINT(build/unsigned)
+    for (auto& item : tp_items) {
+      ta_finding.push(&item);
+    }
+    ta_finding.stop();
+    stage.time_us = now_us() - start;
+    stage.n_out = ta_sink.n_sent();
+    stages.push_back(stage);
+  } else {
+    StageResult filter_stage{ "TP filter", tp_items.size() };
+    uint64_t start = now_us(); // NOLINT(build/unsigned)
+    for (auto& item : tp_items) {
+      ta_finding.push(&item);
+    }
+    ta_finding.flush_filter_batch();
+    filter_stage.time_us = now_us() - start;
+    filter_stage.n_out = queued_tps.size();
+    if (ta_finding.filter().enabled()) {
+      stages.push_back(filter_stage);
+    }
+
+    for (size_t i = 0; i < ta_finding.tasks().size(); ++i) {
+      StageResult stage{ "TA " + ta_algorithms[i], queued_tps.size() };
+      size_t n_before = ta_sink.n_sent();
+      auto& task = ta_finding.tasks()[i];
+      start = now_us();
+      for (auto& item : queued_tps) {
+        task(&item);
+      }
+      ta_finding.finish(i);
+      stage.time_us = now_us() - start;
+      stage.n_out = ta_sink.n_sent() - n_before;
+      stages.push_back(stage);
+    }
+    ta_finding.stop();
+  }
+  std::vector<TA> tas = ta_sink.finish();
+  std::stable_sort(tas.begin(), tas.end(), [](const auto& a, const auto& b) { return a.time_start < b.time_start; });
+
+  // TAProcessor: every TC algorithm over every TA
+  std::vector<triggeralgs::TriggerCandidate> tcs;
+  for (auto& algorithm : tc_algorithms) {
+    std::shared_ptr<triggeralgs::TriggerCandidateMaker> maker = dunedaq::trigger::make_tc_maker(algorithm);
+    maker->configure(nlohmann::json::parse(tc_config));
+    StageResult stage{ "TC " + algorithm, tas.size() };
+    size_t n_before = tcs.size();
+    uint64_t start = now_us(); // NOLINT(build/unsigned)
+    for (auto& ta : tas) {
+      (*maker)(ta, tcs);
+    }
+    stage.time_us = now_us() - start;
+    stage.n_out = tcs.size() - n_before;
+    stages.push_back(stage);
+  }
+  std::stable_sort(tcs.begin(), tcs.end(), [](const auto& a, const auto& b) { return a.time_start < b.time_start; });
+
+  // TCProcessor: TD building, closed on data time rather than wall-clock time
+  TDBuilderConfig config;
+  config.close_on_watermark = true;
+  config.watermark_margin = watermark_margin;
+  config.buffer_timeout = buffer_timeout;
+  for (int i = 0; i < n_links; ++i) {
+    config.mandatory_links.push_back(
+      { dunedaq::dfmessages::SourceID::Subsystem::kDetectorReadout, static_cast<dunedaq::dfmessages::SourceID::ID_t>(i) });
+  }
+  TDBuilder builder;
+  builder.configure(config);
+  std::atomic<size_t> n_tds{ 0 };
+  builder.start([&n_tds](dunedaq::dfmessages::TriggerDecision&&, const PendingTD&) {
+    ++n_tds;
+    return dunedaq::trigger::SendOutcome::kSent;
+  });
+
+  StageResult td_stage{ "TD building", tcs.size() };
+  uint64_t td_start = now_us(); // NOLINT(build/unsigned)
+  for (auto& tc : tcs) {
+    builder.push(TCHandle(std::make_shared<const triggeralgs::TriggerCandidate>(std::move(tc))));
+  }
+  auto& counters = builder.counters();
+  uint64_t give_up = now_us() + 1000000 + buffer_timeout * 2000; // NOLINT(build/unsigned)
+  while (counters.tcs_added_count.load() < tcs.size() && now_us() < give_up) {
+    std::this_thread::yield();
+  }
+  // Every TC has been added: the TDs that are still open wait out the buffer timeout, which is not building
+  td_stage.time_us = now_us() - td_start;
+  uint64_t tail_start = now_us(); // NOLINT(build/unsigned)
+  auto tcs_accounted = [&] {
+    return counters.tds_created_tc_count.load() + counters.tds_failed_bitword_tc_count.load() +
+           counters.tc_pileup_dropped_count.load();
+  };
+  size_t tcs_open_at_last_tc = tcs.size() - tcs_accounted();
+  while (tcs_accounted() < tcs.size() && now_us() < give_up) {
+    std::this_thread::yield();
+  }
+  uint64_t tail_us = now_us() - tail_start; // NOLINT(build/unsigned)
+  builder.stop();
+  td_stage.n_out = n_tds.load();
+  stages.push_back(td_stage);
+
+  uint64_t total_us = 0; // NOLINT(build/unsigned)
+  TLOG() << "Stage \t\tin \tout \ttime [ms] \tin rate [/s]";
+  TLOG() << "------------------------------";
+  for (auto& stage : stages) {
+    print_stage(stage);
+    total_us += stage.time_us;
+  }
+  TLOG() << "------------------------------";
+  TLOG() << "TPs: " << tps.size() << ", TAs: " << tas.size() << ", TCs: " << tcs.size() << ", TDs: " << n_tds.load();
+  TLOG() << "Chain throughput [TP/s]: \t" << tps.size() / (1e-6 * std::max<uint64_t>(total_us, 1)); // NOLINT
+  TLOG() << "TDs closed on watermark: \t" << counters.tds_watermark_closed_count.load();
+  TLOG() << "TD timeout tail [ms]: \t" << 1e-3 * tail_us << " \t(" << tcs_open_at_last_tc
+         << " TCs in TDs still open after the last TC, not in the TD building time)";
+  if (ta_set_options.ta_set_max_objects > 0) {
+    TLOG() << "TASets: \t" << ta_sink.n_sets();
+  }
+  if (ta_finding.tp_broadcast_full_count() > 0) {
+    TLOG() << "Waits for a full broadcast ring: \t" << ta_finding.tp_broadcast_full_count();
+  }
+  return 0;
+}
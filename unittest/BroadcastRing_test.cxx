@@ -0,0 +1,157 @@
+/**
+ * @file BroadcastRing_test.cxx  BroadcastRing class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/BroadcastRing.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE BroadcastRing_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(EveryConsumerSeesEveryItem)
+{
+  trigger::BroadcastRing<int> ring(3, 2);
+  BOOST_CHECK_EQUAL(ring.capacity(), 4);
+  BOOST_CHECK_EQUAL(ring.consumers(), 2);
+
+  for (int i = 0; i < 4; ++i) {
+    BOOST_CHECK(ring.try_push(i));
+  }
+  BOOST_CHECK(!ring.try_push(4));
+
+  for (size_t consumer = 0; consumer < 2; ++consumer) {
+    std::vector<int> items;
+    BOOST_CHECK_EQUAL(ring.read(consumer, [&](const int& item) { items.push_back(item); }), 4);
+    std::vector<int> expected{ 0, 1, 2, 3 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(items.begin(), items.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(ring.read(consumer, [](const int&) {}), 0);
+  }
+  BOOST_CHECK_EQUAL(ring.occupancy(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SlowestConsumerHoldsSlots)
+{
+  trigger::BroadcastRing<int> ring(4, 2);
+  for (int i = 0; i < 4; ++i) {
+    BOOST_CHECK(ring.try_push(i));
+  }
+
+  // Consumer 0 has read everything, consumer 1 only the first two items
+  BOOST_CHECK_EQUAL(ring.read(0, [](const int&) {}), 4);
+  BOOST_CHECK_EQUAL(ring.read(1, [](const int&) {}, 2), 2);
+  BOOST_CHECK_EQUAL(ring.size(0), 0);
+  BOOST_CHECK_EQUAL(ring.size(1), 2);
+  BOOST_CHECK_EQUAL(ring.occupancy(), 2);
+
+  BOOST_CHECK(ring.try_push(4));
+  BOOST_CHECK(ring.try_push(5));
+  BOOST_CHECK(!ring.try_push(6));
+
+  std::vector<int> items;
+  ring.read(1, [&](const int& item) { items.push_back(item); });
+  std::vector<int> expected{ 2, 3, 4, 5 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(items.begin(), items.end(), expected.begin(), expected.end());
+  BOOST_CHECK(ring.try_push(6));
+}
+
+BOOST_AUTO_TEST_CASE(ReadsInPlace)
+{
+  trigger::BroadcastRing<std::vector<int>> ring(2, 3);
+  BOOST_REQUIRE(ring.try_push(std::vector<int>{ 1, 2, 3 }));
+  std::vector<const std::vector<int>*> seen;
+  for (size_t consumer = 0; consumer < 3; ++consumer) {
+    ring.read(consumer, [&](const std::vector<int>& item) { seen.push_back(&item); });
+  }
+  BOOST_REQUIRE_EQUAL(seen.size(), 3);
+  BOOST_CHECK(seen[0] == seen[1] && seen[1] == seen[2]);
+}
+
+BOOST_AUTO_TEST_CASE(ConsumerThreads)
+{
+  const int n_items = 500000;
+  const size_t n_consumers = 3;
+  trigger::BroadcastRing<int> ring(64, n_consumers);
+
+  std::vector<int> in_order(n_consumers, 1);
+  std::vector<std::thread> consumers;
+  for (size_t consumer = 0; consumer < n_consumers; ++consumer) {
+    consumers.emplace_back([&, consumer] {
+      int expected = 0;
+      bool ok = true;
+      while (expected < n_items) {
+        auto n_read = ring.read(consumer, [&](const int& item) { ok = ok && (item == expected++); });
+        if (n_read == 0) {
+          std::this_thread::yield();
+        }
+      }
+      in_order[consumer] = ok;
+    });
+  }
+
+  for (int i = 0; i < n_items; ++i) {
+    while (!ring.try_push(i)) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+  for (size_t consumer = 0; consumer < n_consumers; ++consumer) {
+    BOOST_CHECK(in_order[consumer]);
+  }
+  BOOST_CHECK_EQUAL(ring.occupancy(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReadWait)
+{
+  trigger::BroadcastRing<int> ring(16, 2);
+  auto no_op = [](const int&) {};
+  BOOST_CHECK_EQUAL(ring.read_wait(0, no_op, 16, std::chrono::milliseconds(1)), 0);
+
+  // A push wakes the consumer up well before its timeout
+  std::thread producer([&ring]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ring.try_push(7);
+  });
+  int item = 0;
+  auto start = std::chrono::steady_clock::now();
+  BOOST_REQUIRE_EQUAL(ring.read_wait(0, [&](const int& read) { item = read; }, 16, std::chrono::seconds(10)), 1);
+  BOOST_CHECK_EQUAL(item, 7);
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  producer.join();
+
+  // The other consumer has not read it yet, so does not wait
+  BOOST_CHECK_EQUAL(ring.read_wait(1, no_op, 16, std::chrono::seconds(10)), 1);
+
+  // wake() releases a consumer with nothing to read
+  std::thread waker([&ring]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ring.wake();
+  });
+  start = std::chrono::steady_clock::now();
+  BOOST_CHECK_EQUAL(ring.read_wait(0, no_op, 16, std::chrono::seconds(10)), 0);
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  waker.join();
+
+  // ...and the next wait of a consumer that was not waiting yet
+  start = std::chrono::steady_clock::now();
+  BOOST_CHECK_EQUAL(ring.read_wait(1, no_op, 16, std::chrono::seconds(10)), 0);
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
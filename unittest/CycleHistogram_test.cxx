@@ -0,0 +1,93 @@
+/**
+ * @file CycleHistogram_test.cxx  CycleHistogram class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/CycleHistogram.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE CycleHistogram_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <thread>
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(Buckets)
+{
+  trigger::CycleHistogram histogram(1);
+  histogram.record(0);
+  histogram.record(1);
+  histogram.record(3);
+  histogram.record(1024);
+  histogram.record(2047);
+  histogram.record(uint64_t(1) << 62); // NOLINT(build/unsigned)
+
+  auto snapshot = histogram.snapshot();
+  BOOST_CHECK_EQUAL(snapshot.sampled_count, 6);
+  BOOST_CHECK_EQUAL(snapshot.buckets[0], 2);
+  BOOST_CHECK_EQUAL(snapshot.buckets[1], 1);
+  BOOST_CHECK_EQUAL(snapshot.buckets[10], 2);
+  // Beyond the last bucket counts in the last bucket
+  BOOST_CHECK_EQUAL(snapshot.buckets[trigger::CycleHistogram::s_n_buckets - 1], 1);
+  BOOST_CHECK_EQUAL(snapshot.max_ticks, uint64_t(1) << 62); // NOLINT(build/unsigned)
+}
+
+BOOST_AUTO_TEST_CASE(SamplesOneInN)
+{
+  trigger::CycleHistogram histogram(10);
+  int n_calls = 0;
+  for (int i = 0; i < 95; ++i) {
+    histogram.time([&]() { ++n_calls; });
+  }
+  auto snapshot = histogram.snapshot();
+  BOOST_CHECK_EQUAL(n_calls, 95);
+  BOOST_CHECK_EQUAL(snapshot.call_count, 95);
+  BOOST_CHECK_EQUAL(snapshot.sampled_count, 9);
+
+  trigger::CycleHistogram off(0);
+  off.time([&]() { ++n_calls; });
+  BOOST_CHECK_EQUAL(n_calls, 96);
+  BOOST_CHECK_EQUAL(off.snapshot().call_count, 1);
+  BOOST_CHECK_EQUAL(off.snapshot().sampled_count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(TimesCalls)
+{
+  trigger::CycleHistogram histogram(1);
+  histogram.time([]() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+  auto snapshot = histogram.snapshot();
+  BOOST_REQUIRE_EQUAL(snapshot.sampled_count, 1);
+  double ticks_per_us = trigger::CycleHistogram::ticks_per_us();
+  BOOST_CHECK(ticks_per_us > 0.);
+  // At least the 2 ms slept, allowing for a rough tick rate
+  BOOST_CHECK(snapshot.total_ticks / ticks_per_us > 1500.);
+  BOOST_CHECK_EQUAL(snapshot.max_ticks, snapshot.total_ticks);
+}
+
+BOOST_AUTO_TEST_CASE(AddSnapshots)
+{
+  trigger::CycleHistogram first(1);
+  trigger::CycleHistogram second(1);
+  first.record(4);
+  second.record(5);
+  second.record(100);
+  auto total = first.snapshot();
+  total.add(second.snapshot());
+  BOOST_CHECK_EQUAL(total.sampled_count, 3);
+  BOOST_CHECK_EQUAL(total.total_ticks, 109);
+  BOOST_CHECK_EQUAL(total.max_ticks, 100);
+  BOOST_CHECK_EQUAL(total.buckets[2], 2);
+  BOOST_CHECK_EQUAL(total.buckets[6], 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+/**
+ * @file DecisionRequestBuilder_test.cxx  DecisionRequestBuilder class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/DecisionRequestBuilder.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE DecisionRequestBuilder_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <map>
+#include <vector>
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+namespace {
+
+dfmessages::SourceID
+make_link(uint32_t id) // NOLINT(build/unsigned)
+{
+  return dfmessages::SourceID{ daqdataformats::SourceID::Subsystem::kDetectorReadout, id };
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(MandatoryLinksAreDeduplicated)
+{
+  // Mandatory and enabled source IDs are concatenated in TCProcessor::conf
+  std::vector<dfmessages::SourceID> mandatory{ make_link(1), make_link(2), make_link(1), make_link(3), make_link(2) };
+  trigger::DecisionRequestBuilder builder;
+  builder.configure(mandatory, {});
+  BOOST_CHECK_EQUAL(builder.max_components(), 3);
+
+  dfmessages::TriggerDecision decision;
+  builder.add_readout_requests(decision, 100, 200);
+  BOOST_REQUIRE_EQUAL(decision.components.size(), 3);
+  for (uint32_t i = 0; i < 3; ++i) { // NOLINT(build/unsigned)
+    BOOST_CHECK_EQUAL(decision.components[i].component.id, i + 1);
+    BOOST_CHECK_EQUAL(decision.components[i].window_begin, 100);
+    BOOST_CHECK_EQUAL(decision.components[i].window_end, 200);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GroupLinks)
+{
+  std::vector<dfmessages::SourceID> mandatory{ make_link(1) };
+  std::map<int, std::vector<dfmessages::SourceID>> groups{ { 0, { make_link(1), make_link(10), make_link(11) } },
+                                                           { 1, { make_link(11), make_link(20) } } };
+  trigger::DecisionRequestBuilder builder;
+  builder.configure(mandatory, groups);
+
+  // Every link once
+  dfmessages::TriggerDecision all;
+  builder.add_readout_requests(all, 100, 200);
+  BOOST_CHECK_EQUAL(all.components.size(), 4);
+
+  // Groups never repeat a mandatory link, and windows are patched per call
+  dfmessages::TriggerDecision roi;
+  builder.add_mandatory_requests(roi, 100, 200);
+  builder.add_group_requests(roi, 0, 140, 160);
+  builder.add_group_requests(roi, 7, 140, 160);
+  BOOST_REQUIRE_EQUAL(roi.components.size(), 3);
+  BOOST_CHECK_EQUAL(roi.components[0].window_begin, 100);
+  BOOST_CHECK_EQUAL(roi.components[1].component.id, 10);
+  BOOST_CHECK_EQUAL(roi.components[1].window_begin, 140);
+  BOOST_CHECK_EQUAL(roi.components[2].window_end, 160);
+}
+
+BOOST_AUTO_TEST_CASE(Reconfigure)
+{
+  trigger::DecisionRequestBuilder builder;
+  builder.configure({ make_link(1), make_link(2) }, {});
+  builder.configure({ make_link(3) }, {});
+  BOOST_CHECK_EQUAL(builder.max_components(), 1);
+
+  dfmessages::TriggerDecision decision;
+  builder.add_readout_requests(decision, 0, 1);
+  BOOST_REQUIRE_EQUAL(decision.components.size(), 1);
+  BOOST_CHECK_EQUAL(decision.components[0].component.id, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,134 @@
+/**
+ * @file InProcessChannel_test.cxx  InProcessChannel class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/InProcessChannel.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE InProcessChannel_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(PushPopInOrder)
+{
+  trigger::InProcessChannel<std::unique_ptr<int>> channel(3);
+  BOOST_CHECK_EQUAL(channel.capacity(), 4);
+  for (int i = 0; i < 4; ++i) {
+    BOOST_CHECK(channel.try_push(std::make_unique<int>(i)));
+  }
+  // Full: the object is left with the caller
+  auto extra = std::make_unique<int>(4);
+  BOOST_CHECK(!channel.try_push(std::move(extra)));
+  BOOST_REQUIRE(extra);
+
+  std::unique_ptr<int> object;
+  for (int i = 0; i < 4; ++i) {
+    BOOST_REQUIRE(channel.try_pop(object));
+    BOOST_CHECK_EQUAL(*object, i);
+  }
+  BOOST_CHECK(!channel.try_pop(object));
+  BOOST_CHECK(channel.try_push(std::move(extra)));
+  BOOST_REQUIRE(channel.try_pop(object));
+  BOOST_CHECK_EQUAL(*object, 4);
+}
+
+BOOST_AUTO_TEST_CASE(ManyProducers)
+{
+  const int n_producers = 4;
+  const int n_per_producer = 20000;
+  trigger::InProcessChannel<std::vector<int>> channel(64);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < n_producers; ++p) {
+    producers.emplace_back([&channel, p]() {
+      for (int i = 0; i < n_per_producer; ++i) {
+        std::vector<int> object{ p, i };
+        while (!channel.try_push(std::move(object))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Each producer's objects arrive in the order it pushed them
+  std::vector<int> next(n_producers, 0);
+  int n_received = 0;
+  std::vector<int> object;
+  while (n_received < n_producers * n_per_producer) {
+    if (!channel.try_pop(object)) {
+      std::this_thread::yield();
+      continue;
+    }
+    BOOST_REQUIRE_EQUAL(object.size(), 2);
+    BOOST_REQUIRE_EQUAL(object[1], next[object[0]]);
+    ++next[object[0]];
+    ++n_received;
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  BOOST_CHECK(!channel.try_pop(object));
+}
+
+BOOST_AUTO_TEST_CASE(PopWaitWakesUp)
+{
+  trigger::InProcessChannel<int> channel(16);
+  int object = 0;
+  BOOST_CHECK(!channel.pop_wait(object, std::chrono::milliseconds(1)));
+
+  // A push wakes the consumer up well before its timeout
+  std::thread producer([&channel]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    channel.try_push(7);
+  });
+  auto start = std::chrono::steady_clock::now();
+  BOOST_REQUIRE(channel.pop_wait(object, std::chrono::seconds(10)));
+  BOOST_CHECK_EQUAL(object, 7);
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  producer.join();
+
+  // So does wake(), with nothing to pop
+  std::thread waker([&channel]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    channel.wake();
+  });
+  start = std::chrono::steady_clock::now();
+  BOOST_CHECK(!channel.pop_wait(object, std::chrono::seconds(10)));
+  BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  waker.join();
+
+  for (int i = 0; i < 5; ++i) {
+    channel.try_push(std::move(i));
+  }
+  BOOST_CHECK_EQUAL(channel.clear(), 5);
+  BOOST_CHECK(!channel.try_pop(object));
+}
+
+BOOST_AUTO_TEST_CASE(Registry)
+{
+  BOOST_CHECK(!trigger::InProcessChannelRegistry::find<int>("ta_connection"));
+  auto channel = trigger::InProcessChannelRegistry::open<int>("ta_connection", 16);
+  BOOST_REQUIRE(channel);
+  BOOST_CHECK_EQUAL(trigger::InProcessChannelRegistry::find<int>("ta_connection"), channel);
+  BOOST_CHECK_EQUAL(trigger::InProcessChannelRegistry::open<int>("ta_connection", 16), channel);
+  // Not for another type
+  BOOST_CHECK(!trigger::InProcessChannelRegistry::find<double>("ta_connection"));
+  BOOST_CHECK(!trigger::InProcessChannelRegistry::open<double>("ta_connection", 16));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+/**
+ * @file LazyOverlay_test.cxx  LazyOverlay class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/LazyOverlay.hpp"
+#include "trigger/TAWrapper.hpp"
+#include "trigger/TCWrapper.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE LazyOverlay_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+
+namespace {
+
+triggeralgs::TriggerActivity
+make_ta(size_t n_inputs)
+{
+  triggeralgs::TriggerActivity ta;
+  ta.time_start = 1000;
+  ta.channel_start = 12;
+  for (size_t i = 0; i < n_inputs; ++i) {
+    triggeralgs::TriggerPrimitive tp;
+    tp.time_start = 1000 + i;
+    tp.channel = 12 + i;
+    ta.inputs.push_back(tp);
+  }
+  return ta;
+}
+
+std::vector<uint8_t> // NOLINT(build/unsigned)
+eager_overlay(const triggeralgs::TriggerActivity& ta)
+{
+  std::vector<uint8_t> buffer(triggeralgs::get_overlay_nbytes(ta)); // NOLINT(build/unsigned)
+  triggeralgs::write_overlay(ta, buffer.data());
+  return buffer;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(WrittenOnFirstAccess)
+{
+  auto ta = make_ta(5);
+  trigger::TAWrapper wrapper(ta);
+  BOOST_CHECK(!wrapper.activity_overlay.written());
+  BOOST_CHECK_EQUAL(wrapper.get_payload_size(), triggeralgs::get_overlay_nbytes(ta));
+  BOOST_CHECK(!wrapper.activity_overlay.written());
+
+  auto expected = eager_overlay(ta);
+  auto begin = reinterpret_cast<uint8_t*>(wrapper.begin()); // NOLINT(build/unsigned)
+  auto end = reinterpret_cast<uint8_t*>(wrapper.end());     // NOLINT(build/unsigned)
+  BOOST_CHECK(wrapper.activity_overlay.written());
+  BOOST_CHECK_EQUAL_COLLECTIONS(begin, end, expected.begin(), expected.end());
+
+  trigger::TCWrapper tc_wrapper{ triggeralgs::TriggerCandidate() };
+  BOOST_CHECK(!tc_wrapper.candidate_overlay.written());
+  BOOST_CHECK_EQUAL(tc_wrapper.populate_buffer().size(), triggeralgs::get_overlay_nbytes(tc_wrapper.candidate));
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentAccess)
+{
+  auto ta = make_ta(200);
+  auto expected = eager_overlay(ta);
+  for (int round = 0; round < 50; ++round) {
+    trigger::TAWrapper wrapper(ta);
+    std::vector<uint8_t*> data(4, nullptr); // NOLINT(build/unsigned)
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < data.size(); ++i) {
+      threads.emplace_back([&wrapper, &data, i]() { data[i] = wrapper.populate_buffer().data(); });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    // All threads saw the one buffer, completely written
+    for (auto* d : data) {
+      BOOST_REQUIRE_EQUAL(d, data[0]);
+    }
+    BOOST_REQUIRE(std::equal(expected.begin(), expected.end(), data[0]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CopiesAndTimestamp)
+{
+  auto ta = make_ta(3);
+  trigger::TAWrapper unwritten(ta);
+  trigger::TAWrapper copy = unwritten;
+  BOOST_CHECK(!copy.activity_overlay.written());
+
+  trigger::TAWrapper written(ta);
+  written.populate_buffer();
+  trigger::TAWrapper written_copy = written;
+  BOOST_CHECK(written_copy.activity_overlay.written());
+  BOOST_CHECK(written_copy.populate_buffer() == written.populate_buffer());
+  trigger::TAWrapper moved = std::move(written_copy);
+  BOOST_CHECK(moved.activity_overlay.written());
+
+  // A new timestamp makes a new overlay
+  moved.set_timestamp(5000);
+  BOOST_CHECK(!moved.activity_overlay.written());
+  BOOST_CHECK(moved.populate_buffer() == eager_overlay(moved.activity));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,168 @@
+/**
+ * @file PackedTPSet_test.cxx  PackedTPSet encoding Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/Issues.hpp"
+#include "trigger/PackedTPSet.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE PackedTPSet_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <random>
+
+using namespace dunedaq;
+
+namespace {
+
+trigger::TPSet
+make_tpset(size_t n_tps)
+{
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> uniform(0, 1000);
+
+  trigger::TPSet tpset;
+  tpset.seqno = 123456789;
+  tpset.run_number = 42;
+  tpset.origin = daqdataformats::SourceID(daqdataformats::SourceID::Subsystem::kTrigger, 7);
+  tpset.type = trigger::TPSet::Type::kPayload;
+  tpset.start_time = 106000000000000000;
+  tpset.end_time = tpset.start_time + 62500;
+  for (size_t i = 0; i < n_tps; ++i) {
+    trgdataformats::TriggerPrimitive tp;
+    tp.time_start = tpset.start_time + 10 * i;
+    tp.time_peak = tp.time_start + uniform(generator);
+    tp.time_over_threshold = uniform(generator);
+    tp.channel = uniform(generator);
+    tp.adc_integral = 100 * uniform(generator);
+    tp.adc_peak = uniform(generator);
+    tp.detid = 3;
+    tp.type = trgdataformats::TriggerPrimitive::Type::kTPC;
+    tp.algorithm = trgdataformats::TriggerPrimitive::Algorithm::kSimpleThreshold;
+    tp.flag = 1;
+    tpset.objects.push_back(tp);
+  }
+  return tpset;
+}
+
+void
+check_same(const trigger::TPSet& a, const trigger::TPSet& b)
+{
+  BOOST_CHECK_EQUAL(a.seqno, b.seqno);
+  BOOST_CHECK_EQUAL(a.run_number, b.run_number);
+  BOOST_CHECK(a.origin == b.origin);
+  BOOST_CHECK(a.type == b.type);
+  BOOST_CHECK_EQUAL(a.start_time, b.start_time);
+  BOOST_CHECK_EQUAL(a.end_time, b.end_time);
+  BOOST_REQUIRE_EQUAL(a.objects.size(), b.objects.size());
+  for (size_t i = 0; i < a.objects.size(); ++i) {
+    auto& x = a.objects[i];
+    auto& y = b.objects[i];
+    BOOST_CHECK_EQUAL(x.time_start, y.time_start);
+    BOOST_CHECK_EQUAL(x.time_peak, y.time_peak);
+    BOOST_CHECK_EQUAL(x.time_over_threshold, y.time_over_threshold);
+    BOOST_CHECK_EQUAL(x.channel, y.channel);
+    BOOST_CHECK_EQUAL(x.adc_integral, y.adc_integral);
+    BOOST_CHECK_EQUAL(x.adc_peak, y.adc_peak);
+    BOOST_CHECK_EQUAL(x.detid, y.detid);
+    BOOST_CHECK(x.type == y.type);
+    BOOST_CHECK(x.algorithm == y.algorithm);
+    BOOST_CHECK_EQUAL(x.version, y.version);
+    BOOST_CHECK_EQUAL(x.flag, y.flag);
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(Heartbeat)
+{
+  auto tpset = make_tpset(0);
+  tpset.type = trigger::TPSet::Type::kHeartbeat;
+  trigger::PackedTPSet packed;
+  trigger::pack(tpset, packed);
+  trigger::TPSet unpacked;
+  trigger::unpack(packed, unpacked);
+  check_same(tpset, unpacked);
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+  auto tpset = make_tpset(1000);
+  trigger::PackedTPSet packed;
+  trigger::pack(tpset, packed);
+  trigger::TPSet unpacked;
+  trigger::unpack(packed, unpacked);
+  check_same(tpset, unpacked);
+  // Constant fields are written once, so a TP is much smaller than in memory
+  BOOST_CHECK_LT(packed.bytes.size(), 1000 * 16);
+}
+
+BOOST_AUTO_TEST_CASE(VaryingSetLevelFields)
+{
+  auto tpset = make_tpset(10);
+  tpset.objects[3].detid = 4;
+  tpset.objects[5].flag = 0;
+  // Out of time order and before the set start
+  tpset.objects[7].time_start = tpset.start_time - 5;
+  tpset.objects[8].time_peak = tpset.objects[8].time_start - 1;
+  trigger::PackedTPSet packed;
+  trigger::pack(tpset, packed);
+  trigger::TPSet unpacked;
+  trigger::unpack(packed, unpacked);
+  check_same(tpset, unpacked);
+}
+
+BOOST_AUTO_TEST_CASE(ReusesMemory)
+{
+  auto tpset = make_tpset(100);
+  trigger::PackedTPSet packed;
+  trigger::pack(tpset, packed);
+  trigger::TPSet unpacked;
+  trigger::unpack(packed, unpacked);
+
+  auto bytes = packed.bytes.data();
+  auto objects = unpacked.objects.data();
+  trigger::pack(tpset, packed);
+  trigger::unpack(packed, unpacked);
+  BOOST_CHECK(packed.bytes.data() == bytes);
+  BOOST_CHECK(unpacked.objects.data() == objects);
+}
+
+BOOST_AUTO_TEST_CASE(Corrupt)
+{
+  auto tpset = make_tpset(10);
+  trigger::PackedTPSet packed;
+  trigger::pack(tpset, packed);
+  trigger::TPSet unpacked;
+
+  auto truncated = packed;
+  truncated.bytes.resize(packed.bytes.size() - 1);
+  BOOST_CHECK_THROW(trigger::unpack(truncated, unpacked), trigger::BadPackedTPSet);
+
+  auto bad_version = packed;
+  bad_version.bytes[0] = 0xff;
+  BOOST_CHECK_THROW(trigger::unpack(bad_version, unpacked), trigger::BadPackedTPSet);
+
+  trigger::PackedTPSet empty;
+  BOOST_CHECK_THROW(trigger::unpack(empty, unpacked), trigger::BadPackedTPSet);
+
+  auto trailing = packed;
+  trailing.bytes.push_back(0);
+  BOOST_CHECK_THROW(trigger::unpack(trailing, unpacked), trigger::BadPackedTPSet);
+
+  trigger::TPSet heartbeat;
+  trigger::pack(heartbeat, packed);
+  packed.bytes.push_back(0);
+  BOOST_CHECK_THROW(trigger::unpack(packed, unpacked), trigger::BadPackedTPSet);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,155 @@
+/**
+ * @file PendingTDIndex_test.cxx  PendingTDIndex class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/PendingTDIndex.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE PendingTDIndex_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+namespace {
+
+trigger::PendingTD
+make_pending_td(triggeralgs::timestamp_t start, triggeralgs::timestamp_t end, int64_t expiration = 0)
+{
+  trigger::PendingTD td;
+  auto tc = std::make_shared<triggeralgs::TriggerCandidate>();
+  tc->time_start = start;
+  tc->time_end = end;
+  tc->time_candidate = start;
+  td.contributing_tcs.emplace_back(std::move(tc));
+  td.readout_start = start;
+  td.readout_end = end;
+  td.walltime_expiration = expiration;
+  return td;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(FindOverlap)
+{
+  trigger::PendingTDIndex index;
+  BOOST_CHECK(index.find_overlap(0, 100) == index.end());
+
+  index.insert(make_pending_td(100, 200));
+  index.insert(make_pending_td(300, 400));
+  index.insert(make_pending_td(500, 600));
+  BOOST_CHECK_EQUAL(index.size(), 3);
+
+  // Windows are inclusive on both ends
+  BOOST_CHECK(index.find_overlap(0, 99) == index.end());
+  BOOST_CHECK_EQUAL(index.find_overlap(0, 100)->second.readout_start, 100);
+  BOOST_CHECK_EQUAL(index.find_overlap(200, 250)->second.readout_start, 100);
+  BOOST_CHECK(index.find_overlap(201, 299) == index.end());
+  BOOST_CHECK_EQUAL(index.find_overlap(350, 360)->second.readout_start, 300);
+  BOOST_CHECK_EQUAL(index.find_overlap(250, 1000)->second.readout_start, 500);
+  BOOST_CHECK(index.find_overlap(601, 1000) == index.end());
+}
+
+BOOST_AUTO_TEST_CASE(ExtendAndCoalesce)
+{
+  trigger::PendingTDIndex index;
+  index.insert(make_pending_td(100, 200, 10));
+  index.insert(make_pending_td(300, 400, 20));
+  index.insert(make_pending_td(500, 600, 30));
+
+  // Grow the first TD without touching its neighbours
+  auto it = index.extend(index.find_overlap(150, 150), 50, 250);
+  BOOST_CHECK_EQUAL(index.size(), 3);
+  BOOST_CHECK_EQUAL(it->first, 50);
+  BOOST_CHECK_EQUAL(it->second.readout_end, 250);
+
+  // Grow the middle TD over both neighbours: everything coalesces into one
+  it = index.extend(index.find_overlap(350, 350), 240, 550);
+  BOOST_REQUIRE_EQUAL(index.size(), 1);
+  BOOST_CHECK_EQUAL(it->second.readout_start, 50);
+  BOOST_CHECK_EQUAL(it->second.readout_end, 600);
+  BOOST_CHECK_EQUAL(it->second.walltime_expiration, 30);
+  BOOST_CHECK_EQUAL(it->second.contributing_tcs.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(Erase)
+{
+  trigger::PendingTDIndex index;
+  for (triggeralgs::timestamp_t i = 0; i < 10; ++i) {
+    index.insert(make_pending_td(i * 100, i * 100 + 50));
+  }
+  for (auto it = index.begin(); it != index.end();) {
+    it = (it->first % 200 == 0) ? index.erase(it) : std::next(it);
+  }
+  BOOST_CHECK_EQUAL(index.size(), 5);
+  BOOST_CHECK(index.find_overlap(200, 250) == index.end());
+  BOOST_CHECK_EQUAL(index.find_overlap(300, 350)->second.readout_start, 300);
+
+  index.clear();
+  BOOST_CHECK(index.empty());
+}
+
+BOOST_AUTO_TEST_CASE(Deadlines)
+{
+  trigger::PendingTDIndex index;
+  BOOST_CHECK(!index.next_deadline().has_value());
+
+  index.insert(make_pending_td(100, 200, 30));
+  index.insert(make_pending_td(300, 400, 10));
+  index.insert(make_pending_td(500, 600, 20));
+  BOOST_CHECK_EQUAL(*index.next_deadline(), 10);
+
+  // Merging pushes the deadline of the TD back; the old deadline is stale
+  auto it = index.find_overlap(350, 350);
+  it->second.walltime_expiration = 40;
+  index.extend(it, 350, 350);
+  BOOST_CHECK_EQUAL(*index.next_deadline(), 20);
+
+  // Bringing a deadline forward takes effect straight away
+  index.reschedule(index.find_overlap(150, 150), 5);
+  BOOST_CHECK_EQUAL(*index.next_deadline(), 5);
+
+  auto expired = index.extract_expired(20);
+  BOOST_REQUIRE_EQUAL(expired.size(), 2);
+  BOOST_CHECK_EQUAL(expired[0].readout_start, 100);
+  BOOST_CHECK_EQUAL(expired[1].readout_start, 500);
+  BOOST_CHECK_EQUAL(index.size(), 1);
+  BOOST_CHECK_EQUAL(*index.next_deadline(), 40);
+
+  BOOST_CHECK(index.extract_expired(39).empty());
+  BOOST_CHECK_EQUAL(index.extract_expired(40).size(), 1);
+  BOOST_CHECK(!index.next_deadline().has_value());
+}
+
+BOOST_AUTO_TEST_CASE(ExtractClosed)
+{
+  trigger::PendingTDIndex index;
+  index.insert(make_pending_td(100, 200, 10));
+  index.insert(make_pending_td(300, 400, 20));
+  index.insert(make_pending_td(500, 600, 30));
+
+  BOOST_CHECK(index.extract_closed(199).empty());
+
+  auto closed = index.extract_closed(450);
+  BOOST_REQUIRE_EQUAL(closed.size(), 2);
+  BOOST_CHECK_EQUAL(closed[0].readout_start, 100);
+  BOOST_CHECK_EQUAL(closed[1].readout_start, 300);
+  BOOST_CHECK_EQUAL(index.size(), 1);
+
+  // Deadlines of TDs closed on the watermark are no longer reported
+  BOOST_CHECK_EQUAL(*index.next_deadline(), 30);
+  BOOST_CHECK(index.extract_expired(29).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
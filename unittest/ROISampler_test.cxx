@@ -0,0 +1,85 @@
+/**
+ * @file ROISampler_test.cxx  AliasTable and ROISampler class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/ROISampler.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE ROISampler_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(AliasTableFrequencies)
+{
+  std::vector<double> weights{ 0.1, 0.0, 0.6, 0.3 };
+  trigger::AliasTable table(weights);
+  BOOST_CHECK_EQUAL(table.size(), 4);
+
+  std::mt19937_64 rng(42);
+  const int n_samples = 200000;
+  std::vector<int> counts(weights.size(), 0);
+  for (int i = 0; i < n_samples; ++i) {
+    counts.at(table.sample(rng))++;
+  }
+  BOOST_CHECK_EQUAL(counts[1], 0);
+  for (size_t i = 0; i < weights.size(); ++i) {
+    BOOST_CHECK_SMALL(static_cast<double>(counts[i]) / n_samples - weights[i], 0.01);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(AliasTableEmpty)
+{
+  std::mt19937_64 rng(42);
+  BOOST_CHECK_EQUAL(trigger::AliasTable().sample(rng), -1);
+  BOOST_CHECK_EQUAL(trigger::AliasTable({ 0.0, 0.0 }).sample(rng), -1);
+}
+
+BOOST_AUTO_TEST_CASE(PickGroups)
+{
+  trigger::ROISampler sampler;
+  sampler.configure({ 1.0 }, 10, 1234);
+  BOOST_CHECK_EQUAL(sampler.pick_config(), 0);
+
+  for (int n : { 0, 1, 5, 9, 10 }) {
+    auto groups = sampler.pick_groups(n);
+    BOOST_CHECK_EQUAL(groups.size(), n);
+    std::set<int> unique(groups.begin(), groups.end());
+    BOOST_CHECK_EQUAL(unique.size(), groups.size());
+    for (auto group : groups) {
+      BOOST_CHECK(group >= 0 && group < 10);
+    }
+  }
+
+  // Asking for more groups than there are returns all of them
+  BOOST_CHECK_EQUAL(sampler.pick_groups(25).size(), 10);
+}
+
+BOOST_AUTO_TEST_CASE(SeededStreamsRepeat)
+{
+  trigger::ROISampler a;
+  trigger::ROISampler b;
+  a.configure({ 0.2, 0.8 }, 50, 99);
+  b.configure({ 0.2, 0.8 }, 50, 99);
+  for (int i = 0; i < 100; ++i) {
+    BOOST_CHECK_EQUAL(a.pick_config(), b.pick_config());
+    auto groups_a = a.pick_groups(7);
+    auto groups_b = b.pick_groups(7);
+    BOOST_CHECK(groups_a == groups_b);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+/**
+ * @file SPSCRing_test.cxx  SPSCRing class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/SPSCRing.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE SPSCRing_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(PushPop)
+{
+  trigger::SPSCRing<int> ring(3);
+  BOOST_CHECK_EQUAL(ring.capacity(), 4);
+  BOOST_CHECK(ring.empty());
+
+  for (int i = 0; i < 4; ++i) {
+    int item = i;
+    BOOST_CHECK(ring.try_push(std::move(item)));
+  }
+  int extra = 4;
+  BOOST_CHECK(!ring.try_push(std::move(extra)));
+  BOOST_CHECK_EQUAL(extra, 4);
+  BOOST_CHECK_EQUAL(ring.size(), 4);
+
+  int item = -1;
+  for (int i = 0; i < 4; ++i) {
+    BOOST_REQUIRE(ring.try_pop(item));
+    BOOST_CHECK_EQUAL(item, i);
+  }
+  BOOST_CHECK(!ring.try_pop(item));
+  BOOST_CHECK(ring.empty());
+}
+
+BOOST_AUTO_TEST_CASE(MovesItems)
+{
+  trigger::SPSCRing<std::vector<int>> ring(2);
+  std::vector<int> in{ 1, 2, 3 };
+  BOOST_REQUIRE(ring.try_push(std::move(in)));
+  std::vector<int> out;
+  BOOST_REQUIRE(ring.try_pop(out));
+  BOOST_CHECK_EQUAL(out.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(TwoThreads)
+{
+  const int n_items = 1000000;
+  trigger::SPSCRing<int> ring(64);
+
+  std::thread producer([&] {
+    for (int i = 0; i < n_items; ++i) {
+      int item = i;
+      while (!ring.try_push(std::move(item))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  bool in_order = true;
+  while (expected < n_items) {
+    int item;
+    if (ring.try_pop(item)) {
+      in_order = in_order && (item == expected);
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  BOOST_CHECK(in_order);
+  BOOST_CHECK(ring.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+/**
+ * @file SetBatcher_test.cxx  SetBatcher class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/SetBatcher.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE SetBatcher_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+
+namespace {
+
+using IntSet = trigger::Set<int>;
+
+// Collects the Sets sent by a batcher
+struct SetCollector
+{
+  std::mutex mutex;
+  std::vector<IntSet> sets;
+
+  trigger::SetBatcher<int>::send_function_t sender()
+  {
+    return [this](IntSet&& set) {
+      std::lock_guard<std::mutex> lock(mutex);
+      sets.push_back(std::move(set));
+    };
+  }
+
+  size_t size()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sets.size();
+  }
+};
+
+const daqdataformats::SourceID s_origin(daqdataformats::SourceID::Subsystem::kTrigger, 7);
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(FlushOnCount)
+{
+  SetCollector collector;
+  trigger::SetBatcher<int> batcher(3, 1000000, std::chrono::seconds(10));
+  batcher.start(collector.sender(), s_origin, "set-test");
+  for (int i = 0; i < 7; ++i) {
+    batcher.add(int(i), 100 + i);
+  }
+  BOOST_CHECK_EQUAL(collector.size(), 2);
+  batcher.stop();
+
+  BOOST_REQUIRE_EQUAL(collector.sets.size(), 3);
+  std::vector<int> expected_first{ 0, 1, 2 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(collector.sets[0].objects.begin(),
+                                collector.sets[0].objects.end(),
+                                expected_first.begin(),
+                                expected_first.end());
+  BOOST_CHECK_EQUAL(collector.sets[0].start_time, 100);
+  BOOST_CHECK_EQUAL(collector.sets[0].end_time, 102);
+  BOOST_CHECK_EQUAL(collector.sets[2].objects.size(), 1);
+  for (size_t i = 0; i < collector.sets.size(); ++i) {
+    BOOST_CHECK_EQUAL(collector.sets[i].seqno, i);
+    BOOST_CHECK(collector.sets[i].type == IntSet::kPayload);
+    BOOST_CHECK(collector.sets[i].origin == s_origin);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FlushOnTimeSpan)
+{
+  SetCollector collector;
+  trigger::SetBatcher<int> batcher(100, 50, std::chrono::seconds(10));
+  batcher.start(collector.sender(), s_origin, "set-test");
+  batcher.add(0, 1000);
+  batcher.add(1, 1050);
+  BOOST_CHECK_EQUAL(collector.size(), 0);
+  // Would stretch the Set over 51 ticks: the first two go on their own
+  batcher.add(2, 1051);
+  BOOST_CHECK_EQUAL(collector.size(), 1);
+  batcher.stop();
+
+  BOOST_REQUIRE_EQUAL(collector.sets.size(), 2);
+  BOOST_CHECK_EQUAL(collector.sets[0].objects.size(), 2);
+  BOOST_CHECK_EQUAL(collector.sets[0].end_time, 1050);
+  BOOST_CHECK_EQUAL(collector.sets[1].start_time, 1051);
+}
+
+BOOST_AUTO_TEST_CASE(FlushOnDeadline)
+{
+  SetCollector collector;
+  trigger::SetBatcher<int> batcher(100, 1000000, std::chrono::milliseconds(5));
+  batcher.start(collector.sender(), s_origin, "set-test");
+  batcher.add(0, 10);
+  batcher.add(1, 11);
+
+  auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (collector.size() == 0 && std::chrono::steady_clock::now() < give_up) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_CHECK_EQUAL(collector.size(), 1);
+  batcher.stop();
+  BOOST_CHECK_EQUAL(collector.sets.size(), 1);
+  BOOST_CHECK_EQUAL(collector.sets[0].objects.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentProducers)
+{
+  SetCollector collector;
+  trigger::SetBatcher<int> batcher(16, 1000000, std::chrono::milliseconds(1));
+  batcher.start(collector.sender(), s_origin, "set-test");
+
+  const int n_per_thread = 10000;
+  std::vector<std::thread> producers;
+  for (int t = 0; t < 4; ++t) {
+    producers.emplace_back([&batcher, t] {
+      for (int i = 0; i < n_per_thread; ++i) {
+        batcher.add(int(t * n_per_thread + i), i);
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  batcher.stop();
+
+  size_t n_objects = 0;
+  for (size_t i = 0; i < collector.sets.size(); ++i) {
+    BOOST_CHECK_EQUAL(collector.sets[i].seqno, i);
+    n_objects += collector.sets[i].objects.size();
+  }
+  BOOST_CHECK_EQUAL(n_objects, 4 * n_per_thread);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
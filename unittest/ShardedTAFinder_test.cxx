@@ -0,0 +1,183 @@
+/**
+ * @file ShardedTAFinder_test.cxx  ShardedTAFinder class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/ShardedTAFinder.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE ShardedTAFinder_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+
+namespace {
+
+// A finder that closes a TA every n_tps TPs it sees, at the time of the closing TP
+trigger::ShardedTAFinder::finder_factory_t
+every_nth_tp(int n_tps, std::vector<uint32_t>* channels_seen = nullptr) // NOLINT(build/unsigned)
+{
+  return [=]() {
+    auto count = std::make_shared<int>(0);
+    return [=](const triggeralgs::TriggerPrimitive& tp, std::vector<triggeralgs::TriggerActivity>& tas) {
+      if (channels_seen != nullptr) {
+        channels_seen->push_back(tp.channel);
+      }
+      if (++*count % n_tps == 0) {
+        triggeralgs::TriggerActivity ta;
+        ta.time_start = tp.time_start;
+        ta.channel_start = tp.channel;
+        tas.push_back(ta);
+      }
+    };
+  };
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(ShardByChannelBlock)
+{
+  trigger::ShardedTAFinder finder(every_nth_tp(1), 3, 100);
+  BOOST_CHECK_EQUAL(finder.n_shards(), 3);
+  BOOST_CHECK_EQUAL(finder.shard_of(0), 0);
+  BOOST_CHECK_EQUAL(finder.shard_of(99), 0);
+  BOOST_CHECK_EQUAL(finder.shard_of(100), 1);
+  BOOST_CHECK_EQUAL(finder.shard_of(250), 2);
+  BOOST_CHECK_EQUAL(finder.shard_of(300), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SingleShard)
+{
+  std::vector<uint32_t> channels_seen; // NOLINT(build/unsigned)
+  std::vector<triggeralgs::TriggerActivity> out;
+  trigger::ShardedTAFinder single(every_nth_tp(1, &channels_seen), 1, 10);
+  single.start([&](triggeralgs::TriggerActivity&& ta) { out.push_back(std::move(ta)); }, "ta-test");
+  for (uint32_t channel = 0; channel < 50; ++channel) { // NOLINT(build/unsigned)
+    triggeralgs::TriggerPrimitive tp;
+    tp.channel = channel;
+    tp.time_start = channel;
+    single.push(tp);
+  }
+  single.stop();
+  BOOST_CHECK_EQUAL(channels_seen.size(), 50);
+  BOOST_CHECK_EQUAL(out.size(), 50);
+}
+
+BOOST_AUTO_TEST_CASE(MergedInTimeOrder)
+{
+  const int n_tps = 200000;
+  const size_t n_shards = 4;
+  const uint32_t channel_block = 64; // NOLINT(build/unsigned)
+  trigger::ShardedTAFinder finder(every_nth_tp(3), n_shards, channel_block);
+
+  std::vector<triggeralgs::TriggerActivity> out;
+  finder.start([&](triggeralgs::TriggerActivity&& ta) { out.push_back(std::move(ta)); }, "ta-test");
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint32_t> channel(0, 1023); // NOLINT(build/unsigned)
+  std::vector<int> tps_per_shard(n_shards, 0);
+  for (int i = 0; i < n_tps; ++i) {
+    triggeralgs::TriggerPrimitive tp;
+    tp.channel = channel(generator);
+    tp.time_start = 10 * (i / 4); // Some TPs share a start time
+    ++tps_per_shard[finder.shard_of(tp.channel)];
+    finder.push(tp);
+  }
+  finder.stop();
+
+  size_t expected = 0;
+  for (auto n : tps_per_shard) {
+    expected += n / 3;
+  }
+  BOOST_CHECK_EQUAL(out.size(), expected);
+
+  bool in_order = true;
+  for (size_t i = 1; i < out.size(); ++i) {
+    in_order = in_order && (out[i - 1].time_start <= out[i].time_start);
+  }
+  BOOST_CHECK(in_order);
+}
+
+BOOST_AUTO_TEST_CASE(MergedInPushOrder)
+{
+  // TP times out of order, as from several links: the TAs still come out in
+  // the order of the TPs that closed them, as from a single finder
+  const int n_tps = 200000;
+  const size_t n_shards = 4;
+  const uint32_t channel_block = 64; // NOLINT(build/unsigned)
+  trigger::ShardedTAFinder finder(every_nth_tp(3), n_shards, channel_block);
+
+  std::vector<triggeralgs::TriggerActivity> out;
+  finder.start([&](triggeralgs::TriggerActivity&& ta) { out.push_back(std::move(ta)); }, "ta-test");
+
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint32_t> channel(0, 1023); // NOLINT(build/unsigned)
+  std::uniform_int_distribution<int> jitter(0, 999);
+  std::vector<int> tps_per_shard(n_shards, 0);
+  std::vector<triggeralgs::timestamp_t> expected;
+  for (int i = 0; i < n_tps; ++i) {
+    triggeralgs::TriggerPrimitive tp;
+    tp.channel = channel(generator);
+    tp.time_start = 1000 * (i / 100) + jitter(generator);
+    if (++tps_per_shard[finder.shard_of(tp.channel)] % 3 == 0) {
+      expected.push_back(tp.time_start);
+    }
+    finder.push(tp);
+    if (i % 1000 == 0) {
+      // Let the merge stage run while TPs are still coming
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  finder.stop();
+
+  BOOST_REQUIRE_EQUAL(out.size(), expected.size());
+  size_t n_out_of_order = 0;
+  for (size_t i = 0; i < out.size(); ++i) {
+    n_out_of_order += (out[i].time_start != expected[i]);
+  }
+  BOOST_CHECK_EQUAL(n_out_of_order, 0);
+}
+
+BOOST_AUTO_TEST_CASE(IdleShardsDoNotHoldTAsBack)
+{
+  // A shard that gets no TP must not keep the TAs of the others waiting until stop
+  trigger::ShardedTAFinder finder(every_nth_tp(1), 2, 10);
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t n_out = 0;
+  finder.start(
+    [&](triggeralgs::TriggerActivity&&) {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++n_out;
+      cv.notify_all();
+    },
+    "ta-test");
+
+  triggeralgs::TriggerPrimitive tp;
+  tp.channel = 0;
+  tp.time_start = 100;
+  finder.push(tp);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    BOOST_CHECK(cv.wait_for(lock, std::chrono::seconds(5), [&] { return n_out == 1; }));
+  }
+  finder.stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
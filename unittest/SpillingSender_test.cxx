@@ -0,0 +1,179 @@
+/**
+ * @file SpillingSender_test.cxx  SpillingSender class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/SpillingSender.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE SpillingSender_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+
+namespace {
+
+// A sender that takes objects only while it is open
+class GatedSender
+{
+public:
+  std::atomic<bool> open{ true };
+
+  trigger::SpillingSender<int>::try_send_function_t try_send()
+  {
+    return [this](int&& data) {
+      if (!open.load()) {
+        return false;
+      }
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_received.push_back(data);
+      return true;
+    };
+  }
+
+  std::vector<int> received()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_received;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::vector<int> m_received;
+};
+
+// Wait up to a few seconds for the retry thread to have sent n objects
+bool
+wait_for_received(GatedSender& sender, size_t n)
+{
+  auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (sender.received().size() < n && std::chrono::steady_clock::now() < give_up) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return sender.received().size() == n;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(DirectSend)
+{
+  auto sender = std::make_shared<GatedSender>();
+  trigger::SpillingSender<int> spilling("int", sender->try_send(), 4, std::chrono::milliseconds(100));
+  spilling.start("spill-test");
+  for (int i = 0; i < 10; ++i) {
+    BOOST_CHECK(spilling.send(int(i), i) == trigger::SendOutcome::kSent);
+  }
+  spilling.stop();
+  BOOST_CHECK_EQUAL(sender->received().size(), 10);
+  BOOST_CHECK_EQUAL(spilling.sent_count(), 10);
+  BOOST_CHECK_EQUAL(spilling.spilled_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SpillAndRetryInOrder)
+{
+  auto sender = std::make_shared<GatedSender>();
+  trigger::SpillingSender<int> spilling("int", sender->try_send(), 8, std::chrono::milliseconds(100));
+  spilling.start("spill-test");
+  BOOST_CHECK(spilling.send(0, 0) == trigger::SendOutcome::kSent);
+
+  sender->open = false;
+  for (int i = 1; i < 6; ++i) {
+    BOOST_CHECK(spilling.send(int(i), i) == trigger::SendOutcome::kSpilled);
+  }
+  BOOST_CHECK_EQUAL(spilling.occupancy(), 5);
+
+  sender->open = true;
+  // Queues behind the spilled objects, even though the sender is open again
+  spilling.send(6, 6);
+  BOOST_CHECK(wait_for_received(*sender, 7));
+  BOOST_CHECK_EQUAL(spilling.occupancy(), 0);
+  spilling.stop();
+
+  std::vector<int> expected{ 0, 1, 2, 3, 4, 5, 6 };
+  auto received = sender->received();
+  BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(), expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(spilling.dropped_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(DropWhenFull)
+{
+  auto sender = std::make_shared<GatedSender>();
+  sender->open = false;
+  trigger::SpillingSender<int> spilling("int", sender->try_send(), 3, std::chrono::milliseconds(100));
+  spilling.start("spill-test");
+  int n_accepted = 0;
+  for (int i = 0; i < 10; ++i) {
+    n_accepted += spilling.send(int(i), i) != trigger::SendOutcome::kDropped ? 1 : 0;
+  }
+  BOOST_CHECK_EQUAL(n_accepted, 3);
+  BOOST_CHECK_EQUAL(spilling.occupancy(), 3);
+  BOOST_CHECK_EQUAL(spilling.dropped_count(), 7);
+
+  // Still closed at stop: what is left in the ring is dropped too
+  spilling.stop();
+  BOOST_CHECK_EQUAL(spilling.occupancy(), 0);
+  BOOST_CHECK_EQUAL(spilling.dropped_count(), 10);
+  BOOST_CHECK_EQUAL(sender->received().size(), 0);
+  // Spilled, then dropped: never counted as sent
+  BOOST_CHECK_EQUAL(spilling.sent_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ItemCounts)
+{
+  auto sender = std::make_shared<GatedSender>();
+  trigger::SpillingSender<int> spilling("int", sender->try_send(), 2, std::chrono::milliseconds(100));
+  spilling.start("spill-test");
+  BOOST_CHECK(spilling.send(0, 0, 5) == trigger::SendOutcome::kSent);
+  sender->open = false;
+  BOOST_CHECK(spilling.send(1, 1, 3) == trigger::SendOutcome::kSpilled);
+  BOOST_CHECK(spilling.send(2, 2, 4) == trigger::SendOutcome::kSpilled);
+  BOOST_CHECK(spilling.send(3, 3, 2) == trigger::SendOutcome::kDropped);
+  BOOST_CHECK_EQUAL(spilling.sent_item_count(), 5);
+  BOOST_CHECK_EQUAL(spilling.dropped_item_count(), 2);
+
+  sender->open = true;
+  BOOST_CHECK(wait_for_received(*sender, 3));
+  spilling.stop();
+  BOOST_CHECK_EQUAL(spilling.sent_count(), 3);
+  BOOST_CHECK_EQUAL(spilling.sent_item_count(), 12);
+  BOOST_CHECK_EQUAL(spilling.dropped_count(), 1);
+  BOOST_CHECK_EQUAL(spilling.dropped_item_count(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(NoRing)
+{
+  auto sender = std::make_shared<GatedSender>();
+  trigger::SpillingSender<int> spilling("int", sender->try_send(), 0, std::chrono::milliseconds(100));
+  spilling.start("spill-test");
+  BOOST_CHECK(spilling.send(0, 0) == trigger::SendOutcome::kSent);
+  sender->open = false;
+  BOOST_CHECK(spilling.send(1, 1) == trigger::SendOutcome::kDropped);
+  BOOST_CHECK_EQUAL(spilling.spilled_count(), 0);
+  spilling.stop();
+  BOOST_CHECK_EQUAL(spilling.sent_count(), 1);
+  BOOST_CHECK_EQUAL(spilling.dropped_count(), 1);
+
+  // Restarted without a ring, as after a stop
+  sender->open = true;
+  spilling.start("spill-test");
+  BOOST_CHECK(spilling.send(2, 2) == trigger::SendOutcome::kSent);
+  spilling.stop();
+  BOOST_CHECK_EQUAL(spilling.sent_count(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
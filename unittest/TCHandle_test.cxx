@@ -0,0 +1,182 @@
+/**
+ * @file TCHandle_test.cxx  TCHandle allocation Unit Tests
+ *
+ * Checks that once a TC is wrapped in a TCHandle, queueing it, merging it
+ * into pending TDs and taking the ready TDs out does not copy the TC.
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/PendingTDIndex.hpp"
+#include "trigger/SPSCRing.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE TCHandle_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> g_counting{ false };
+std::atomic<size_t> g_allocations{ 0 };
+std::atomic<size_t> g_allocated_bytes{ 0 };
+
+struct AllocationCount
+{
+  size_t allocations;
+  size_t bytes;
+};
+
+template<typename F>
+AllocationCount
+count_allocations(F&& f)
+{
+  g_allocations = 0;
+  g_allocated_bytes = 0;
+  g_counting = true;
+  f();
+  g_counting = false;
+  return { g_allocations.load(), g_allocated_bytes.load() };
+}
+
+} // namespace
+
+void*
+operator new(size_t size)
+{
+  if (g_counting) {
+    ++g_allocations;
+    g_allocated_bytes += size;
+  }
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+namespace {
+
+std::shared_ptr<const triggeralgs::TriggerCandidate>
+make_tc(triggeralgs::timestamp_t time, size_t n_inputs)
+{
+  auto tc = std::make_shared<triggeralgs::TriggerCandidate>();
+  tc->time_start = time;
+  tc->time_end = time + 100;
+  tc->time_candidate = time;
+  tc->inputs.resize(n_inputs);
+  return tc;
+}
+
+// Queue the TCs, build overlapping pending TDs out of them and take them all out again
+AllocationCount
+run_td_path(const std::vector<std::shared_ptr<const triggeralgs::TriggerCandidate>>& tcs,
+            std::vector<trigger::PendingTD>& ready)
+{
+  trigger::SPSCRing<trigger::TCHandle> queue(tcs.size());
+  trigger::PendingTDIndex index;
+
+  std::vector<trigger::TCHandle> handles;
+  for (const auto& tc : tcs) {
+    handles.emplace_back(tc);
+  }
+
+  return count_allocations([&] {
+    for (auto& handle : handles) {
+      queue.try_push(std::move(handle));
+    }
+    trigger::TCHandle tc;
+    while (queue.try_pop(tc)) {
+      auto it = index.find_overlap(tc.time_start, tc.time_end);
+      if (it != index.end()) {
+        auto start = tc.time_start;
+        auto end = tc.time_end;
+        it->second.contributing_tcs.push_back(std::move(tc));
+        index.extend(it, start, end);
+      } else {
+        trigger::PendingTD td;
+        td.readout_start = tc.time_start;
+        td.readout_end = tc.time_end;
+        td.walltime_expiration = 0;
+        td.contributing_tcs.push_back(std::move(tc));
+        index.insert(std::move(td));
+      }
+    }
+    ready = index.extract_expired(0);
+  });
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(HandleDoesNotCopyTC)
+{
+  auto tc = make_tc(0, 10000);
+  auto count = count_allocations([&] {
+    trigger::TCHandle handle(tc);
+    trigger::TCHandle moved(std::move(handle));
+    trigger::TCHandle copied(moved);
+  });
+  BOOST_CHECK_EQUAL(count.allocations, 0);
+  BOOST_CHECK_EQUAL(tc.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(TDPathCostIndependentOfTCSize)
+{
+  // Pairs of overlapping TCs, so half of them are merged into an existing TD
+  std::vector<std::shared_ptr<const triggeralgs::TriggerCandidate>> small_tcs;
+  std::vector<std::shared_ptr<const triggeralgs::TriggerCandidate>> large_tcs;
+  for (int i = 0; i < 100; ++i) {
+    triggeralgs::timestamp_t time = (i / 2) * 1000 + (i % 2) * 50;
+    small_tcs.push_back(make_tc(time, 1));
+    large_tcs.push_back(make_tc(time, 10000));
+  }
+
+  std::vector<trigger::PendingTD> small_ready;
+  std::vector<trigger::PendingTD> large_ready;
+  auto small_count = run_td_path(small_tcs, small_ready);
+  auto large_count = run_td_path(large_tcs, large_ready);
+
+  BOOST_CHECK_EQUAL(small_count.allocations, large_count.allocations);
+  BOOST_CHECK_EQUAL(small_count.bytes, large_count.bytes);
+
+  // The TDs hold the very TCs that went in
+  BOOST_REQUIRE_EQUAL(large_ready.size(), 50);
+  size_t n_tcs = 0;
+  for (const auto& td : large_ready) {
+    for (const auto& tc : td.contributing_tcs) {
+      BOOST_CHECK_EQUAL(tc.candidate->inputs.size(), 10000);
+      ++n_tcs;
+    }
+  }
+  BOOST_CHECK_EQUAL(n_tcs, 100);
+  for (const auto& tc : large_tcs) {
+    BOOST_CHECK_EQUAL(tc.use_count(), 2);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,293 @@
+/**
+ * @file TDBuilder_test.cxx  TDBuilder class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TDBuilder.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE TDBuilder_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace dunedaq;
+using namespace std::chrono_literals;
+using TCType = triggeralgs::TriggerCandidate::Type;
+
+namespace {
+
+// What the builder handed to its send function
+struct SentTD
+{
+  triggeralgs::timestamp_t trigger_timestamp;
+  triggeralgs::timestamp_t readout_start;
+  triggeralgs::timestamp_t readout_end;
+  size_t n_tcs;
+  std::chrono::steady_clock::time_point sent_at;
+};
+
+// Collects the TDs from the builder thread, and lets the test wait for them
+class TDSink
+{
+public:
+  trigger::TDBuilder::send_function_t send_function()
+  {
+    return [this](dfmessages::TriggerDecision&& decision, const trigger::PendingTD& pending_td) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tds.push_back({ decision.trigger_timestamp,
+                        pending_td.readout_start,
+                        pending_td.readout_end,
+                        pending_td.contributing_tcs.size(),
+                        std::chrono::steady_clock::now() });
+      m_cv.notify_all();
+      return trigger::SendOutcome::kSent;
+    };
+  }
+
+  bool wait_for(size_t n_tds, std::chrono::milliseconds timeout)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_cv.wait_for(lock, timeout, [&] { return m_tds.size() >= n_tds; });
+  }
+
+  // In readout order, whatever order the builder sent them in
+  std::vector<SentTD> tds()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto tds = m_tds;
+    std::sort(tds.begin(), tds.end(), [](const SentTD& a, const SentTD& b) { return a.readout_start < b.readout_start; });
+    return tds;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<SentTD> m_tds;
+};
+
+trigger::TCHandle
+make_tc(triggeralgs::timestamp_t start,
+        triggeralgs::timestamp_t end,
+        trigger::TCHandle::source_t source = 0,
+        TCType type = TCType::kTiming)
+{
+  auto tc = std::make_shared<triggeralgs::TriggerCandidate>();
+  tc->type = type;
+  tc->time_start = start;
+  tc->time_end = end;
+  tc->time_candidate = start;
+  trigger::TCHandle handle(std::move(tc));
+  handle.source = source;
+  return handle;
+}
+
+// TDs only close on the buffer timeout, over TCs' own time windows
+trigger::TDBuilderConfig
+make_config(int64_t buffer_timeout_ms)
+{
+  trigger::TDBuilderConfig config;
+  config.buffer_timeout = buffer_timeout_ms;
+  return config;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(ClosesOnDeadline)
+{
+  trigger::TDBuilder builder;
+  builder.configure(make_config(50));
+  TDSink sink;
+  builder.start(sink.send_function());
+
+  auto pushed_at = std::chrono::steady_clock::now();
+  builder.push(make_tc(100, 200));
+  BOOST_REQUIRE(sink.wait_for(1, 5s));
+  builder.stop();
+
+  auto tds = sink.tds();
+  BOOST_REQUIRE_EQUAL(tds.size(), 1);
+  BOOST_CHECK_EQUAL(tds[0].trigger_timestamp, 100);
+  BOOST_CHECK_EQUAL(tds[0].readout_start, 100);
+  BOOST_CHECK_EQUAL(tds[0].readout_end, 200);
+  // Not before the buffer timeout; the deadline has millisecond resolution
+  BOOST_CHECK(tds[0].sent_at - pushed_at >= 49ms);
+
+  const auto& counters = builder.counters();
+  BOOST_CHECK_EQUAL(counters.tds_created_count.load(), 1);
+  BOOST_CHECK_EQUAL(counters.tds_sent_count.load(), 1);
+  BOOST_CHECK_EQUAL(counters.tds_sent_tc_count.load(), 1);
+  BOOST_CHECK_EQUAL(counters.tds_cleared_count.load(), 0);
+  BOOST_CHECK_EQUAL(counters.tds_watermark_closed_count.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ClosesOnWatermark)
+{
+  // A timeout that the test never waits for: only the watermark closes TDs
+  auto config = make_config(60000);
+  config.close_on_watermark = true;
+  trigger::TDBuilder builder;
+  builder.configure(config);
+  TDSink sink;
+  builder.start(sink.send_function());
+
+  // Source 2 is behind source 1, and holds the watermark back at 10
+  builder.push(make_tc(10, 12, 2));
+  builder.push(make_tc(100, 110, 1));
+  builder.push(make_tc(1000, 1010, 1));
+  BOOST_CHECK(!sink.wait_for(1, 200ms));
+
+  // Once source 2 catches up, the watermark moves to source 1's latest TC
+  builder.push(make_tc(2000, 2010, 2));
+  BOOST_REQUIRE(sink.wait_for(2, 5s));
+  BOOST_CHECK(!sink.wait_for(3, 100ms));
+  builder.stop();
+
+  auto tds = sink.tds();
+  BOOST_REQUIRE_EQUAL(tds.size(), 2);
+  BOOST_CHECK_EQUAL(tds[0].readout_end, 12);
+  BOOST_CHECK_EQUAL(tds[1].readout_end, 110);
+
+  const auto& counters = builder.counters();
+  BOOST_CHECK_EQUAL(counters.tds_watermark_closed_count.load(), 2);
+  BOOST_CHECK_EQUAL(counters.tds_sent_count.load(), 2);
+  BOOST_CHECK_EQUAL(counters.tds_cleared_count.load(), 2);
+  BOOST_CHECK_EQUAL(counters.tds_cleared_tc_count.load(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(WatermarkMargin)
+{
+  auto config = make_config(60000);
+  config.close_on_watermark = true;
+  config.watermark_margin = 500;
+  trigger::TDBuilder builder;
+  builder.configure(config);
+  TDSink sink;
+  builder.start(sink.send_function());
+
+  // The data is 400 ticks past the first TD, which is not enough
+  builder.push(make_tc(100, 110));
+  builder.push(make_tc(510, 520));
+  BOOST_CHECK(!sink.wait_for(1, 200ms));
+
+  builder.push(make_tc(700, 710));
+  BOOST_REQUIRE(sink.wait_for(1, 5s));
+  builder.stop();
+
+  auto tds = sink.tds();
+  BOOST_REQUIRE_EQUAL(tds.size(), 1);
+  BOOST_CHECK_EQUAL(tds[0].readout_end, 110);
+}
+
+BOOST_AUTO_TEST_CASE(MergesOverlappingTCs)
+{
+  auto config = make_config(100);
+  config.merge_overlapping_tcs = true;
+  trigger::TDBuilder builder;
+  builder.configure(config);
+  TDSink sink;
+  builder.start(sink.send_function());
+
+  builder.push(make_tc(100, 200));
+  builder.push(make_tc(150, 300));
+  builder.push(make_tc(1000, 1100));
+  BOOST_REQUIRE(sink.wait_for(2, 5s));
+  builder.stop();
+
+  auto tds = sink.tds();
+  BOOST_REQUIRE_EQUAL(tds.size(), 2);
+  BOOST_CHECK_EQUAL(tds[0].n_tcs, 2);
+  BOOST_CHECK_EQUAL(tds[0].trigger_timestamp, 100);
+  BOOST_CHECK_EQUAL(tds[0].readout_start, 100);
+  BOOST_CHECK_EQUAL(tds[0].readout_end, 300);
+  BOOST_CHECK_EQUAL(tds[1].n_tcs, 1);
+
+  const auto& counters = builder.counters();
+  BOOST_CHECK_EQUAL(counters.tcs_added_count.load(), 3);
+  BOOST_CHECK_EQUAL(counters.tds_created_count.load(), 2);
+  BOOST_CHECK_EQUAL(counters.tds_created_tc_count.load(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(IgnoresOverlappingTCs)
+{
+  auto config = make_config(100);
+  config.ignore_overlapping_tcs = true;
+  trigger::TDBuilder builder;
+  builder.configure(config);
+  TDSink sink;
+  builder.start(sink.send_function());
+
+  builder.push(make_tc(100, 200));
+  builder.push(make_tc(150, 300));
+  BOOST_REQUIRE(sink.wait_for(1, 5s));
+  builder.stop();
+
+  auto tds = sink.tds();
+  BOOST_REQUIRE_EQUAL(tds.size(), 1);
+  BOOST_CHECK_EQUAL(tds[0].n_tcs, 1);
+  BOOST_CHECK_EQUAL(tds[0].readout_end, 200);
+
+  const auto& counters = builder.counters();
+  BOOST_CHECK_EQUAL(counters.tcs_added_count.load(), 2);
+  BOOST_CHECK_EQUAL(counters.tds_created_tc_count.load(), 1);
+  BOOST_CHECK_EQUAL(counters.tc_pileup_dropped_count.load(), 1);
+  BOOST_CHECK_EQUAL(counters.tds_dropped_tc_count.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SendsTooLongTDsAtOnce)
+{
+  // TDs with a readout window of 500 ticks or more do not wait for the timeout
+  auto config = make_config(60000);
+  config.merge_overlapping_tcs = true;
+  config.td_readout_limit = 500;
+  trigger::TDBuilder builder;
+  builder.configure(config);
+  TDSink sink;
+  builder.start(sink.send_function());
+
+  builder.push(make_tc(100, 400));
+  BOOST_CHECK(!sink.wait_for(1, 200ms));
+
+  // Merging grows the TD past the limit, so it is rescheduled to go now
+  builder.push(make_tc(350, 700));
+  BOOST_REQUIRE(sink.wait_for(1, 5s));
+  builder.stop();
+
+  auto tds = sink.tds();
+  BOOST_REQUIRE_EQUAL(tds.size(), 1);
+  BOOST_CHECK_EQUAL(tds[0].n_tcs, 2);
+  BOOST_CHECK_EQUAL(tds[0].readout_start, 100);
+  BOOST_CHECK_EQUAL(tds[0].readout_end, 700);
+  BOOST_CHECK_EQUAL(builder.counters().tds_cleared_count.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(CountsTCsPushedAfterStop)
+{
+  trigger::TDBuilder builder;
+  builder.configure(make_config(60000));
+  TDSink sink;
+  builder.start(sink.send_function());
+  builder.push(make_tc(100, 200));
+  builder.stop();
+
+  builder.push(make_tc(300, 400));
+  const auto& counters = builder.counters();
+  BOOST_CHECK_EQUAL(counters.tds_cleared_count.load(), 1);
+  BOOST_CHECK_EQUAL(counters.tc_rejected_count.load(), 1);
+  BOOST_CHECK(sink.tds().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+/**
+ * @file TPBatch_test.cxx  TPBatch class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TPBatch.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE TPBatch_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace dunedaq;
+using trgdataformats::TriggerPrimitive;
+
+namespace {
+
+std::vector<TriggerPrimitive>
+make_tps(size_t n)
+{
+  std::vector<TriggerPrimitive> tps;
+  for (size_t i = 0; i < n; ++i) {
+    TriggerPrimitive tp;
+    tp.time_start = 1000 + 10 * i;
+    tp.time_peak = tp.time_start + 3;
+    tp.time_over_threshold = 7 + i % 5;
+    tp.channel = i % 64;
+    tp.adc_integral = 100 + i;
+    tp.adc_peak = 20 + i % 10;
+    tp.detid = 3;
+    tp.type = TriggerPrimitive::Type::kTPC;
+    tp.algorithm = TriggerPrimitive::Algorithm::kSimpleThreshold;
+    tp.flag = i % 2;
+    tps.push_back(tp);
+  }
+  return tps;
+}
+
+bool
+same(const TriggerPrimitive& a, const TriggerPrimitive& b)
+{
+  return a.time_start == b.time_start && a.time_peak == b.time_peak &&
+         a.time_over_threshold == b.time_over_threshold && a.channel == b.channel &&
+         a.adc_integral == b.adc_integral && a.adc_peak == b.adc_peak && a.detid == b.detid && a.type == b.type &&
+         a.algorithm == b.algorithm && a.version == b.version && a.flag == b.flag;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+  auto tps = make_tps(100);
+  trigger::TPBatch batch(tps);
+  BOOST_REQUIRE_EQUAL(batch.size(), tps.size());
+
+  std::vector<TriggerPrimitive> back;
+  batch.copy_to(back);
+  BOOST_REQUIRE_EQUAL(back.size(), tps.size());
+  for (size_t i = 0; i < tps.size(); ++i) {
+    BOOST_CHECK(same(back[i], tps[i]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Columns)
+{
+  auto tps = make_tps(100);
+  trigger::TPBatch batch(tps);
+
+  auto channel = batch.channel();
+  auto time_start = batch.time_start();
+  BOOST_CHECK_EQUAL(channel.size(), 100);
+  BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(channel.data()) % 64, 0);
+  BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(time_start.data()) % 64, 0);
+  for (size_t i = 0; i < tps.size(); ++i) {
+    BOOST_CHECK_EQUAL(channel[i], tps[i].channel);
+    BOOST_CHECK_EQUAL(time_start[i], tps[i].time_start);
+  }
+  // A column is a plain array for kernels such as occupancy counts
+  size_t on_channel_0 = std::count(channel.begin(), channel.end(), 0);
+  BOOST_CHECK_EQUAL(on_channel_0, 2);
+}
+
+BOOST_AUTO_TEST_CASE(Iterators)
+{
+  auto tps = make_tps(50);
+  trigger::TPBatch batch(tps);
+
+  // The shape of a TA maker's operator()
+  std::vector<uint64_t> seen; // NOLINT(build/unsigned)
+  auto maker = [](const TriggerPrimitive& tp, std::vector<uint64_t>& out) { out.push_back(tp.time_start); }; // NOLINT
+  for (auto tp : batch) {
+    maker(tp, seen);
+  }
+  BOOST_REQUIRE_EQUAL(seen.size(), tps.size());
+  for (size_t i = 0; i < tps.size(); ++i) {
+    BOOST_CHECK_EQUAL(seen[i], tps[i].time_start);
+  }
+  BOOST_CHECK_EQUAL(batch.end() - batch.begin(), 50);
+
+  std::vector<TriggerPrimitive> copied(batch.begin(), batch.end());
+  BOOST_CHECK(same(copied[17], tps[17]));
+}
+
+BOOST_AUTO_TEST_CASE(AssignReuses)
+{
+  trigger::TPBatch batch(make_tps(100));
+  auto data = batch.adc_peak().data();
+  batch.assign(make_tps(60));
+  BOOST_CHECK_EQUAL(batch.size(), 60);
+  BOOST_CHECK(batch.adc_peak().data() == data);
+
+  batch.append(make_tps(10));
+  BOOST_CHECK_EQUAL(batch.size(), 70);
+  BOOST_CHECK_EQUAL(batch.time_start()[65], 1050);
+
+  batch.clear();
+  BOOST_CHECK(batch.empty());
+  BOOST_CHECK(batch.begin() == batch.end());
+}
+
+BOOST_AUTO_TEST_CASE(AppendGrowsGeometrically)
+{
+  trigger::TPBatch batch;
+  auto tps = make_tps(3);
+  int n_reallocations = 0;
+  auto data = batch.time_start().data();
+  for (int i = 0; i < 1000; ++i) {
+    batch.append(tps);
+    if (batch.time_start().data() != data) {
+      ++n_reallocations;
+      data = batch.time_start().data();
+    }
+  }
+  BOOST_CHECK_EQUAL(batch.size(), 3000);
+  BOOST_CHECK_LT(n_reallocations, 16);
+}
+
+BOOST_AUTO_TEST_CASE(FieldView)
+{
+  auto tps = make_tps(20);
+  auto channel = trigger::field_view<&TriggerPrimitive::channel>(tps);
+  auto adc_peak = trigger::field_view<&TriggerPrimitive::adc_peak>(tps);
+  BOOST_REQUIRE_EQUAL(channel.size(), tps.size());
+  for (size_t i = 0; i < tps.size(); ++i) {
+    BOOST_CHECK_EQUAL(channel[i], tps[i].channel);
+    BOOST_CHECK_EQUAL(adc_peak[i], tps[i].adc_peak);
+  }
+  // In place: changes to the TPs show through
+  tps[4].channel = 999;
+  BOOST_CHECK_EQUAL(channel[4], 999);
+
+  std::vector<TriggerPrimitive> none;
+  BOOST_CHECK_EQUAL(trigger::field_view<&TriggerPrimitive::channel>(none).size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
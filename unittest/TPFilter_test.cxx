@@ -0,0 +1,187 @@
+/**
+ * @file TPFilter_test.cxx  TPFilter class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TPFilter.hpp"
+#include "trigger/Issues.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE TPFilter_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace dunedaq;
+using trgdataformats::TriggerPrimitive;
+
+namespace {
+
+TriggerPrimitive
+make_tp(uint32_t channel, uint32_t tot, uint16_t adc_peak, uint32_t adc_integral) // NOLINT(build/unsigned)
+{
+  TriggerPrimitive tp;
+  tp.channel = channel;
+  tp.time_over_threshold = tot;
+  tp.adc_peak = adc_peak;
+  tp.adc_integral = adc_integral;
+  return tp;
+}
+
+// An APA-like layout: U, V and X planes of 800, 800 and 960 channels
+trigger::TPFilterConfig
+apa_config()
+{
+  trigger::TPFilterConfig config;
+  config.plane_period = 2560;
+  config.plane_boundaries = { 800, 1600 };
+  config.planes = { 2 };
+  return config;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(DisabledByDefault)
+{
+  trigger::TPFilter filter;
+  filter.configure(trigger::TPFilterConfig());
+  BOOST_CHECK(!filter.enabled());
+  BOOST_CHECK(filter.keep(make_tp(12345, 0, 0, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(Cuts)
+{
+  trigger::TPFilterConfig config = apa_config();
+  config.masked_channels = { 1700, 4200 };
+  config.min_time_over_threshold = 2;
+  config.max_time_over_threshold = 100;
+  config.min_adc_peak = 20;
+  config.min_adc_integral = 50;
+  trigger::TPFilter filter;
+  filter.configure(config);
+  BOOST_CHECK(filter.enabled());
+
+  BOOST_CHECK(filter.keep(make_tp(1650, 10, 30, 100)));
+  BOOST_CHECK(filter.keep(make_tp(2560 + 1600, 10, 30, 100)));
+  BOOST_CHECK(!filter.keep(make_tp(1599, 10, 30, 100)));         // V plane
+  BOOST_CHECK(!filter.keep(make_tp(2560 + 10, 10, 30, 100)));    // U plane of the next APA
+  BOOST_CHECK(!filter.keep(make_tp(1700, 10, 30, 100)));         // masked
+  BOOST_CHECK(!filter.keep(make_tp(4200, 10, 30, 100)));         // masked
+  BOOST_CHECK(!filter.keep(make_tp(1650, 1, 30, 100)));          // short
+  BOOST_CHECK(!filter.keep(make_tp(1650, 101, 30, 100)));        // long
+  BOOST_CHECK(!filter.keep(make_tp(1650, 10, 19, 100)));         // low peak
+  BOOST_CHECK(!filter.keep(make_tp(1650, 10, 30, 49)));          // low integral
+}
+
+BOOST_AUTO_TEST_CASE(PlaneConfigErrors)
+{
+  trigger::TPFilter filter;
+
+  auto no_planes = apa_config();
+  no_planes.planes.clear();
+  BOOST_CHECK_THROW(filter.configure(no_planes), trigger::InvalidConfiguration);
+
+  auto missing_plane = apa_config();
+  missing_plane.planes = { 3 };
+  BOOST_CHECK_THROW(filter.configure(missing_plane), trigger::InvalidConfiguration);
+
+  auto bad_boundary = apa_config();
+  bad_boundary.plane_boundaries = { 800, 2560 };
+  BOOST_CHECK_THROW(filter.configure(bad_boundary), trigger::InvalidConfiguration);
+
+  // Without a plane period the plane lists are not used
+  auto no_period = apa_config();
+  no_period.plane_period = 0;
+  no_period.planes.clear();
+  filter.configure(no_period);
+  BOOST_CHECK(!filter.enabled());
+}
+
+BOOST_AUTO_TEST_CASE(SelectKeepsOrder)
+{
+  trigger::TPFilterConfig config;
+  config.min_adc_peak = 10;
+  trigger::TPFilter filter;
+  filter.configure(config);
+
+  std::vector<TriggerPrimitive> tps;
+  for (uint16_t i = 0; i < 21; ++i) { // NOLINT(build/unsigned)
+    tps.push_back(make_tp(i, 1, (i % 3 == 0) ? 5 : 15, 0));
+  }
+  size_t n_dropped = filter.select(tps, [](const TriggerPrimitive& tp) -> const TriggerPrimitive& { return tp; });
+  BOOST_CHECK_EQUAL(n_dropped, 7);
+  BOOST_REQUIRE_EQUAL(tps.size(), 14);
+  std::vector<uint32_t> channels;          // NOLINT(build/unsigned)
+  std::vector<uint32_t> expected_channels; // NOLINT(build/unsigned)
+  for (const auto& tp : tps) {
+    channels.push_back(tp.channel);
+  }
+  for (uint32_t i = 0; i < 21; ++i) { // NOLINT(build/unsigned)
+    if (i % 3 != 0) {
+      expected_channels.push_back(i);
+    }
+  }
+  BOOST_CHECK_EQUAL_COLLECTIONS(channels.begin(), channels.end(), expected_channels.begin(), expected_channels.end());
+}
+
+BOOST_AUTO_TEST_CASE(VectorMatchesScalar)
+{
+  BOOST_TEST_MESSAGE("AVX2 kernel in use: " << trigger::TPFilter::use_avx2());
+
+  std::default_random_engine generator(42);
+  std::uniform_int_distribution<uint32_t> channel(0, 200000);   // NOLINT(build/unsigned)
+  std::uniform_int_distribution<uint32_t> value(0, 200);        // NOLINT(build/unsigned)
+  std::uniform_int_distribution<uint32_t> far_channel(0, 3);    // NOLINT(build/unsigned)
+
+  trigger::TPFilterConfig config = apa_config();
+  config.planes = { 0, 2 };
+  for (int i = 0; i < 500; ++i) {
+    config.masked_channels.push_back(channel(generator) / 2);
+  }
+  config.min_time_over_threshold = 20;
+  config.max_time_over_threshold = 180;
+  config.min_adc_peak = 30;
+  config.min_adc_integral = 10;
+
+  trigger::TPFilter vector_filter;
+  vector_filter.configure(config);
+  trigger::TPFilter scalar_filter;
+  scalar_filter.configure(config);
+  scalar_filter.set_force_scalar(true);
+
+  // Batch sizes that are and are not a multiple of the vector width
+  for (size_t n_tps : { 1, 7, 8, 100, 4099 }) {
+    std::vector<TriggerPrimitive> tps;
+    for (size_t i = 0; i < n_tps; ++i) {
+      // A few channels too large for the vector plane selection
+      uint32_t ch = far_channel(generator) == 0 ? 0x01000000 + channel(generator) : channel(generator); // NOLINT
+      tps.push_back(make_tp(ch, value(generator), value(generator), value(generator)));
+    }
+    std::vector<TriggerPrimitive> vector_tps = tps;
+    std::vector<TriggerPrimitive> scalar_tps = tps;
+    auto get_tp = [](const TriggerPrimitive& tp) -> const TriggerPrimitive& { return tp; };
+    vector_filter.select(vector_tps, get_tp);
+    scalar_filter.select(scalar_tps, get_tp);
+
+    size_t n_kept = 0;
+    for (const auto& tp : tps) {
+      n_kept += scalar_filter.keep(tp) ? 1 : 0;
+    }
+    BOOST_REQUIRE_EQUAL(scalar_tps.size(), n_kept);
+    BOOST_REQUIRE_EQUAL(vector_tps.size(), scalar_tps.size());
+    for (size_t i = 0; i < vector_tps.size(); ++i) {
+      BOOST_CHECK_EQUAL(vector_tps[i].channel, scalar_tps[i].channel);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
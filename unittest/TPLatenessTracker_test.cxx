@@ -0,0 +1,92 @@
+/**
+ * @file TPLatenessTracker_test.cxx  TPLatenessTracker class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TPLatenessTracker.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE TPLatenessTracker_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+using namespace dunedaq;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(Lateness)
+{
+  trigger::TPLatenessTracker tracker;
+  tracker.record(1000);
+  tracker.record(1000);
+  tracker.record(1001);
+  // 1 and 101 ticks behind the newest
+  tracker.record(1000);
+  tracker.record(900);
+  // Newer again, on time
+  tracker.record(2000);
+
+  auto snapshot = tracker.snapshot();
+  BOOST_CHECK_EQUAL(snapshot.count, 6);
+  BOOST_CHECK_EQUAL(snapshot.buckets[0], 5);
+  BOOST_CHECK_EQUAL(snapshot.buckets[6], 1);
+}
+
+BOOST_AUTO_TEST_CASE(Quantile)
+{
+  trigger::TPLatenessTracker::Snapshot snapshot;
+  BOOST_CHECK_EQUAL(snapshot.quantile(0.99), 0);
+
+  // 90 on time, 10 in [1024, 2048)
+  snapshot.buckets[0] = 90;
+  snapshot.buckets[10] = 10;
+  snapshot.count = 100;
+  BOOST_CHECK_LE(snapshot.quantile(0.9), 2);
+  BOOST_CHECK_EQUAL(snapshot.quantile(0.95), 1024 + 512);
+  BOOST_CHECK_EQUAL(snapshot.quantile(1.), 2048);
+}
+
+BOOST_AUTO_TEST_CASE(Since)
+{
+  trigger::TPLatenessTracker tracker;
+  tracker.record(1000000);
+  for (int i = 0; i < 10; ++i) {
+    tracker.record(0);
+  }
+  auto earlier = tracker.snapshot();
+  for (int i = 0; i < 10; ++i) {
+    tracker.record(1000000);
+  }
+  auto recent = tracker.snapshot().since(earlier);
+  BOOST_CHECK_EQUAL(recent.count, 10);
+  BOOST_CHECK_LE(recent.quantile(1.), 2);
+}
+
+BOOST_AUTO_TEST_CASE(LateCount)
+{
+  trigger::TPLatenessTracker tracker;
+  tracker.set_sent_until(500);
+  tracker.record(400);
+  tracker.record(500);
+  tracker.record(499);
+  BOOST_CHECK_EQUAL(tracker.late_count(), 2);
+
+  tracker.start_run();
+  BOOST_CHECK_EQUAL(tracker.late_count(), 0);
+  tracker.record(400);
+  BOOST_CHECK_EQUAL(tracker.late_count(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SharedPerLink)
+{
+  auto a = trigger::TPLatenessTracker::for_link("link-a");
+  BOOST_CHECK(a == trigger::TPLatenessTracker::for_link("link-a"));
+  BOOST_CHECK(a != trigger::TPLatenessTracker::for_link("link-b"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+/**
+ * @file TimeBucketIndex_test.cxx  TimeBucketIndex class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TimeBucketIndex.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE TimeBucketIndex_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstdint>
+#include <set>
+
+using namespace dunedaq;
+
+namespace {
+
+using Buffer = std::set<uint64_t>; // NOLINT(build/unsigned)
+using Index = trigger::TimeBucketIndex<Buffer::const_iterator>;
+
+// Walk the buffer in order from begin, as the periodic transmission does
+void
+walk(Index& index, const Buffer& buffer, Buffer::const_iterator begin)
+{
+  for (auto it = begin; it != buffer.end(); ++it) {
+    index.record(it, *it);
+  }
+}
+
+// The first element at or after time, found from the index
+Buffer::const_iterator
+seek(const Index& index, const Buffer& buffer, uint64_t time) // NOLINT(build/unsigned)
+{
+  auto entry = index.find(time);
+  BOOST_REQUIRE(entry.has_value());
+  BOOST_REQUIRE_LT(entry->before_time, time - time % index.bucket_ticks() + 1);
+  auto it = entry->before;
+  while (it != buffer.end() && *it < time) {
+    ++it;
+  }
+  return it;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+BOOST_AUTO_TEST_CASE(FindsWindowStarts)
+{
+  Buffer buffer;
+  for (uint64_t t = 5; t < 10000; t += 7) { // NOLINT(build/unsigned)
+    buffer.insert(t);
+  }
+  Index index(6, 1024);
+  walk(index, buffer, buffer.begin());
+
+  for (uint64_t t = 100; t < 9900; t += 13) { // NOLINT(build/unsigned)
+    BOOST_CHECK(seek(index, buffer, t) == buffer.lower_bound(t));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FirstBucketAndFuture)
+{
+  Buffer buffer{ 10, 20, 200 };
+  Index index(6, 16);
+  // Nothing before the first element: its bucket has no entry
+  BOOST_CHECK(!index.find(10).has_value());
+  walk(index, buffer, buffer.begin());
+  BOOST_CHECK(!index.find(10).has_value());
+  // Buckets 1 and 2 are empty, but start after 20
+  BOOST_CHECK_EQUAL(index.find(64)->before_time, 20);
+  BOOST_CHECK_EQUAL(index.find(150)->before_time, 20);
+  BOOST_CHECK_EQUAL(index.find(200)->before_time, 20);
+  // Not walked yet
+  BOOST_CHECK(!index.find(256).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(LateInsertsAreFound)
+{
+  Buffer buffer{ 10, 100, 140, 300 };
+  Index index(6, 16);
+  walk(index, buffer, buffer.begin());
+
+  // Inserted after the walk went past it, in bucket 2
+  buffer.insert(130);
+  BOOST_CHECK_EQUAL(*seek(index, buffer, 128), 130);
+}
+
+BOOST_AUTO_TEST_CASE(ReleasedEntriesStayInvalidAfterLateInserts)
+{
+  Buffer buffer{ 10, 20, 100, 140, 300 };
+  Index index(6, 16);
+  walk(index, buffer, buffer.begin());
+  BOOST_CHECK_EQUAL(index.find(64)->before_time, 20);
+
+  // The cleanup removes the head of the buffer, up to 20
+  buffer.erase(buffer.begin(), buffer.find(100));
+  index.release(20);
+  BOOST_CHECK(!index.find(64).has_value());
+
+  // A late element older than the removed ones becomes the new head. The
+  // entry of bucket 1 is newer than it, but its element is gone all the same
+  buffer.insert(5);
+  BOOST_CHECK(!index.find(64).has_value());
+  // Bucket 2 starts after 100, which is still there
+  BOOST_CHECK_EQUAL(*seek(index, buffer, 130), 140);
+
+  index.clear();
+  walk(index, buffer, buffer.begin());
+  BOOST_CHECK_EQUAL(index.find(64)->before_time, 5);
+}
+
+BOOST_AUTO_TEST_CASE(OldBucketsAreForgotten)
+{
+  Buffer buffer;
+  for (uint64_t t = 0; t < 64 * 100; t += 8) { // NOLINT(build/unsigned)
+    buffer.insert(t);
+  }
+  Index index(6, 16);
+  walk(index, buffer, buffer.begin());
+  // Only the last 16 buckets are remembered
+  BOOST_CHECK(!index.find(64 * 10).has_value());
+  BOOST_CHECK(index.find(64 * 90).has_value());
+
+  index.clear();
+  BOOST_CHECK(!index.find(64 * 90).has_value());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+/**
+ * @file TriggerBitwords_test.cxx  TriggerBitwords class Unit Tests
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "trigger/TriggerBitwords.hpp"
+
+#include "triggeralgs/TriggerCandidate.hpp"
+
+/**
+ * @brief Name of this test module
+ */
+#define BOOST_TEST_MODULE TriggerBitwords_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using TCType = triggeralgs::TriggerCandidate::Type;
+using word_t = trigger::TriggerBitwords::word_t;
+
+BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
+
+namespace {
+
+word_t
+bit(TCType type)
+{
+  return word_t(1) << static_cast<int>(type);
+}
+
+std::vector<triggeralgs::TriggerCandidate>
+make_tcs(const std::vector<TCType>& types)
+{
+  std::vector<triggeralgs::TriggerCandidate> tcs(types.size());
+  for (size_t i = 0; i < types.size(); ++i) {
+    tcs[i].type = types[i];
+  }
+  return tcs;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(Parse)
+{
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::parse("kTiming"), bit(TCType::kTiming));
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::parse("kTiming & kSupernova"),
+                    bit(TCType::kTiming) | bit(TCType::kSupernova));
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::parse(" kPrescale,kRandom "),
+                    bit(TCType::kPrescale) | bit(TCType::kRandom));
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::parse("1+3"), word_t(0b1010));
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::parse("63"), word_t(1) << 63);
+}
+
+BOOST_AUTO_TEST_CASE(ParseErrors)
+{
+  BOOST_CHECK_THROW(trigger::TriggerBitwords::parse(""), trigger::InvalidConfiguration);
+  BOOST_CHECK_THROW(trigger::TriggerBitwords::parse(" , "), trigger::InvalidConfiguration);
+  BOOST_CHECK_THROW(trigger::TriggerBitwords::parse("kNotAType"), trigger::InvalidConfiguration);
+  BOOST_CHECK_THROW(trigger::TriggerBitwords::parse("64"), trigger::InvalidConfiguration);
+  BOOST_CHECK_THROW(trigger::TriggerBitwords::parse("123456789012345678901234567890"),
+                    trigger::InvalidConfiguration);
+}
+
+BOOST_AUTO_TEST_CASE(MakeTDWord)
+{
+  auto tcs = make_tcs({ TCType::kSupernova, TCType::kTiming, TCType::kSupernova });
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::make_td_word(tcs), bit(TCType::kTiming) | bit(TCType::kSupernova));
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::make_td_word(make_tcs({})), word_t(0));
+
+  // A type past the last bit does not fold onto another type's bit
+  auto folded = static_cast<TCType>(static_cast<int>(TCType::kTiming) + 64);
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::make_td_word(make_tcs({ folded })), word_t(0));
+  BOOST_CHECK_EQUAL(trigger::TriggerBitwords::make_td_word(make_tcs({ TCType::kSupernova, folded })),
+                    bit(TCType::kSupernova));
+}
+
+BOOST_AUTO_TEST_CASE(Matches)
+{
+  trigger::TriggerBitwords bitwords;
+  BOOST_CHECK(!bitwords.matches(~word_t(0)));
+
+  bitwords.configure({ "kTiming & kSupernova", "kPrescale" });
+  BOOST_CHECK_EQUAL(bitwords.size(), 2);
+
+  // Every bit of one of the bitwords must be present; extra bits are fine
+  BOOST_CHECK(bitwords.matches(bit(TCType::kTiming) | bit(TCType::kSupernova)));
+  BOOST_CHECK(bitwords.matches(bit(TCType::kTiming) | bit(TCType::kSupernova) | bit(TCType::kRandom)));
+  BOOST_CHECK(bitwords.matches(bit(TCType::kPrescale)));
+  BOOST_CHECK(!bitwords.matches(bit(TCType::kTiming)));
+  BOOST_CHECK(!bitwords.matches(bit(TCType::kSupernova) | bit(TCType::kRandom)));
+  BOOST_CHECK(!bitwords.matches(0));
+
+  // Reconfiguring replaces the bitwords
+  bitwords.configure({ "kRandom" });
+  BOOST_CHECK(!bitwords.matches(bit(TCType::kPrescale)));
+  BOOST_CHECK(bitwords.matches(bit(TCType::kRandom)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()